@@ -0,0 +1,85 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	tapasco_bufpool.h
+//! @brief	Pool of device buffers for delayed transfers: buffers of
+//!		finished jobs are kept by size class and handed to the next
+//!		jobs, instead of freeing and allocating device memory per job.
+//! @authors	Embedded Systems and Applications Group, TU Darmstadt
+//!
+#ifndef TAPASCO_BUFPOOL_H__
+#define TAPASCO_BUFPOOL_H__
+
+#include <tapasco_types.h>
+
+/** Idle bytes above which the pool is trimmed (default). */
+#ifndef TAPASCO_BUFPOOL_HIGH_WATERMARK
+#define TAPASCO_BUFPOOL_HIGH_WATERMARK (256UL << 20)
+#endif
+
+/** Idle bytes the pool is trimmed down to (default). */
+#ifndef TAPASCO_BUFPOOL_LOW_WATERMARK
+#define TAPASCO_BUFPOOL_LOW_WATERMARK (128UL << 20)
+#endif
+
+/** Buffer pool of a device (opaque). */
+typedef struct tapasco_bufpool tapasco_bufpool_t;
+
+/**
+ * Initializes the buffer pool of a device.
+ * @param dev_ctx device context.
+ * @param pool output pointer to initialize.
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+ **/
+tapasco_res_t tapasco_bufpool_init(tapasco_devctx_t *dev_ctx,
+                                   tapasco_bufpool_t **pool);
+
+/**
+ * Frees all idle buffers and releases the pool.
+ * @param pool buffer pool to release.
+ **/
+void tapasco_bufpool_deinit(tapasco_bufpool_t *pool);
+
+/**
+ * Takes an idle buffer of at least len bytes from the pool, or allocates one.
+ * @param pool buffer pool.
+ * @param h output parameter for the device handle.
+ * @param len size in bytes.
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+ **/
+tapasco_res_t tapasco_bufpool_get(tapasco_bufpool_t *pool, tapasco_handle_t *h,
+                                  size_t const len);
+
+/**
+ * Returns a buffer obtained by tapasco_bufpool_get to the pool; buffers are
+ * freed, if the pool is disabled or too large.
+ * @param pool buffer pool.
+ * @param h device handle.
+ * @param len size in bytes, as passed to tapasco_bufpool_get.
+ **/
+void tapasco_bufpool_put(tapasco_bufpool_t *pool, tapasco_handle_t const h,
+                         size_t const len);
+
+/**
+ * Frees all idle buffers of the pool, e.g., when device memory is exhausted.
+ * @param pool buffer pool.
+ * @return number of buffers freed.
+ **/
+size_t tapasco_bufpool_trim(tapasco_bufpool_t *pool);
+
+#endif /* TAPASCO_BUFPOOL_H__ */
@@ -0,0 +1,80 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	tapasco_copies.h
+//! @brief	Nonblocking copies: copies with TAPASCO_DEVICE_COPY_NONBLOCKING
+//!		are run by a pool of transfer worker threads and identified
+//!		by copy ids, which can be tested and waited for.
+//! @authors	Embedded Systems and Applications Group, TU Darmstadt
+//!
+#ifndef TAPASCO_COPIES_H__
+#define TAPASCO_COPIES_H__
+
+#include <tapasco_types.h>
+
+/** Max. number of nonblocking copies in flight, i.e., not waited for yet. */
+#ifndef TAPASCO_COPIES_MAX
+#define TAPASCO_COPIES_MAX 1024
+#endif
+
+/** Number of transfer worker threads. */
+#ifndef TAPASCO_COPIES_WORKERS
+#define TAPASCO_COPIES_WORKERS 2
+#endif
+
+/** Nonblocking copies of a device (opaque). */
+typedef struct tapasco_copies tapasco_copies_t;
+
+/**
+ * Initializes the nonblocking copies of a device; worker threads are started
+ * with the first nonblocking copy.
+ * @param dev_ctx device context.
+ * @param copies output pointer to initialize.
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+ **/
+tapasco_res_t tapasco_copies_init(tapasco_devctx_t *dev_ctx,
+                                  tapasco_copies_t **copies);
+
+/**
+ * Stops the worker threads and releases the nonblocking copies; copies which
+ * have not been started yet are dropped.
+ * @param copies nonblocking copies to release.
+ **/
+void tapasco_copies_deinit(tapasco_copies_t *copies);
+
+/**
+ * Hands a copy over to the transfer workers.
+ * @param dev_ctx device context.
+ * @param to_device non-zero for copies from host to device.
+ * @param host host address.
+ * @param h device handle.
+ * @param len number of bytes to copy.
+ * @param flags copy flags (without TAPASCO_DEVICE_COPY_NONBLOCKING).
+ * @param slot_id slot of the PE for PE-local copies.
+ * @param copy_id output parameter for the copy id.
+ * @return TAPASCO_SUCCESS if successful, TAPASCO_ERR_COPY_BUSY if
+ *         TAPASCO_COPIES_MAX copies are in flight, an error code otherwise.
+ **/
+tapasco_res_t tapasco_copies_submit(tapasco_devctx_t *dev_ctx,
+                                    int const to_device, void *host,
+                                    tapasco_handle_t const h, size_t const len,
+                                    tapasco_device_copy_flag_t const flags,
+                                    tapasco_slot_id_t const slot_id,
+                                    tapasco_copy_id_t *copy_id);
+
+#endif /* TAPASCO_COPIES_H__ */
@@ -0,0 +1,65 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	tapasco_cq.h
+//! @brief	Completion queues: Finished jobs are posted to their queue by
+//!		the platform collector thread and can be reaped in batches by
+//!		a single thread, instead of waiting on each job separately.
+//! @authors	Embedded Systems and Applications Group, TU Darmstadt
+//!
+#ifndef TAPASCO_CQ_H__
+#define TAPASCO_CQ_H__
+
+#include <platform_types.h>
+#include <tapasco_types.h>
+
+/**
+ * Initializes a completion queue.
+ * @param dev_id device id.
+ * @param cq output pointer to initialize.
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+ **/
+tapasco_res_t tapasco_cq_init(tapasco_dev_id_t const dev_id,
+                              tapasco_cq_t **cq);
+
+/**
+ * Releases a completion queue.
+ * @param cq completion queue.
+ **/
+void tapasco_cq_deinit(tapasco_cq_t *cq);
+
+/**
+ * Posts a job to a completion queue and wakes up reaping threads.
+ * @param cq completion queue.
+ * @param j_id job id.
+ **/
+void tapasco_cq_post(tapasco_cq_t *cq, tapasco_job_id_t const j_id);
+
+/**
+ * Callback for the platform collector thread: Posts all jobs in the finished
+ * slots which are attached to a completion queue to their queue, hands jobs
+ * with dependent jobs to the scheduler and removes their slots from the array.
+ * @param num number of slot ids in slots.
+ * @param slots array of finished slot ids.
+ * @param arg device context.
+ * @return number of slot ids remaining in slots.
+ **/
+size_t tapasco_cq_signal_received(size_t num, platform_slot_id_t *slots,
+                                  void *arg);
+
+#endif /* TAPASCO_CQ_H__ */
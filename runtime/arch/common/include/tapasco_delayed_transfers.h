@@ -37,6 +37,22 @@ tapasco_res_t tapasco_transfer_from(tapasco_devctx_t *dev_ctx,
                                     tapasco_transfer_t *t,
                                     tapasco_slot_id_t s_id);
 
+/**
+ * Frees the device buffer of a transfer; buffers shared along job graph edges
+ * are freed when the last job using them releases them.
+ **/
+void tapasco_transfer_release(tapasco_devctx_t *dev_ctx,
+                              tapasco_job_id_t const j_id,
+                              tapasco_transfer_t *t, tapasco_slot_id_t s_id);
+
+/**
+ * Frees the device buffer of a transfer without copying data back, e.g., for
+ * a cancelled job; data in PE-local memory is no longer kept resident.
+ **/
+void tapasco_transfer_discard(tapasco_devctx_t *dev_ctx,
+                              tapasco_job_id_t const j_id,
+                              tapasco_transfer_t *t, tapasco_slot_id_t s_id);
+
 tapasco_res_t tapasco_write_arg(tapasco_devctx_t *dev_ctx, tapasco_jobs_t *jobs,
                                 tapasco_job_id_t const j_id,
                                 tapasco_handle_t const h, size_t const a);
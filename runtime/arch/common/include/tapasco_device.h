@@ -24,9 +24,13 @@
 #define TAPASCO_DEVICE_H__
 
 #include <platform_types.h>
+#include <tapasco_bufpool.h>
+#include <tapasco_copies.h>
+#include <tapasco_fallback.h>
 #include <tapasco_jobs.h>
 #include <tapasco_local_mem.h>
 #include <tapasco_pemgmt.h>
+#include <tapasco_scheduler.h>
 #include <tapasco_types.h>
 
 struct tapasco_devctx {
@@ -35,6 +39,10 @@ struct tapasco_devctx {
   tapasco_pemgmt_t *pemgmt;
   tapasco_jobs_t *jobs;
   tapasco_local_mem_t *lmem;
+  tapasco_bufpool_t *bufpool;
+  tapasco_scheduler_t *scheduler;
+  tapasco_fallback_t *fallback;
+  tapasco_copies_t *copies;
   platform_ctx_t *pctx;
   platform_devctx_t *pdctx;
   void *private_data;
@@ -0,0 +1,129 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+//! @file	tapasco_fallback.h
+//! @brief	CPU fallback: host implementations registered per kernel run
+//!		jobs on a pool of worker threads, when the expected queueing
+//!		delay for a PE exceeds their estimated runtime on the CPU.
+//! @authors	Embedded Systems and Applications Group, TU Darmstadt
+//!
+#ifndef TAPASCO_FALLBACK_H__
+#define TAPASCO_FALLBACK_H__
+
+#include <tapasco_global.h>
+#include <tapasco_types.h>
+
+/** Pseudo slot id of jobs running on the CPU. */
+#define TAPASCO_FALLBACK_SLOT TAPASCO_NUM_SLOTS
+
+/** Max. number of kernels with a host implementation. */
+#ifndef TAPASCO_FALLBACK_MAX_KERNELS
+#define TAPASCO_FALLBACK_MAX_KERNELS 32
+#endif
+
+/** Number of CPU worker threads (0: number of online CPUs). */
+#ifndef TAPASCO_FALLBACK_WORKERS
+#define TAPASCO_FALLBACK_WORKERS 0
+#endif
+
+/** Weight of new samples in the runtime estimates: 2^-TAPASCO_FALLBACK_EWMA. */
+#ifndef TAPASCO_FALLBACK_EWMA
+#define TAPASCO_FALLBACK_EWMA 3
+#endif
+
+/** CPU fallback state (opaque). */
+typedef struct tapasco_fallback tapasco_fallback_t;
+
+/**
+ * Initializes the CPU fallback of a device; worker threads are started when
+ * the first host implementation is registered.
+ * @param dev_ctx device context.
+ * @param fallback output pointer to initialize.
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+ **/
+tapasco_res_t tapasco_fallback_init(tapasco_devctx_t *dev_ctx,
+                                    tapasco_fallback_t **fallback);
+
+/**
+ * Stops the worker threads and releases the CPU fallback.
+ * @param fallback CPU fallback to release.
+ **/
+void tapasco_fallback_deinit(tapasco_fallback_t *fallback);
+
+/**
+ * Returns non-zero, if a host implementation is registered for kernel k_id.
+ * @param fallback CPU fallback.
+ * @param k_id kernel id.
+ **/
+int tapasco_fallback_registered(tapasco_fallback_t *fallback,
+                                tapasco_kernel_id_t const k_id);
+
+/**
+ * Returns non-zero, if a job should run on the CPU: its kernel has a host
+ * implementation and either no PEs, or all PEs are busy and the expected
+ * queueing delay exceeds the estimated runtime on the CPU. Jobs using device
+ * buffers without host data, e.g., job graph intermediates, always run on PEs.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ **/
+int tapasco_fallback_wants(tapasco_devctx_t *dev_ctx,
+                           tapasco_job_id_t const j_id);
+
+/**
+ * Hands a job over to the CPU workers unconditionally, e.g., after
+ * @see tapasco_fallback_wants returned non-zero for it.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ **/
+void tapasco_fallback_submit(tapasco_devctx_t *dev_ctx,
+                             tapasco_job_id_t const j_id);
+
+/**
+ * Hands a scheduled job over to the CPU workers, if its kernel has a host
+ * implementation and either no PEs, or all PEs are busy and the expected
+ * queueing delay exceeds the estimated runtime on the CPU. Jobs using device
+ * buffers without host data, e.g., job graph intermediates, always run on PEs.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ * @return non-zero, if the job will run on the CPU.
+ **/
+int tapasco_fallback_offload(tapasco_devctx_t *dev_ctx,
+                             tapasco_job_id_t const j_id);
+
+/**
+ * Notifies the CPU fallback that a job is started on the PE in slot_id; used
+ * to learn the runtime of jobs on PEs.
+ * @param dev_ctx device context.
+ * @param k_id kernel id of the job.
+ * @param slot_id slot of the PE.
+ **/
+void tapasco_fallback_pe_started(tapasco_devctx_t *dev_ctx,
+                                 tapasco_kernel_id_t const k_id,
+                                 tapasco_slot_id_t const slot_id);
+
+/**
+ * Notifies the CPU fallback that the PE in slot_id is released.
+ * @param dev_ctx device context.
+ * @param k_id kernel id of the job.
+ * @param slot_id slot of the PE.
+ **/
+void tapasco_fallback_pe_finished(tapasco_devctx_t *dev_ctx,
+                                  tapasco_kernel_id_t const k_id,
+                                  tapasco_slot_id_t const slot_id);
+
+#endif /* TAPASCO_FALLBACK_H__ */
@@ -25,9 +25,18 @@
 
 #include <tapasco_errors.h>
 #include <tapasco_types.h>
+#include <time.h>
 
 #define TAPASCO_JOBS_Q_SZ 250
 #define TAPASCO_JOB_MAX_ARGS 32
+/** Max. number of dependent jobs per job, @see tapasco_jobs_add_edge. **/
+#ifndef TAPASCO_JOB_MAX_SUCCESSORS
+#define TAPASCO_JOB_MAX_SUCCESSORS 8
+#endif
+/** Number of free job ids cached per thread, @see tapasco_jobs_acquire. **/
+#ifndef TAPASCO_JOBS_MAGAZINE_SZ
+#define TAPASCO_JOBS_MAGAZINE_SZ 8
+#endif
 
 /** @defgroup common_job common: job struct
  *  @{
@@ -47,8 +56,19 @@ typedef enum {
   TAPASCO_JOB_STATE_RUNNING,
   /** job has finished, return value is valid **/
   TAPASCO_JOB_STATE_FINISHED,
+  /** job could not be dispatched to its PE, no results **/
+  TAPASCO_JOB_STATE_FAILED,
+  /** job was cancelled, no results **/
+  TAPASCO_JOB_STATE_ABORTED,
 } tapasco_job_state_t;
 
+/** Device buffer passed along job graph edges; freed by the last user. **/
+struct tapasco_shared_buffer {
+  int refs; // accessed atomically
+  tapasco_handle_t handle;
+};
+typedef struct tapasco_shared_buffer tapasco_shared_buffer_t;
+
 /** Internal structure for ad-hoc data transfers. **/
 struct tapasco_transfer {
   size_t len;
@@ -56,7 +76,12 @@ struct tapasco_transfer {
   tapasco_device_alloc_flag_t flags;
   tapasco_copy_direction_flag_t dir_flags;
   tapasco_handle_t handle;
-  uint8_t preloaded;
+  uint8_t preloaded; // 1: staged by the scheduler, 2: job dispatched
+  uint8_t kept;      // 1: allocated at a previous launch of a persistent job
+  /** handle in the argument register at the last launch **/
+  tapasco_handle_t written;
+  /** buffer shared with other jobs (optional) **/
+  tapasco_shared_buffer_t *shared;
 };
 typedef struct tapasco_transfer tapasco_transfer_t;
 
@@ -66,6 +91,9 @@ typedef struct tapasco_transfer tapasco_transfer_t;
  **/
 typedef struct tapasco_jobs tapasco_jobs_t;
 
+/** Descriptor of the PEs of a kernel, @see tapasco_pemgmt_kernel. **/
+typedef struct tapasco_kernel tapasco_kernel_t;
+
 /** Initializes the internal jobs struct. */
 tapasco_res_t tapasco_jobs_init(tapasco_dev_id_t dev_id, tapasco_jobs_t **jobs);
 
@@ -91,6 +119,24 @@ void tapasco_jobs_set_kernel_id(tapasco_jobs_t *jobs,
                                 tapasco_job_id_t const j_id,
                                 tapasco_kernel_id_t const k_id);
 
+/**
+ * Returns the resolved kernel descriptor for the given job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return kernel descriptor of the kernel this job shall run at.
+ **/
+tapasco_kernel_t *tapasco_jobs_get_kernel(tapasco_jobs_t const *jobs,
+                                          tapasco_job_id_t const j_id);
+
+/**
+ * Sets the resolved kernel descriptor for the given job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param kernel kernel descriptor.
+ **/
+void tapasco_jobs_set_kernel(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                             tapasco_kernel_t *kernel);
+
 /**
  * Returns the current state of the given job.
  * @param jobs jobs context.
@@ -111,6 +157,103 @@ tapasco_job_state_t tapasco_jobs_set_state(tapasco_jobs_t *jobs,
                                            tapasco_job_id_t const j_id,
                                            tapasco_job_state_t const new_state);
 
+/**
+ * Atomically changes the state of the given job, if it is in the expected
+ * state.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param expected state the job must be in.
+ * @param desired state to set.
+ * @return non-zero, if the state was changed.
+ **/
+int tapasco_jobs_cas_state(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                           tapasco_job_state_t const expected,
+                           tapasco_job_state_t const desired);
+
+/**
+ * Aborts a job in the expected state. A job which is still held by a queue or
+ * worker thread (held != 0) is released only when both the owner and the
+ * holder have released it, @see tapasco_jobs_release.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param expected state the job must be in.
+ * @param held non-zero, if a queue or worker still holds the job.
+ * @return non-zero, if the job was aborted.
+ **/
+int tapasco_jobs_abort(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                       tapasco_job_state_t const expected, int const held);
+
+/**
+ * Makes the given job persistent: it keeps its arguments and device buffers
+ * when it has finished and can be launched again, @see tapasco_jobs_rearm.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ **/
+void tapasco_jobs_set_persistent(tapasco_jobs_t *jobs,
+                                 tapasco_job_id_t const j_id);
+
+/**
+ * Returns non-zero, if the given job is persistent.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ **/
+int tapasco_jobs_is_persistent(tapasco_jobs_t const *jobs,
+                               tapasco_job_id_t const j_id);
+
+/**
+ * Returns a finished (or failed) persistent job to the requested state, so
+ * that it can be launched again; arguments remain set.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return non-zero, if the job was rearmed.
+ **/
+int tapasco_jobs_rearm(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id);
+
+/**
+ * Returns the arguments changed since the last call and clears them.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return bit set of changed arguments.
+ **/
+uint32_t tapasco_jobs_take_dirty(tapasco_jobs_t *jobs,
+                                 tapasco_job_id_t const j_id);
+
+/**
+ * Returns the tag of the argument registers written at the last launch of a
+ * persistent job, @see tapasco_pemgmt_prepare_pe.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return tag, 0 if none.
+ **/
+uint64_t tapasco_jobs_get_tag(tapasco_jobs_t const *jobs,
+                              tapasco_job_id_t const j_id);
+
+/**
+ * Sets the tag of the argument registers written for a persistent job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param tag new tag.
+ **/
+void tapasco_jobs_set_tag(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                          uint64_t const tag);
+
+/**
+ * Records that the finish signal of the PE running the given job was received,
+ * i.e., collecting the job will not block.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ **/
+void tapasco_jobs_set_signaled(tapasco_jobs_t *jobs,
+                               tapasco_job_id_t const j_id);
+
+/**
+ * Returns non-zero, if the finish signal for the given job was received.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ **/
+int tapasco_jobs_get_signaled(tapasco_jobs_t *jobs,
+                              tapasco_job_id_t const j_id);
+
 /**
  * Returns the return value(s) of job.
  * @param jobs jobs context.
@@ -159,7 +302,8 @@ uint64_t tapasco_jobs_get_arg64(tapasco_jobs_t const *jobs,
  * @param jobs jobs context.
  * @param j_id job id.
  * @param arg_idx index of the argument to retrieve.
- * @return pointer to tapasco_transfer_t struct.
+ * @return pointer to tapasco_transfer_t struct, NULL if the argument has no
+ *         transfer attached.
  **/
 tapasco_transfer_t *tapasco_jobs_get_arg_transfer(tapasco_jobs_t *jobs,
                                                   tapasco_job_id_t const j_id,
@@ -211,6 +355,81 @@ tapasco_jobs_set_arg_transfer(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
                               tapasco_device_alloc_flag_t const flags,
                               tapasco_copy_direction_flag_t const dir_flags);
 
+/**
+ * Adds a dependency edge between two jobs: argument dst_arg of job dst receives
+ * the device buffer of transfer argument src_arg of job src. The buffer stays
+ * on the device until job src and all of its consumers have finished; dst
+ * must not be started before src has finished, @see tapasco_jobs_dec_deps.
+ * Both jobs must not have been launched yet.
+ * @param jobs jobs context.
+ * @param src producing job id.
+ * @param src_arg index of transfer argument of src.
+ * @param dst consuming job id.
+ * @param dst_arg index of argument of dst.
+ * @return TAPASCO_SUCCESS, if edge was added, an error code otherwise.
+ **/
+tapasco_res_t tapasco_jobs_add_edge(tapasco_jobs_t *jobs,
+                                    tapasco_job_id_t const src,
+                                    size_t const src_arg,
+                                    tapasco_job_id_t const dst,
+                                    size_t const dst_arg);
+
+/**
+ * Returns the number of dependent jobs of a job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return number of successors.
+ **/
+size_t tapasco_jobs_num_successors(tapasco_jobs_t const *jobs,
+                                   tapasco_job_id_t const j_id);
+
+/**
+ * Removes and returns the dependent jobs of a job; each successor is returned
+ * at most once, even if called concurrently.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param succ output array of at least TAPASCO_JOB_MAX_SUCCESSORS elements.
+ * @return number of successors in succ.
+ **/
+size_t tapasco_jobs_take_successors(tapasco_jobs_t *jobs,
+                                    tapasco_job_id_t const j_id,
+                                    tapasco_job_id_t *succ);
+
+/**
+ * Returns non-zero, if the job has unfinished predecessors or has not been
+ * launched yet, i.e., the launch token has not been consumed.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ **/
+int tapasco_jobs_has_deps(tapasco_jobs_t const *jobs,
+                          tapasco_job_id_t const j_id);
+
+/**
+ * Decrements the dependency counter of a job. A job with predecessors holds
+ * one count per incoming edge and one for its own launch; the caller which
+ * decrements to zero must start the job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return remaining count.
+ **/
+int tapasco_jobs_dec_deps(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id);
+
+/**
+ * Marks that a predecessor of the job has failed.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ **/
+void tapasco_jobs_set_deps_failed(tapasco_jobs_t *jobs,
+                                  tapasco_job_id_t const j_id);
+
+/**
+ * Returns non-zero, if a predecessor of the job has failed.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ **/
+int tapasco_jobs_deps_failed(tapasco_jobs_t const *jobs,
+                             tapasco_job_id_t const j_id);
+
 /**
  * Sets the return value of a job.
  * @param jobs jobs context.
@@ -254,12 +473,119 @@ void tapasco_jobs_set_slot(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
                            tapasco_slot_id_t const slot_id);
 
 /**
- * Reserves a job id for preparation.
+ * Returns the completion queue this job is attached to.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return completion queue, or NULL if job is collected directly.
+ **/
+tapasco_cq_t *tapasco_jobs_get_cq(tapasco_jobs_t const *jobs,
+                                  tapasco_job_id_t const j_id);
+
+/**
+ * Attaches the job to a completion queue.
  * @param jobs jobs context.
- * @return job id.
+ * @param j_id job id.
+ * @param cq completion queue (NULL to detach).
+ **/
+void tapasco_jobs_set_cq(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                         tapasco_cq_t *cq);
+
+/**
+ * Returns the completion polling budget of the job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return budget in ns, 0 if the budget of the kernel applies.
+ **/
+uint32_t tapasco_jobs_get_poll_budget(tapasco_jobs_t const *jobs,
+                                      tapasco_job_id_t const j_id);
+
+/**
+ * Sets the completion polling budget of the job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param budget_ns budget in ns (0: use budget of kernel).
+ **/
+void tapasco_jobs_set_poll_budget(tapasco_jobs_t *jobs,
+                                  tapasco_job_id_t const j_id,
+                                  uint32_t const budget_ns);
+
+/**
+ * Returns the priority class of the job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return priority class.
+ **/
+tapasco_job_priority_t tapasco_jobs_get_priority(tapasco_jobs_t const *jobs,
+                                                 tapasco_job_id_t const j_id);
+
+/**
+ * Sets the priority class of the job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param prio priority class.
+ **/
+void tapasco_jobs_set_priority(tapasco_jobs_t *jobs,
+                               tapasco_job_id_t const j_id,
+                               tapasco_job_priority_t const prio);
+
+/**
+ * Returns the deadline of the job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return deadline in ns (CLOCK_MONOTONIC), 0 if none.
+ **/
+uint64_t tapasco_jobs_get_deadline(tapasco_jobs_t const *jobs,
+                                   tapasco_job_id_t const j_id);
+
+/**
+ * Sets the deadline of the job.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param deadline_ns deadline in ns (CLOCK_MONOTONIC, 0: none).
+ **/
+void tapasco_jobs_set_deadline(tapasco_jobs_t *jobs,
+                               tapasco_job_id_t const j_id,
+                               uint64_t const deadline_ns);
+
+/**
+ * Returns the time the job was queued for a PE.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @return time in ns (CLOCK_MONOTONIC).
+ **/
+uint64_t tapasco_jobs_get_queued(tapasco_jobs_t const *jobs,
+                                 tapasco_job_id_t const j_id);
+
+/**
+ * Records the time the job was queued for a PE.
+ * @param jobs jobs context.
+ * @param j_id job id.
+ * @param queued_ns time in ns (CLOCK_MONOTONIC).
+ **/
+void tapasco_jobs_set_queued(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                             uint64_t const queued_ns);
+
+/**
+ * Reserves a job id for preparation. Free job ids are cached per thread in
+ * batches of up to TAPASCO_JOBS_MAGAZINE_SZ ids; when the pool is empty, the
+ * ids cached by all threads are returned to it before giving up.
+ * @param jobs jobs context.
+ * @return job id, or 0 if no job id is available.
  **/
 tapasco_job_id_t tapasco_jobs_acquire(tapasco_jobs_t *jobs);
 
+/**
+ * Reserves a job id for preparation, waits until one is released if none is
+ * available. While threads are waiting, released ids bypass the per-thread
+ * caches, and ids already cached by other threads are returned to the pool.
+ * @param jobs jobs context.
+ * @param deadline absolute CLOCK_MONOTONIC time to give up at, NULL to wait
+ *        indefinitely.
+ * @return job id, or 0 if deadline has passed.
+ **/
+tapasco_job_id_t tapasco_jobs_acquire_wait(tapasco_jobs_t *jobs,
+                                           struct timespec const *deadline);
+
 /**
  * Releases a previously acquired job id for re-use.
  * @param jobs jobs context.
@@ -28,6 +28,11 @@
 #include <tapasco.h>
 #include <tapasco_pemgmt.h>
 
+/** Number of buffers kept resident per local memory. */
+#ifndef TAPASCO_LOCAL_MEM_RESIDENT
+#define TAPASCO_LOCAL_MEM_RESIDENT 8
+#endif
+
 /** Forward declaration of local memory management struct (opaque). */
 typedef struct tapasco_local_mem tapasco_local_mem_t;
 
@@ -67,6 +72,52 @@ void tapasco_local_mem_dealloc(tapasco_local_mem_t *lmem,
                                tapasco_slot_id_t slot_id, tapasco_handle_t h,
                                size_t sz);
 
+/**
+ * Acquires a buffer for len bytes of host data at data in the local memory of
+ * the PE in given slot. Buffers stay resident after their release: If the
+ * memory holds an idle buffer of the same host data whose contents still match
+ * the host data, it is reused and *valid is set, i.e., the data need not be
+ * copied again. Idle buffers are evicted (least recently used first) when the
+ * memory runs full.
+ * @param lmem local memory management struct
+ * @param slot_id slot with PE to acquire local mem for
+ * @param data host data
+ * @param len number of bytes
+ * @param h output handle
+ * @param valid output flag: 1, if the buffer already holds the data
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_local_mem_acquire(tapasco_local_mem_t *lmem,
+                                        tapasco_slot_id_t const slot_id,
+                                        void const *data, size_t const len,
+                                        tapasco_handle_t *h, int *valid);
+
+/**
+ * Releases a buffer acquired with @tapasco_local_mem_acquire; the buffer stays
+ * resident in the local memory.
+ * @param lmem local memory management struct
+ * @param slot_id slot with PE the buffer was acquired for
+ * @param h handle of the buffer
+ * @param len number of bytes (must match acquisition)
+ * @param contents current device contents of the buffer (a copy is kept), NULL
+ *        if unknown
+ **/
+void tapasco_local_mem_release(tapasco_local_mem_t *lmem,
+                               tapasco_slot_id_t const slot_id,
+                               tapasco_handle_t const h, size_t const len,
+                               void const *contents);
+
+/**
+ * Returns the slot of the local memory holding an idle resident buffer of the
+ * given host data.
+ * @param lmem local memory management struct
+ * @param data host data
+ * @param len number of bytes
+ * @return slot id of the memory, TAPASCO_NUM_SLOTS if not resident anywhere
+ **/
+tapasco_slot_id_t tapasco_local_mem_find(tapasco_local_mem_t *lmem,
+                                         void const *data, size_t const len);
+
 /**
  * Returns the number of bytes of memory in given slot id.
  * @param lmem local memory management struct
@@ -95,4 +146,14 @@ size_t tapasco_local_mem_get_free(tapasco_local_mem_t *lmem,
 tapasco_slot_id_t tapasco_local_mem_get_slot(tapasco_devctx_t *devctx,
                                              tapasco_slot_id_t slot_id);
 
+/**
+ * Returns the slot of the local memory attached to the PE in given slot, i.e.,
+ * the memory in the slot following the PE.
+ * @param devctx device context
+ * @param slot_id slot of the PE
+ * @return slot id of the memory, TAPASCO_NUM_SLOTS if the PE has none
+ **/
+tapasco_slot_id_t tapasco_local_mem_of_pe(tapasco_devctx_t const *devctx,
+                                          tapasco_slot_id_t const slot_id);
+
 #endif /* TAPASCO_LOCAL_MEM_H__ */
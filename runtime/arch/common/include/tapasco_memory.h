@@ -27,7 +27,9 @@
 #include <tapasco_types.h>
 
 /**
- * Allocates a chunk of len bytes on the device.
+ * Allocates a chunk of len bytes on the device. If device memory is
+ * exhausted, idle buffers of the buffer pool are freed and the allocation is
+ * retried.
  * @param dev_ctx device context
  * @param h output parameter to write the handle to
  * @param len size in bytes
@@ -51,12 +53,20 @@ void tapasco_device_free(tapasco_devctx_t *dev_ctx, tapasco_handle_t handle,
 
 /**
  * Copys memory from main memory to the FPGA device.
+ * With TAPASCO_DEVICE_COPY_NONBLOCKING, the copy is run by a transfer worker
+ * thread and the call returns at once; the last variadic argument must be a
+ * tapasco_copy_id_t * receiving the id of the copy (after the slot id of
+ * PE-local copies). src must remain valid until the copy has finished, @see
+ * tapasco_device_copy_wait.
  * @param dev_ctx device context
  * @param src source address
  * @param dst destination device handle (prev. alloc'ed with tapasco_alloc)
  * @param len number of bytes to copy
- * @param flags	flags for copy operation, e.g., TAPASCO_COPY_NONBLOCKING
- * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
+ * @param flags	flags for copy operation, e.g., TAPASCO_DEVICE_COPY_NONBLOCKING
+ * @return TAPASCO_SUCCESS if copy was successful (or scheduled, if
+ *         nonblocking), TAPASCO_ERR_COPY_BUSY if too many nonblocking copies
+ *         are in flight, TAPASCO_ERR_INVALID_ARG if nonblocking without copy
+ *         id, an error code otherwise
  **/
 tapasco_res_t tapasco_device_copy_to(tapasco_devctx_t *dev_ctx, void const *src,
                                      tapasco_handle_t dst, size_t len,
@@ -65,12 +75,20 @@ tapasco_res_t tapasco_device_copy_to(tapasco_devctx_t *dev_ctx, void const *src,
 
 /**
  * Copys memory from FPGA device memory to main memory.
+ * With TAPASCO_DEVICE_COPY_NONBLOCKING, the copy is run by a transfer worker
+ * thread and the call returns at once; the last variadic argument must be a
+ * tapasco_copy_id_t * receiving the id of the copy (after the slot id of
+ * PE-local copies). dst is valid after the copy has finished, @see
+ * tapasco_device_copy_wait.
  * @param dev_ctx device context
  * @param src source device handle (prev. alloc'ed with tapasco_alloc)
  * @param dst destination address
  * @param len number of bytes to copy
- * @param flags	flags for copy operation, e.g., TAPASCO_COPY_NONBLOCKING
- * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
+ * @param flags	flags for copy operation, e.g., TAPASCO_DEVICE_COPY_NONBLOCKING
+ * @return TAPASCO_SUCCESS if copy was successful (or scheduled, if
+ *         nonblocking), TAPASCO_ERR_COPY_BUSY if too many nonblocking copies
+ *         are in flight, TAPASCO_ERR_INVALID_ARG if nonblocking without copy
+ *         id, an error code otherwise
  **/
 tapasco_res_t tapasco_device_copy_from(tapasco_devctx_t *dev_ctx,
                                        tapasco_handle_t src, void *dst,
@@ -84,7 +102,8 @@ tapasco_res_t tapasco_device_copy_from(tapasco_devctx_t *dev_ctx,
  * @param src source data pointer
  * @param dst destination device handle
  * @param len number of bytes to copy
- * @param flags	flags for copy operation, e.g., TAPASCO_COPY_NONBLOCKING
+ * @param flags	flags for copy operation (copy is always blocking;
+ *              TAPASCO_DEVICE_COPY_NONBLOCKING is handled by the caller)
  * @param slot_id PE-local memory slot
  * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
  **/
@@ -100,7 +119,8 @@ tapasco_device_copy_to_local(tapasco_devctx_t *dev_ctx, void const *src,
  * @param src source device handle
  * @param dst destination data pointer
  * @param len number of bytes to copy
- * @param flags	flags for copy operation, e.g., TAPASCO_COPY_NONBLOCKING
+ * @param flags	flags for copy operation (copy is always blocking;
+ *              TAPASCO_DEVICE_COPY_NONBLOCKING is handled by the caller)
  * @param slot_id PE-local memory slot
  * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
  **/
@@ -25,8 +25,17 @@
 #define TAPASCO_PEMGMT_H__
 
 #include <tapasco_global.h>
+#include <tapasco_jobs.h>
 #include <tapasco_types.h>
 
+/** Returned by @see tapasco_pemgmt_acquire_pe if the job was queued. */
+#define TAPASCO_PEMGMT_JOB_QUEUED ((tapasco_slot_id_t)-1)
+
+/** Every n-th PE handover serves the priority classes in reverse order. */
+#ifndef TAPASCO_PEMGMT_AGING
+#define TAPASCO_PEMGMT_AGING 8
+#endif
+
 /** Implementation defined functions struct. (opaque) */
 typedef struct tapasco_pemgmt tapasco_pemgmt_t;
 
@@ -55,22 +64,197 @@ void tapasco_pemgmt_setup_system(tapasco_devctx_t *dev_ctx,
                                  tapasco_pemgmt_t *ctx);
 
 /**
- * Reserves a slot containing an instance of the given function (if possible).
+ * Resolves a kernel id to the descriptor of its PEs; the descriptor is valid
+ * until the functions context is released.
  * @param ctx functions context.
  * @param k_id function identifier.
- * @return slot_id >= 0 if successful, < 0 otherwise.
+ * @return kernel descriptor, or NULL if kernel is not instantiated.
  **/
-tapasco_slot_id_t tapasco_pemgmt_acquire_pe(tapasco_pemgmt_t *ctx,
-                                            tapasco_kernel_id_t const k_id);
+tapasco_kernel_t *tapasco_pemgmt_kernel(tapasco_pemgmt_t const *ctx,
+                                        tapasco_kernel_id_t const k_id);
 
 /**
- * Releases a previously acquired slot.
+ * Reserves a slot containing an instance of the given function for a job. If
+ * no instance is available, the job is put into the run queue of its priority
+ * class (or by deadline) and will be dispatched by
+ * @see tapasco_pemgmt_hand_over; never blocks. With shared access, PEs are
+ * arbitrated between processes by the device driver instead: the call blocks
+ * until a PE is granted and returns TAPASCO_NUM_SLOTS on failure.
  * @param ctx functions context.
+ * @param kernel kernel descriptor, @see tapasco_pemgmt_kernel.
+ * @param j_id job id to queue if no PE is available.
+ * @param near slot of the local memory holding the job's data: an available
+ *        PE attached to it is preferred (TAPASCO_NUM_SLOTS: no preference).
+ * @return slot_id if successful, TAPASCO_PEMGMT_JOB_QUEUED if job was queued.
+ **/
+tapasco_slot_id_t tapasco_pemgmt_acquire_pe(tapasco_pemgmt_t *ctx,
+                                            tapasco_kernel_t *kernel,
+                                            tapasco_job_id_t const j_id,
+                                            tapasco_slot_id_t const near);
+
+/**
+ * Releases a previously acquired slot. If jobs are waiting for the kernel,
+ * the PE is passed to the staging thread of the scheduler, which hands it over
+ * (@see tapasco_pemgmt_hand_over); the caller does not dispatch other jobs.
+ * With shared access, the PE is returned to the device driver.
+ * @param dev_ctx device context.
  * @param s_id slot identifier.
  */
-void tapasco_pemgmt_release_pe(tapasco_pemgmt_t *ctx,
+void tapasco_pemgmt_release_pe(tapasco_devctx_t *dev_ctx,
                                tapasco_slot_id_t const s_id);
 
+/**
+ * Hands a released PE over to the waiting job with the earliest deadline, or
+ * else to the first job of the highest priority class, and dispatches it.
+ * Every TAPASCO_PEMGMT_AGING-th handover serves the lowest class first
+ * instead, so that no class starves. Jobs failing to dispatch are posted to
+ * their completion queue and the next waiting job is tried; the PE becomes
+ * available again when no job is left. Called by the staging thread only.
+ * @param dev_ctx device context.
+ * @param s_id slot identifier.
+ */
+void tapasco_pemgmt_hand_over(tapasco_devctx_t *dev_ctx,
+                              tapasco_slot_id_t const s_id);
+
+/**
+ * Dispatches a job on an acquired PE: prepares and starts the PE. On failure
+ * the job is set to TAPASCO_JOB_STATE_FAILED, but the PE is not released.
+ * Jobs cancelled while waiting for the PE are dropped: their buffers are freed
+ * and the reference of the dispatching thread is released, i.e., the job id
+ * must not be used by the caller afterwards.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ * @param slot_id id of the slot.
+ * @return TAPASCO_SUCCESS if successful, TAPASCO_ERR_JOB_ABORTED if the job
+ *         was cancelled, an error code otherwise.
+ **/
+tapasco_res_t tapasco_pemgmt_dispatch(tapasco_devctx_t *dev_ctx,
+                                      tapasco_job_id_t const j_id,
+                                      tapasco_slot_id_t const slot_id);
+
+/**
+ * Marks a job as failed and wakes up threads waiting for its dispatch. Jobs
+ * with dependent jobs are handed to the scheduler to fail those, too.
+ * Cancelled jobs stay aborted.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ **/
+void tapasco_pemgmt_fail_job(tapasco_devctx_t *dev_ctx,
+                             tapasco_job_id_t const j_id);
+
+/**
+ * Waits until a queued job has been dispatched to a PE (or failed, or was
+ * cancelled).
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ * @param deadline absolute time to give up at (CLOCK_MONOTONIC, NULL: never).
+ * @return state of the job after dispatch, TAPASCO_JOB_STATE_SCHEDULED on
+ *         timeout.
+ **/
+tapasco_job_state_t
+tapasco_pemgmt_wait_dispatched(tapasco_devctx_t *dev_ctx,
+                               tapasco_job_id_t const j_id,
+                               struct timespec const *deadline);
+
+/**
+ * Marks a running job as finished and wakes up threads waiting for it.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ * @return non-zero, if the job was finished; 0 if it was cancelled.
+ **/
+int tapasco_pemgmt_finish_job(tapasco_devctx_t *dev_ctx,
+                              tapasco_job_id_t const j_id);
+
+/**
+ * Waits until a job has finished (or failed, or was cancelled), for jobs which
+ * are completed by the scheduler, @see tapasco_scheduler_post_completed.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ * @param deadline absolute time to give up at (CLOCK_MONOTONIC, NULL: never).
+ * @return final state of the job, current state on timeout.
+ **/
+tapasco_job_state_t
+tapasco_pemgmt_wait_finished(tapasco_devctx_t *dev_ctx,
+                             tapasco_job_id_t const j_id,
+                             struct timespec const *deadline);
+
+/**
+ * Records that the finish signal of the PE running the given job was received
+ * and wakes up threads waiting for ready jobs.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ **/
+void tapasco_pemgmt_signal_job(tapasco_devctx_t *dev_ctx,
+                               tapasco_job_id_t const j_id);
+
+/**
+ * Returns non-zero, if the given job has finished, failed or was cancelled,
+ * i.e., collecting it will not block.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ **/
+int tapasco_pemgmt_job_ready(tapasco_devctx_t *dev_ctx,
+                             tapasco_job_id_t const j_id);
+
+/**
+ * Waits until at least min_ready of the given jobs are ready, @see
+ * tapasco_pemgmt_job_ready.
+ * @param dev_ctx device context.
+ * @param num_jobs number of jobs in j_ids.
+ * @param j_ids job ids.
+ * @param min_ready number of ready jobs to wait for (0: do not wait).
+ * @param ready output array for the ready job ids (num_jobs elements).
+ * @param deadline absolute time to give up at (CLOCK_MONOTONIC, NULL: never).
+ * @return number of ready jobs, less than min_ready on timeout.
+ **/
+size_t tapasco_pemgmt_wait_ready(tapasco_devctx_t *dev_ctx,
+                                 size_t const num_jobs,
+                                 tapasco_job_id_t const *j_ids,
+                                 size_t const min_ready,
+                                 tapasco_job_id_t *ready,
+                                 struct timespec const *deadline);
+
+/**
+ * Records the job running on the PE in the given slot.
+ * @param ctx functions context.
+ * @param s_id slot identifier.
+ * @param j_id job id (0 if idle).
+ **/
+void tapasco_pemgmt_set_job(tapasco_pemgmt_t *ctx,
+                            tapasco_slot_id_t const s_id,
+                            tapasco_job_id_t const j_id);
+
+/**
+ * Takes the PE in the given slot off its job, if it is still running j_id:
+ * either the thread completing the job or a thread cancelling it succeeds.
+ * @param ctx functions context.
+ * @param s_id slot identifier.
+ * @param j_id job id.
+ * @return non-zero, if the caller has claimed the job.
+ **/
+int tapasco_pemgmt_claim_job(tapasco_pemgmt_t *ctx,
+                             tapasco_slot_id_t const s_id,
+                             tapasco_job_id_t const j_id);
+
+/**
+ * Frees the buffers of a job cancelled while it was running on the PE in the
+ * given slot, once the PE cannot access them any more, i.e., it has finished
+ * or the device is reset.
+ * @param dev_ctx device context.
+ * @param s_id slot identifier.
+ **/
+void tapasco_pemgmt_free_quarantined(tapasco_devctx_t *dev_ctx,
+                                     tapasco_slot_id_t const s_id);
+
+/**
+ * Returns the job running on the PE in the given slot.
+ * @param ctx functions context.
+ * @param s_id slot identifier.
+ * @return job id, or 0 if slot is idle or empty.
+ **/
+tapasco_job_id_t tapasco_pemgmt_get_job(tapasco_pemgmt_t *ctx,
+                                        tapasco_slot_id_t const s_id);
+
 /**
  * Returns the number of available instances of the kernel with the given
  * function identifier.
@@ -81,6 +265,23 @@ void tapasco_pemgmt_release_pe(tapasco_pemgmt_t *ctx,
 size_t tapasco_pemgmt_count(tapasco_pemgmt_t const *ctx,
                             tapasco_kernel_id_t const k_id);
 
+/**
+ * Returns the number of available PEs of a kernel minus the number of jobs
+ * waiting for one, i.e., -n if n jobs are queued.
+ * @param kernel kernel descriptor.
+ **/
+long tapasco_pemgmt_credits(tapasco_kernel_t *kernel);
+
+/**
+ * Returns the completion polling budget of the kernel of the PE in the given
+ * slot, @see tapasco_device_kernel_set_poll_budget.
+ * @param ctx functions context.
+ * @param s_id slot identifier.
+ * @return budget in ns (0 if polling is disabled).
+ **/
+uint32_t tapasco_pemgmt_get_poll_budget(tapasco_pemgmt_t const *ctx,
+                                        tapasco_slot_id_t const s_id);
+
 /**
  * Prepares the given job for the execution of the job by transferring
  * all arguments and set PE registers.
@@ -104,7 +305,9 @@ tapasco_res_t tapasco_pemgmt_start_pe(tapasco_devctx_t *dev_ctx,
 /**
  * Bottom half of job launch: Retrieves the arguments for the given
  * job from the registers of the PE it was assigned to. Then releases
- * the PE and sets the job to finished.
+ * the PE and copies back the output transfers, i.e., the next job may
+ * already run on the PE while the outputs are transferred. Waiting jobs
+ * are dispatched by the staging thread, not by the caller.
  * @param dev_ctx device context.
  * @param j_id job id.
  * @return TAPASCO_SUCCESS if successful, an error code otherwise.
@@ -36,9 +36,34 @@
   _PC(pe_high_watermark)                                                       \
   _PC(jobs_launched)                                                           \
   _PC(jobs_completed)                                                          \
+  _PC(jobs_queued)                                                             \
   _PC(pe_acquired)                                                             \
   _PC(pe_released)                                                             \
-  _PC(waiting_for_job)
+  _PC(waiting_for_job)                                                         \
+  _PC(poll_hits)                                                               \
+  _PC(poll_misses)                                                             \
+  _PC(job_ids_exhausted)                                                       \
+  _PC(lmem_resident_hits)                                                      \
+  _PC(staging_budget_kib)                                                      \
+  _PC(staged_kib)                                                              \
+  _PC(staging_deferred)                                                        \
+  _PC(queued_high)                                                             \
+  _PC(queued_normal)                                                           \
+  _PC(queued_low)                                                              \
+  _PC(queue_us_high)                                                           \
+  _PC(queue_us_normal)                                                         \
+  _PC(queue_us_low)                                                            \
+  _PC(deadline_misses)                                                         \
+  _PC(cpu_jobs)                                                                \
+  _PC(jobs_timed_out)                                                          \
+  _PC(jobs_cancelled)                                                          \
+  _PC(pe_quarantined)                                                          \
+  _PC(jobs_relaunched)                                                          \
+  _PC(bufpool_hits)                                                            \
+  _PC(bufpool_misses)                                                          \
+  _PC(bufpool_trimmed)                                                         \
+  _PC(bufpool_idle_kib)                                                        \
+  _PC(copies_nonblocking)
 
 #ifndef NPERFC
 const char *tapasco_perfc_tostring(tapasco_dev_id_t const dev_id);
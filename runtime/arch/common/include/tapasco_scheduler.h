@@ -27,8 +27,42 @@
 #include <tapasco_pemgmt.h>
 #include <tapasco_types.h>
 
+/** Max. number of pipelined jobs per kernel staged ahead of a free PE. */
+#ifndef TAPASCO_SCHEDULER_STAGING_DEPTH
+#define TAPASCO_SCHEDULER_STAGING_DEPTH 2
+#endif
+
+/** Default max. number of bytes preloaded for jobs waiting for a PE. */
+#ifndef TAPASCO_SCHEDULER_STAGING_BUDGET
+#define TAPASCO_SCHEDULER_STAGING_BUDGET (256UL << 20)
+#endif
+
+/** Scheduler state (opaque). */
+typedef struct tapasco_scheduler tapasco_scheduler_t;
+
+/**
+ * Initializes the scheduler of a device and starts its staging and completion
+ * threads.
+ * @param dev_ctx device context.
+ * @param scheduler output pointer to initialize.
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+ **/
+tapasco_res_t tapasco_scheduler_init(tapasco_devctx_t *dev_ctx,
+                                     tapasco_scheduler_t **scheduler);
+
+/**
+ * Stops the scheduler threads and releases the scheduler.
+ * @param scheduler scheduler to release.
+ **/
+void tapasco_scheduler_deinit(tapasco_scheduler_t *scheduler);
+
 /**
- * Schedule a job for execution on the hardware threadpool.
+ * Schedule a job for execution on the hardware threadpool. Jobs with
+ * unfinished predecessors are held back and started in pipelined mode by the
+ * scheduler when the last predecessor has finished. Transfers are preloaded
+ * only while the memory preloaded for jobs waiting for a PE stays within the
+ * staging budget, @see tapasco_device_set_staging_budget; otherwise they are
+ * allocated when the job is dispatched.
  * @param dev_ctx device context.
  * @param j_id job id.
  * @return TAPASCO_SUCCESS, if job could be scheduled and will execute, an error
@@ -37,14 +71,90 @@
 tapasco_res_t tapasco_scheduler_launch(tapasco_devctx_t *dev_ctx,
                                        tapasco_job_id_t const j_id);
 
+/**
+ * Notifies the scheduler that a job has been dispatched to a PE: its
+ * preloaded transfers no longer count against the staging budget.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ **/
+void tapasco_scheduler_job_dispatched(tapasco_devctx_t *dev_ctx,
+                                      tapasco_job_id_t const j_id);
+
+/**
+ * Schedule a job for pipelined execution: the job is handed over to the
+ * staging thread, which preloads its transfers while previous jobs are still
+ * running, then dispatches or queues it. At most
+ * TAPASCO_SCHEDULER_STAGING_DEPTH jobs per kernel are staged ahead of a free
+ * PE; further jobs of the kernel are held back, while jobs of other kernels
+ * are staged. Returns immediately.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ * @return TAPASCO_SUCCESS, if job was handed over to the stager.
+ **/
+tapasco_res_t tapasco_scheduler_launch_pipelined(tapasco_devctx_t *dev_ctx,
+                                                 tapasco_job_id_t const j_id);
+
+/**
+ * Schedule a batch of jobs for execution on the hardware threadpool: transfers
+ * of all jobs are preloaded first (within the staging budget), then each job
+ * in order is parked until its predecessors have finished, handed to the CPU
+ * or started on a PE. Stops at the first job that could not be launched: it
+ * and all later jobs are not launched, their preloaded buffers are freed
+ * again, and their successors fail.
+ * @param dev_ctx device context.
+ * @param num_jobs number of jobs in j_ids.
+ * @param j_ids array of job ids.
+ * @param num_launched output: number of jobs launched successfully (optional).
+ * @return TAPASCO_SUCCESS, if all jobs could be scheduled, an error code
+ *otherwise.
+ **/
+tapasco_res_t tapasco_scheduler_launch_batch(tapasco_devctx_t *dev_ctx,
+                                             size_t const num_jobs,
+                                             tapasco_job_id_t const *j_ids,
+                                             size_t *num_launched);
+
 /**
  * Wait for given job and fetch results.
  * @param dev_ctx device context.
  * @param j_id job id.
- * @return TAPASCO_SUCCESS, if job could be scheduled and will execute, an error
- *code otherwise.
+ * @param deadline absolute time to give up at (CLOCK_MONOTONIC, NULL: never).
+ * @return TAPASCO_SUCCESS, if job could be scheduled and will execute,
+ *TAPASCO_ERR_TIMEOUT if it has not finished before the deadline,
+ *TAPASCO_ERR_JOB_ABORTED if it was cancelled, an error code otherwise.
  **/
 tapasco_res_t tapasco_scheduler_finish_job(tapasco_devctx_t *dev_ctx,
-                                           tapasco_job_id_t const j_id);
+                                           tapasco_job_id_t const j_id,
+                                           struct timespec const *deadline);
+
+/**
+ * Fetch results of a job whose PE has already signaled completion, e.g., a job
+ * reaped from a completion queue, and release the PE.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ * @return TAPASCO_SUCCESS, if results could be retrieved, an error code
+ *otherwise.
+ **/
+tapasco_res_t tapasco_scheduler_complete_job(tapasco_devctx_t *dev_ctx,
+                                             tapasco_job_id_t const j_id);
+
+/**
+ * Hands a job with dependent jobs over to the completion thread, once its PE
+ * has signaled completion or it has failed: the thread fetches its results,
+ * passes its buffers on and starts the dependent jobs, then posts the job to
+ * its completion queue (if any) or wakes up threads collecting it.
+ * @param dev_ctx device context.
+ * @param j_id job id.
+ **/
+void tapasco_scheduler_post_completed(tapasco_devctx_t *dev_ctx,
+                                      tapasco_job_id_t const j_id);
+
+/**
+ * Hands a released PE over to the staging thread, which dispatches the jobs
+ * waiting for its kernel, @see tapasco_pemgmt_hand_over.
+ * @param dev_ctx device context.
+ * @param s_id slot identifier.
+ **/
+void tapasco_scheduler_post_handover(tapasco_devctx_t *dev_ctx,
+                                     tapasco_slot_id_t const s_id);
 
 #endif /* TAPASCO_SCHEDULER_H__ */
@@ -0,0 +1,279 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/** @file tapasco_bufpool.c
+ *  @brief  Pool of device buffers for delayed transfers.
+ *  @author Embedded Systems and Applications Group, TU Darmstadt
+ **/
+#include <platform.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <tapasco_bufpool.h>
+#include <tapasco_device.h>
+#include <tapasco_logging.h>
+#include <tapasco_memory.h>
+#include <tapasco_perfc.h>
+
+/* Size classes: four per power of two from 1 KiB to 256 MiB, i.e., buffers
+ * are at most 25% larger than requested; larger buffers are not pooled. */
+#define MIN_LOG2 10
+#define MAX_LOG2 28
+#define NUM_CLASSES ((MAX_LOG2 - MIN_LOG2) * 4 + 1)
+
+/* Idle buffer, in the list of its size class and in the LRU list. */
+struct idle_buf {
+  tapasco_handle_t h;
+  int c;
+  struct idle_buf *prev, *next;         // size class list, newest first
+  struct idle_buf *lru_prev, *lru_next; // all idle buffers, newest first
+};
+
+struct tapasco_bufpool {
+  tapasco_devctx_t *devctx;
+  pthread_mutex_t mtx;
+  size_t low, high; // watermarks
+  size_t idle;      // bytes in idle buffers
+  size_t num_idle;
+  uint64_t hits, misses, trimmed;
+  struct idle_buf *cls[NUM_CLASSES];
+  struct idle_buf lru; // sentinel: lru.lru_next newest, lru.lru_prev oldest
+  struct idle_buf *spare;
+};
+
+static inline int size_class(size_t const len) {
+  if (len <= (1UL << MIN_LOG2))
+    return 0;
+  size_t const n = len - 1;
+  int const f = 63 - __builtin_clzl(n);
+  if (f >= MAX_LOG2)
+    return NUM_CLASSES;
+  return (f - MIN_LOG2) * 4 + (int)((n >> (f - 2)) & 3) + 1;
+}
+
+static inline size_t class_size(int const c) {
+  if (!c)
+    return 1UL << MIN_LOG2;
+  return (size_t)(4 + (c - 1) % 4 + 1) << ((c - 1) / 4 + MIN_LOG2 - 2);
+}
+
+/* Size of the device buffer allocated for len bytes. */
+static inline size_t buf_size(size_t const len) {
+  int const c = size_class(len);
+  return c < NUM_CLASSES ? class_size(c) : len;
+}
+
+static void unlink_buf(tapasco_bufpool_t *pool, struct idle_buf *b) {
+  if (b->prev)
+    b->prev->next = b->next;
+  else
+    pool->cls[b->c] = b->next;
+  if (b->next)
+    b->next->prev = b->prev;
+  b->lru_prev->lru_next = b->lru_next;
+  b->lru_next->lru_prev = b->lru_prev;
+  pool->idle -= class_size(b->c);
+  --pool->num_idle;
+}
+
+/* Takes the oldest buffers off the pool until at most max bytes are idle and
+ * returns them as a list; needs pool->mtx. */
+static struct idle_buf *take_oldest(tapasco_bufpool_t *pool, size_t max) {
+  struct idle_buf *l = NULL;
+  while (pool->idle > max) {
+    struct idle_buf *b = pool->lru.lru_prev;
+    unlink_buf(pool, b);
+    b->next = l;
+    l = b;
+    ++pool->trimmed;
+  }
+  return l;
+}
+
+/* Pooled buffers bypass the thread caches of the platform: idle memory is
+ * kept by the pool only, and trimming returns it to the allocator. */
+static tapasco_res_t alloc_buf(tapasco_bufpool_t *pool, tapasco_handle_t *h,
+                               size_t const sz) {
+  platform_mem_addr_t addr;
+  platform_res_t const r = platform_alloc(pool->devctx->pdctx, sz, &addr,
+                                          PLATFORM_ALLOC_FLAGS_UNCACHED);
+  if (r != PLATFORM_SUCCESS) {
+    DEVLOG(pool->devctx->id, LALL_MEM,
+           "could not allocate %zu bytes of device memory: %s (" PRIres ")",
+           sz, platform_strerror(r), r);
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  }
+  *h = addr;
+  return TAPASCO_SUCCESS;
+}
+
+static inline void free_buf(tapasco_bufpool_t *pool, tapasco_handle_t const h,
+                            size_t const sz) {
+  platform_dealloc(pool->devctx->pdctx, h, sz, PLATFORM_ALLOC_FLAGS_UNCACHED);
+}
+
+/* Frees the device memory of a list of buffers and recycles them. */
+static void free_bufs(tapasco_bufpool_t *pool, struct idle_buf *l) {
+  if (!l)
+    return;
+  struct idle_buf *last = l;
+  size_t n = 0;
+  for (struct idle_buf *b = l; b; b = b->next, ++n) {
+    free_buf(pool, b->h, class_size(b->c));
+    last = b;
+  }
+  DEVLOG(pool->devctx->id, LALL_MEM, "trimmed %zu idle buffers", n);
+  tapasco_perfc_bufpool_trimmed_add(pool->devctx->id, n);
+  pthread_mutex_lock(&pool->mtx);
+  last->next = pool->spare;
+  pool->spare = l;
+  tapasco_perfc_bufpool_idle_kib_set(pool->devctx->id, pool->idle >> 10);
+  pthread_mutex_unlock(&pool->mtx);
+}
+
+tapasco_res_t tapasco_bufpool_init(tapasco_devctx_t *devctx,
+                                   tapasco_bufpool_t **pool) {
+  *pool = (tapasco_bufpool_t *)calloc(sizeof(**pool), 1);
+  if (!*pool)
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  (*pool)->devctx = devctx;
+  (*pool)->low = TAPASCO_BUFPOOL_LOW_WATERMARK;
+  (*pool)->high = TAPASCO_BUFPOOL_HIGH_WATERMARK;
+  (*pool)->lru.lru_prev = (*pool)->lru.lru_next = &(*pool)->lru;
+  pthread_mutex_init(&(*pool)->mtx, NULL);
+  return TAPASCO_SUCCESS;
+}
+
+void tapasco_bufpool_deinit(tapasco_bufpool_t *pool) {
+  if (!pool)
+    return;
+  tapasco_bufpool_trim(pool);
+  while (pool->spare) {
+    struct idle_buf *b = pool->spare;
+    pool->spare = b->next;
+    free(b);
+  }
+  pthread_mutex_destroy(&pool->mtx);
+  free(pool);
+}
+
+tapasco_res_t tapasco_bufpool_get(tapasco_bufpool_t *pool, tapasco_handle_t *h,
+                                  size_t const len) {
+  int const c = size_class(len);
+  if (c < NUM_CLASSES) {
+    pthread_mutex_lock(&pool->mtx);
+    struct idle_buf *b = pool->cls[c];
+    if (b) {
+      unlink_buf(pool, b);
+      *h = b->h;
+      b->next = pool->spare;
+      pool->spare = b;
+      ++pool->hits;
+      tapasco_perfc_bufpool_idle_kib_set(pool->devctx->id, pool->idle >> 10);
+      pthread_mutex_unlock(&pool->mtx);
+      tapasco_perfc_bufpool_hits_inc(pool->devctx->id);
+      return TAPASCO_SUCCESS;
+    }
+    ++pool->misses;
+    pthread_mutex_unlock(&pool->mtx);
+    tapasco_perfc_bufpool_misses_inc(pool->devctx->id);
+  }
+  size_t const sz = buf_size(len);
+  tapasco_res_t res = alloc_buf(pool, h, sz);
+  // idle buffers of other sizes may block the allocation
+  if (res == TAPASCO_ERR_OUT_OF_MEMORY && tapasco_bufpool_trim(pool))
+    res = alloc_buf(pool, h, sz);
+  return res;
+}
+
+void tapasco_bufpool_put(tapasco_bufpool_t *pool, tapasco_handle_t const h,
+                         size_t const len) {
+  int const c = size_class(len);
+  struct idle_buf *b = NULL;
+  pthread_mutex_lock(&pool->mtx);
+  if (c < NUM_CLASSES && class_size(c) <= pool->high) {
+    if ((b = pool->spare))
+      pool->spare = b->next;
+    else
+      b = (struct idle_buf *)malloc(sizeof(*b));
+  }
+  if (!b) {
+    pthread_mutex_unlock(&pool->mtx);
+    free_buf(pool, h, buf_size(len));
+    return;
+  }
+  b->h = h;
+  b->c = c;
+  b->prev = NULL;
+  b->next = pool->cls[c];
+  if (b->next)
+    b->next->prev = b;
+  pool->cls[c] = b;
+  b->lru_prev = &pool->lru;
+  b->lru_next = pool->lru.lru_next;
+  b->lru_next->lru_prev = b;
+  pool->lru.lru_next = b;
+  pool->idle += class_size(c);
+  ++pool->num_idle;
+  struct idle_buf *l =
+      pool->idle > pool->high ? take_oldest(pool, pool->low) : NULL;
+  tapasco_perfc_bufpool_idle_kib_set(pool->devctx->id, pool->idle >> 10);
+  pthread_mutex_unlock(&pool->mtx);
+  free_bufs(pool, l);
+}
+
+size_t tapasco_bufpool_trim(tapasco_bufpool_t *pool) {
+  pthread_mutex_lock(&pool->mtx);
+  size_t const n = pool->num_idle;
+  struct idle_buf *l = take_oldest(pool, 0);
+  pthread_mutex_unlock(&pool->mtx);
+  free_bufs(pool, l);
+  return n;
+}
+
+tapasco_res_t tapasco_device_set_buffer_pool(tapasco_devctx_t *devctx,
+                                             size_t const low_watermark,
+                                             size_t const high_watermark) {
+  tapasco_bufpool_t *pool = devctx->bufpool;
+  DEVLOG(devctx->id, LALL_MEM, "buffer pool watermarks %zu - %zu bytes",
+         low_watermark, high_watermark);
+  pthread_mutex_lock(&pool->mtx);
+  pool->high = high_watermark;
+  pool->low = low_watermark < high_watermark ? low_watermark : high_watermark;
+  struct idle_buf *l =
+      pool->idle > pool->high ? take_oldest(pool, pool->low) : NULL;
+  pthread_mutex_unlock(&pool->mtx);
+  free_bufs(pool, l);
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t
+tapasco_device_buffer_pool_stats(tapasco_devctx_t *devctx,
+                                 tapasco_buffer_pool_stats_t *stats) {
+  tapasco_bufpool_t *pool = devctx->bufpool;
+  pthread_mutex_lock(&pool->mtx);
+  stats->low_watermark = pool->low;
+  stats->high_watermark = pool->high;
+  stats->idle_bytes = pool->idle;
+  stats->idle_buffers = pool->num_idle;
+  stats->hits = pool->hits;
+  stats->misses = pool->misses;
+  stats->trimmed = pool->trimmed;
+  pthread_mutex_unlock(&pool->mtx);
+  return TAPASCO_SUCCESS;
+}
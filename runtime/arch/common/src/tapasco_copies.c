@@ -0,0 +1,231 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/** @file tapasco_copies.c
+ *  @brief  Nonblocking copies run by transfer worker threads.
+ *  @author Embedded Systems and Applications Group, TU Darmstadt
+ **/
+#include <assert.h>
+#include <errno.h>
+#include <gen_queue.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tapasco_copies.h>
+#include <tapasco_device.h>
+#include <tapasco_errors.h>
+#include <tapasco_logging.h>
+#include <tapasco_perfc.h>
+
+/* Copy in flight; ids of a record differ by multiples of TAPASCO_COPIES_MAX. */
+struct copy {
+  _Atomic tapasco_copy_id_t id; // 0: unused
+  _Atomic int done;
+  tapasco_res_t res;
+  int to_device;
+  void *host;
+  tapasco_handle_t h;
+  size_t len;
+  tapasco_device_copy_flag_t flags;
+  tapasco_slot_id_t slot_id;
+  tapasco_copy_id_t next_id; // id of the next use of the record
+  struct copy *next;         // free list
+};
+
+struct tapasco_copies {
+  tapasco_devctx_t *devctx;
+  pthread_mutex_t mtx;     // free list, workers and completion
+  pthread_cond_t finished; // signalled when a copy has finished
+  struct copy copy[TAPASCO_COPIES_MAX];
+  struct copy *free;
+  size_t num_workers;
+  pthread_t worker[TAPASCO_COPIES_WORKERS];
+  sem_t pending;          // count copies to run
+  struct gq_t *pending_q; // copies to run
+  _Atomic int stop;
+};
+
+static inline struct copy *lookup(tapasco_copies_t *cp,
+                                  tapasco_copy_id_t const copy_id) {
+  return copy_id ? &cp->copy[(copy_id - 1) % TAPASCO_COPIES_MAX] : NULL;
+}
+
+static void run_copy(tapasco_copies_t *cp, struct copy *c) {
+  tapasco_devctx_t *devctx = cp->devctx;
+  tapasco_res_t const r =
+      c->to_device ? tapasco_device_copy_to(devctx, c->host, c->h, c->len,
+                                            c->flags, c->slot_id)
+                   : tapasco_device_copy_from(devctx, c->h, c->host, c->len,
+                                              c->flags, c->slot_id);
+  if (r != TAPASCO_SUCCESS)
+    DEVERR(devctx->id, "copy " PRIcopy " failed: %s (" PRIres ")",
+           atomic_load(&c->id), tapasco_strerror(r), r);
+  pthread_mutex_lock(&cp->mtx);
+  c->res = r;
+  atomic_store(&c->done, 1);
+  pthread_cond_broadcast(&cp->finished);
+  pthread_mutex_unlock(&cp->mtx);
+}
+
+static void *run_copies(void *p) {
+  tapasco_copies_t *cp = (tapasco_copies_t *)p;
+  while (1) {
+    while (sem_wait(&cp->pending))
+      ;
+    if (atomic_load(&cp->stop))
+      break;
+    struct copy *c = (struct copy *)gq_dequeue(cp->pending_q);
+    assert(c);
+    run_copy(cp, c);
+  }
+  return NULL;
+}
+
+static void stop_workers(tapasco_copies_t *cp) {
+  atomic_store(&cp->stop, 1);
+  for (size_t i = 0; i < cp->num_workers; ++i)
+    sem_post(&cp->pending);
+  for (size_t i = 0; i < cp->num_workers; ++i)
+    pthread_join(cp->worker[i], NULL);
+  cp->num_workers = 0;
+}
+
+/* Starts the worker threads; called with cp->mtx held. */
+static tapasco_res_t start_workers(tapasco_copies_t *cp) {
+  for (cp->num_workers = 0; cp->num_workers < TAPASCO_COPIES_WORKERS;
+       ++cp->num_workers) {
+    if (pthread_create(&cp->worker[cp->num_workers], NULL, run_copies, cp)) {
+      DEVERR(cp->devctx->id, "could not start transfer worker: %s (%d)",
+             strerror(errno), errno);
+      stop_workers(cp);
+      atomic_store(&cp->stop, 0);
+      return TAPASCO_ERR_PTHREAD_ERROR;
+    }
+  }
+  DEVLOG(cp->devctx->id, LALL_TRANSFERS, "started %zu transfer workers",
+         cp->num_workers);
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_copies_init(tapasco_devctx_t *devctx,
+                                  tapasco_copies_t **copies) {
+  tapasco_copies_t *cp =
+      (tapasco_copies_t *)calloc(sizeof(tapasco_copies_t), 1);
+  if (!cp) {
+    DEVERR(devctx->id, "could not allocate nonblocking copies");
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  }
+  cp->devctx = devctx;
+  pthread_mutex_init(&cp->mtx, NULL);
+  pthread_cond_init(&cp->finished, NULL);
+  sem_init(&cp->pending, 0, 0);
+  cp->pending_q = gq_init();
+  for (size_t i = TAPASCO_COPIES_MAX; i > 0; --i) {
+    cp->copy[i - 1].next_id = i;
+    cp->copy[i - 1].next = cp->free;
+    cp->free = &cp->copy[i - 1];
+  }
+  *copies = cp;
+  return TAPASCO_SUCCESS;
+}
+
+void tapasco_copies_deinit(tapasco_copies_t *cp) {
+  if (cp) {
+    stop_workers(cp);
+    while (gq_dequeue(cp->pending_q))
+      ;
+    gq_destroy(cp->pending_q);
+    sem_destroy(&cp->pending);
+    pthread_cond_destroy(&cp->finished);
+    pthread_mutex_destroy(&cp->mtx);
+    free(cp);
+  }
+}
+
+tapasco_res_t tapasco_copies_submit(tapasco_devctx_t *devctx,
+                                    int const to_device, void *host,
+                                    tapasco_handle_t const h, size_t const len,
+                                    tapasco_device_copy_flag_t const flags,
+                                    tapasco_slot_id_t const slot_id,
+                                    tapasco_copy_id_t *copy_id) {
+  tapasco_copies_t *cp = devctx->copies;
+  tapasco_res_t r = TAPASCO_SUCCESS;
+  struct copy *c;
+  pthread_mutex_lock(&cp->mtx);
+  if (!cp->num_workers && (r = start_workers(cp)) != TAPASCO_SUCCESS) {
+    pthread_mutex_unlock(&cp->mtx);
+    return r;
+  }
+  if (!(c = cp->free)) {
+    pthread_mutex_unlock(&cp->mtx);
+    DEVLOG(devctx->id, LALL_TRANSFERS, "too many nonblocking copies in flight");
+    return TAPASCO_ERR_COPY_BUSY;
+  }
+  cp->free = c->next;
+  c->to_device = to_device;
+  c->host = host;
+  c->h = h;
+  c->len = len;
+  c->flags = flags;
+  c->slot_id = slot_id;
+  c->res = TAPASCO_SUCCESS;
+  atomic_store(&c->done, 0);
+  atomic_store(&c->id, c->next_id);
+  *copy_id = c->next_id;
+  pthread_mutex_unlock(&cp->mtx);
+  DEVLOG(devctx->id, LALL_TRANSFERS,
+         "copy " PRIcopy ": %zd bytes %s " PRIhandle, *copy_id, len,
+         to_device ? "to" : "from", h);
+  gq_enqueue(cp->pending_q, c);
+  while (sem_post(&cp->pending))
+    ;
+  tapasco_perfc_copies_nonblocking_inc(devctx->id);
+  return TAPASCO_SUCCESS;
+}
+
+int tapasco_device_copy_ready(tapasco_devctx_t *devctx,
+                              tapasco_copy_id_t const copy_id) {
+  struct copy *c = lookup(devctx->copies, copy_id);
+  // unknown ids are ready: waiting for them fails at once
+  return !c || atomic_load(&c->id) != copy_id || atomic_load(&c->done);
+}
+
+tapasco_res_t tapasco_device_copy_wait(tapasco_devctx_t *devctx,
+                                       tapasco_copy_id_t const copy_id) {
+  tapasco_copies_t *cp = devctx->copies;
+  struct copy *c = lookup(cp, copy_id);
+  tapasco_res_t r;
+  pthread_mutex_lock(&cp->mtx);
+  if (!c || atomic_load(&c->id) != copy_id) {
+    pthread_mutex_unlock(&cp->mtx);
+    DEVERR(devctx->id, "copy " PRIcopy " not found", copy_id);
+    return TAPASCO_ERR_COPY_ID_NOT_FOUND;
+  }
+  while (!atomic_load(&c->done))
+    pthread_cond_wait(&cp->finished, &cp->mtx);
+  r = c->res;
+  atomic_store(&c->id, 0);
+  c->next_id += TAPASCO_COPIES_MAX;
+  c->next = cp->free;
+  cp->free = c;
+  pthread_mutex_unlock(&cp->mtx);
+  return r;
+}
@@ -0,0 +1,176 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/**
+ *  @file	tapasco_cq.c
+ *  @brief	Completion queues for finished jobs.
+ *  @author	Embedded Systems and Applications Group, TU Darmstadt
+ **/
+#include <assert.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <tapasco_cq.h>
+#include <tapasco_device.h>
+#include <tapasco_errors.h>
+#include <tapasco_jobs.h>
+#include <tapasco_logging.h>
+#include <tapasco_pemgmt.h>
+#include <tapasco_scheduler.h>
+
+/** Ring buffer of finished job ids; each job id can be posted at most once
+ *  before it is reaped, so TAPASCO_JOBS_Q_SZ entries can never overflow. */
+struct tapasco_cq {
+  tapasco_dev_id_t dev_id;
+  pthread_mutex_t mtx;
+  pthread_cond_t finished;
+  size_t head;
+  size_t cnt;
+  tapasco_job_id_t q[TAPASCO_JOBS_Q_SZ];
+};
+
+tapasco_res_t tapasco_cq_init(tapasco_dev_id_t const dev_id,
+                              tapasco_cq_t **cq) {
+  *cq = (tapasco_cq_t *)calloc(sizeof(**cq), 1);
+  if (!*cq) {
+    DEVERR(dev_id, "could not allocate completion queue");
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  }
+  (*cq)->dev_id = dev_id;
+  if (pthread_mutex_init(&(*cq)->mtx, NULL) ||
+      pthread_cond_init(&(*cq)->finished, NULL)) {
+    DEVERR(dev_id, "could not initialize completion queue");
+    free(*cq);
+    return TAPASCO_ERR_PTHREAD_ERROR;
+  }
+  DEVLOG(dev_id, LALL_ASYNC, "completion queue initialized");
+  return TAPASCO_SUCCESS;
+}
+
+void tapasco_cq_deinit(tapasco_cq_t *cq) {
+  if (cq) {
+    pthread_cond_destroy(&cq->finished);
+    pthread_mutex_destroy(&cq->mtx);
+    free(cq);
+  }
+}
+
+static inline void cq_post(tapasco_cq_t *cq, tapasco_job_id_t const j_id) {
+  assert(cq->cnt < TAPASCO_JOBS_Q_SZ);
+  cq->q[(cq->head + cq->cnt) % TAPASCO_JOBS_Q_SZ] = j_id;
+  ++cq->cnt;
+}
+
+void tapasco_cq_post(tapasco_cq_t *cq, tapasco_job_id_t const j_id) {
+  pthread_mutex_lock(&cq->mtx);
+  cq_post(cq, j_id);
+  pthread_cond_broadcast(&cq->finished);
+  pthread_mutex_unlock(&cq->mtx);
+}
+
+size_t tapasco_cq_signal_received(size_t num, platform_slot_id_t *slots,
+                                  void *arg) {
+  tapasco_devctx_t *devctx = (tapasco_devctx_t *)arg;
+  tapasco_cq_t *cq = NULL;
+  size_t rem = 0;
+  for (size_t i = 0; i < num; ++i) {
+    tapasco_slot_id_t const slot = slots[i];
+    tapasco_job_id_t const j_id =
+        slot < TAPASCO_NUM_SLOTS ? tapasco_pemgmt_get_job(devctx->pemgmt, slot)
+                                 : 0;
+    // jobs with successors are completed by the scheduler
+    if (j_id && tapasco_jobs_num_successors(devctx->jobs, j_id)) {
+      tapasco_scheduler_post_completed(devctx, j_id);
+      continue;
+    }
+    tapasco_cq_t *jcq = j_id ? tapasco_jobs_get_cq(devctx->jobs, j_id) : NULL;
+    if (!jcq) {
+      if (j_id) // collected by the user, wake up threads waiting for it
+        tapasco_pemgmt_signal_job(devctx, j_id);
+      slots[rem++] = slot;
+      continue;
+    }
+    // keep the lock while consecutive slots go to the same queue
+    if (jcq != cq) {
+      if (cq) {
+        pthread_cond_broadcast(&cq->finished);
+        pthread_mutex_unlock(&cq->mtx);
+      }
+      cq = jcq;
+      pthread_mutex_lock(&cq->mtx);
+    }
+    DEVLOG(devctx->id, LALL_ASYNC,
+           "slot #" PRIslot ": posting job " PRIjob " to completion queue",
+           slot, j_id);
+    cq_post(cq, j_id);
+  }
+  if (cq) {
+    pthread_cond_broadcast(&cq->finished);
+    pthread_mutex_unlock(&cq->mtx);
+  }
+  return rem;
+}
+
+tapasco_res_t tapasco_device_cq_create(tapasco_devctx_t *devctx,
+                                       tapasco_cq_t **cq) {
+  return tapasco_cq_init(devctx->id, cq);
+}
+
+void tapasco_device_cq_destroy(tapasco_devctx_t *devctx, tapasco_cq_t *cq) {
+  tapasco_cq_deinit(cq);
+}
+
+tapasco_res_t tapasco_device_job_set_cq(tapasco_devctx_t *devctx,
+                                        tapasco_job_id_t const j_id,
+                                        tapasco_cq_t *cq) {
+  if (tapasco_jobs_get_state(devctx->jobs, j_id) !=
+      TAPASCO_JOB_STATE_REQUESTED)
+    return TAPASCO_ERR_JOB_ID_NOT_FOUND;
+  tapasco_jobs_set_cq(devctx->jobs, j_id, cq);
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_device_cq_reap(tapasco_devctx_t *devctx,
+                                     tapasco_cq_t *cq, size_t const max_jobs,
+                                     tapasco_job_id_t *j_ids, size_t *num_jobs,
+                                     tapasco_device_cq_reap_flag_t const flags) {
+  tapasco_res_t r = TAPASCO_SUCCESS;
+  size_t n = 0;
+  assert(cq);
+  pthread_mutex_lock(&cq->mtx);
+  while (!cq->cnt && !(flags & TAPASCO_DEVICE_CQ_REAP_NONBLOCKING))
+    pthread_cond_wait(&cq->finished, &cq->mtx);
+  for (; n < max_jobs && cq->cnt; ++n, --cq->cnt) {
+    j_ids[n] = cq->q[cq->head];
+    cq->head = (cq->head + 1) % TAPASCO_JOBS_Q_SZ;
+  }
+  pthread_mutex_unlock(&cq->mtx);
+
+  DEVLOG(devctx->id, LALL_ASYNC, "reaped %zd jobs", n);
+  // fetch results and release PEs outside of the lock
+  for (size_t i = 0; i < n; ++i) {
+    tapasco_res_t const jr = tapasco_scheduler_complete_job(devctx, j_ids[i]);
+    if (jr != TAPASCO_SUCCESS) {
+      DEVERR(devctx->id, "job " PRIjob " failed: %s (" PRIres ")", j_ids[i],
+             tapasco_strerror(jr), jr);
+      if (r == TAPASCO_SUCCESS)
+        r = jr;
+    }
+  }
+  *num_jobs = n;
+  return r;
+}
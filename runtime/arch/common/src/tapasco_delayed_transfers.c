@@ -21,28 +21,75 @@
  *  @author J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 #include <platform.h>
+#include <stdlib.h>
 #include <tapasco.h>
+#include <tapasco_bufpool.h>
 #include <tapasco_context.h>
 #include <tapasco_delayed_transfers.h>
 #include <tapasco_device.h>
+#include <tapasco_local_mem.h>
 #include <tapasco_logging.h>
 
+/* Returns the flags of a transfer on the PE in s_id: PE-local data of PEs
+ * without local memory falls back to host memory. */
+static inline tapasco_device_alloc_flag_t
+mem_flags(tapasco_devctx_t *devctx, tapasco_transfer_t const *t,
+          tapasco_slot_id_t const s_id) {
+  if ((t->flags & TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL) &&
+      tapasco_local_mem_of_pe(devctx, s_id) >= TAPASCO_NUM_SLOTS)
+    return t->flags & ~TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL;
+  return t->flags;
+}
+
+/* Host data in PE-local memory is kept resident between jobs. */
+static inline int is_resident(tapasco_devctx_t *devctx,
+                              tapasco_transfer_t const *t,
+                              tapasco_slot_id_t const s_id) {
+  return (mem_flags(devctx, t, s_id) & TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL) &&
+         t->data;
+}
+
 tapasco_res_t tapasco_transfer_to(tapasco_devctx_t *devctx,
                                   tapasco_job_id_t const j_id,
                                   tapasco_transfer_t *t,
                                   tapasco_slot_id_t s_id) {
-  LOG(LALL_TRANSFERS, "job %lu: allocating buffer with length %zd bytes",
-      (unsigned long)j_id, (unsigned long)t->len);
-  tapasco_res_t res =
-      tapasco_device_alloc(devctx, &t->handle, t->len, t->flags, s_id);
-  if (res != TAPASCO_SUCCESS) {
-    ERR("job %lu: memory allocation failed!", (unsigned long)j_id);
-    return res;
+  if (t->shared && t->shared->handle) {
+    // buffer of a finished predecessor, already on the device
+    LOG(LALL_TRANSFERS, "job %lu: using shared buffer 0x%08lx",
+        (unsigned long)j_id, (unsigned long)t->shared->handle);
+    t->handle = t->shared->handle;
+    return TAPASCO_SUCCESS;
+  }
+  tapasco_device_alloc_flag_t const flags = mem_flags(devctx, t, s_id);
+  int valid = 0;
+  tapasco_res_t res = TAPASCO_SUCCESS;
+  if (t->kept) {
+    LOG(LALL_TRANSFERS, "job %lu: reusing buffer 0x%08lx", (unsigned long)j_id,
+        (unsigned long)t->handle);
+  } else {
+    LOG(LALL_TRANSFERS, "job %lu: allocating buffer with length %zd bytes",
+        (unsigned long)j_id, (unsigned long)t->len);
+    if (is_resident(devctx, t, s_id))
+      res = tapasco_local_mem_acquire(devctx->lmem, s_id, t->data, t->len,
+                                      &t->handle, &valid);
+    else if (flags & TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL)
+      res = tapasco_device_alloc(devctx, &t->handle, t->len, flags, s_id);
+    else
+      res = tapasco_bufpool_get(devctx->bufpool, &t->handle, t->len);
+    if (res != TAPASCO_SUCCESS) {
+      ERR("job %lu: memory allocation failed!", (unsigned long)j_id);
+      return res;
+    }
   }
-  if (t->dir_flags & TAPASCO_COPY_DIRECTION_TO) {
+  if (t->shared)
+    t->shared->handle = t->handle;
+  if (valid) {
+    LOG(LALL_TRANSFERS, "job %lu: data is resident at 0x%08lx",
+        (unsigned long)j_id, (unsigned long)t->handle);
+  } else if (t->dir_flags & TAPASCO_COPY_DIRECTION_TO) {
     LOG(LALL_TRANSFERS, "job %lu: executing transfer to with length %zd bytes",
         (unsigned long)j_id, (unsigned long)t->len);
-    res = tapasco_device_copy_to(devctx, t->data, t->handle, t->len, t->flags,
+    res = tapasco_device_copy_to(devctx, t->data, t->handle, t->len, flags,
                                  s_id);
     if (res != TAPASCO_SUCCESS) {
       ERR("job %lu: transfer failed - %zd bytes -> 0x%08lx with flags %lu",
@@ -58,23 +105,72 @@ tapasco_res_t tapasco_transfer_from(tapasco_devctx_t *devctx,
                                     tapasco_job_id_t const j_id,
                                     tapasco_transfer_t *t,
                                     tapasco_slot_id_t s_id) {
+  tapasco_device_alloc_flag_t const flags = mem_flags(devctx, t, s_id);
   tapasco_res_t res = TAPASCO_SUCCESS;
   if (t->dir_flags & TAPASCO_COPY_DIRECTION_FROM) {
     LOG(LALL_TRANSFERS,
         "job %lu: executing transfer from with length %zd bytes",
         (unsigned long)j_id, (unsigned long)t->len);
-    tapasco_res_t res = tapasco_device_copy_from(devctx, t->handle, t->data,
-                                                 t->len, t->flags, s_id);
+    res = tapasco_device_copy_from(devctx, t->handle, t->data, t->len, flags,
+                                   s_id);
     if (res != TAPASCO_SUCCESS) {
       ERR("job %lu: transfer failed - %zd bytes <- 0x%08lx with flags %lu",
           (unsigned long)j_id, t->len, (unsigned long)t->handle,
           (unsigned long)t->flags);
     }
   }
+  if (is_resident(devctx, t, s_id)) {
+    // after a copy in either direction, device and host data are the same
+    tapasco_local_mem_release(devctx->lmem, s_id, t->handle, t->len,
+                              res == TAPASCO_SUCCESS && t->dir_flags
+                                  ? t->data
+                                  : NULL);
+    return res;
+  }
+  // persistent jobs keep their buffers for the next launch
+  if (!t->shared && !(t->flags & TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL) &&
+      tapasco_jobs_is_persistent(jobs, j_id)) {
+    t->kept = 1;
+    return res;
+  }
+  tapasco_transfer_release(devctx, j_id, t, s_id);
+  return res;
+}
+
+void tapasco_transfer_release(tapasco_devctx_t *devctx,
+                              tapasco_job_id_t const j_id,
+                              tapasco_transfer_t *t, tapasco_slot_id_t s_id) {
+  tapasco_shared_buffer_t *buf = t->shared;
+  t->shared = NULL;
+  t->kept = 0;
+  if (buf) {
+    if (__atomic_sub_fetch(&buf->refs, 1, __ATOMIC_SEQ_CST) > 0) {
+      LOG(LALL_TRANSFERS, "job %lu: keeping shared buffer 0x%08lx",
+          (unsigned long)j_id, (unsigned long)buf->handle);
+      return;
+    }
+    t->handle = buf->handle;
+    free(buf);
+    if (!t->handle)
+      return; // producer never ran
+  }
   LOG(LALL_TRANSFERS, "job %lu: freeing buffer with length %zd bytes",
       (unsigned long)j_id, (unsigned long)t->len);
-  tapasco_device_free(devctx, t->handle, t->len, t->flags, s_id);
-  return res;
+  if (mem_flags(devctx, t, s_id) & TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL)
+    tapasco_device_free(devctx, t->handle, t->len, t->flags, s_id);
+  else
+    tapasco_bufpool_put(devctx->bufpool, t->handle, t->len);
+}
+
+void tapasco_transfer_discard(tapasco_devctx_t *devctx,
+                              tapasco_job_id_t const j_id,
+                              tapasco_transfer_t *t, tapasco_slot_id_t s_id) {
+  LOG(LALL_TRANSFERS, "job %lu: discarding buffer with length %zu bytes",
+      (unsigned long)j_id, t->len);
+  if (is_resident(devctx, t, s_id))
+    tapasco_local_mem_release(devctx->lmem, s_id, t->handle, t->len, NULL);
+  else
+    tapasco_transfer_release(devctx, j_id, t, s_id);
 }
 
 tapasco_res_t tapasco_write_arg(tapasco_devctx_t *devctx, tapasco_jobs_t *jobs,
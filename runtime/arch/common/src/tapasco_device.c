@@ -26,6 +26,8 @@
 #include <platform_info.h>
 #include <stdio.h>
 #include <string.h>
+#include <tapasco_cq.h>
+#include <tapasco_delayed_transfers.h>
 #include <tapasco_device.h>
 #include <tapasco_jobs.h>
 #include <tapasco_local_mem.h>
@@ -38,6 +40,8 @@
 static void setup_system(tapasco_devctx_t *devctx) {
   // enable interrupts, globally and for each instance
   tapasco_pemgmt_setup_system(devctx, devctx->pemgmt);
+  // route finished jobs attached to completion queues
+  platform_signal_received(devctx->pdctx, tapasco_cq_signal_received, devctx);
 }
 
 tapasco_res_t tapasco_create_device(tapasco_ctx_t *ctx,
@@ -76,6 +80,10 @@ tapasco_res_t tapasco_create_device(tapasco_ctx_t *ctx,
   tapasco_res_t res = tapasco_pemgmt_init(p, &p->pemgmt);
   res = res == TAPASCO_SUCCESS ? tapasco_jobs_init(dev_id, &p->jobs) : res;
   res = res == TAPASCO_SUCCESS ? tapasco_local_mem_init(p, &p->lmem) : res;
+  res = res == TAPASCO_SUCCESS ? tapasco_bufpool_init(p, &p->bufpool) : res;
+  res = res == TAPASCO_SUCCESS ? tapasco_scheduler_init(p, &p->scheduler) : res;
+  res = res == TAPASCO_SUCCESS ? tapasco_fallback_init(p, &p->fallback) : res;
+  res = res == TAPASCO_SUCCESS ? tapasco_copies_init(p, &p->copies) : res;
   if (res != TAPASCO_SUCCESS)
     return res;
   p->pctx = ctx->pctx;
@@ -94,6 +102,13 @@ void tapasco_destroy_device(tapasco_ctx_t *ctx, tapasco_devctx_t *devctx) {
           devctx->id, tapasco_perfc_tostring(devctx->id));
 #endif /* NPERFC */
   ctx->devs[devctx->id] = NULL;
+  platform_signal_received(devctx->pdctx, NULL, NULL);
+  tapasco_copies_deinit(devctx->copies);
+  tapasco_fallback_deinit(devctx->fallback);
+  tapasco_scheduler_deinit(devctx->scheduler);
+  for (tapasco_slot_id_t s = 0; s < TAPASCO_NUM_SLOTS; ++s)
+    tapasco_pemgmt_free_quarantined(devctx, s);
+  tapasco_bufpool_deinit(devctx->bufpool);
   tapasco_local_mem_deinit(devctx->lmem);
   tapasco_jobs_deinit(devctx->jobs);
   tapasco_pemgmt_deinit(devctx->pemgmt);
@@ -114,34 +129,136 @@ tapasco_device_load_bitstream(tapasco_devctx_t *devctx, size_t const len,
   return TAPASCO_ERR_NOT_IMPLEMENTED;
 }
 
+static tapasco_res_t acquire_job_id(tapasco_devctx_t *devctx,
+                                    tapasco_job_id_t *j_id,
+                                    tapasco_kernel_id_t const k_id,
+                                    tapasco_device_acquire_job_id_flag_t flags,
+                                    struct timespec const *deadline) {
+  if (flags & ~TAPASCO_DEVICE_ACQUIRE_JOB_ID_NONBLOCKING)
+    return TAPASCO_ERR_NOT_IMPLEMENTED;
+  tapasco_kernel_t *kernel = tapasco_pemgmt_kernel(devctx->pemgmt, k_id);
+  // kernels without PEs can still run on the CPU
+  if (!kernel && !tapasco_fallback_registered(devctx->fallback, k_id)) {
+    DEVERR(devctx->id, "kernel " PRIkernel " not found", k_id);
+    return TAPASCO_ERR_KERNEL_NOT_FOUND;
+  }
+  if (flags & TAPASCO_DEVICE_ACQUIRE_JOB_ID_NONBLOCKING)
+    *j_id = tapasco_jobs_acquire(devctx->jobs);
+  else
+    *j_id = tapasco_jobs_acquire_wait(devctx->jobs, deadline);
+  if (!*j_id)
+    return deadline ? TAPASCO_ERR_TIMEOUT : TAPASCO_ERR_NO_JOB_ID_AVAILABLE;
+  tapasco_jobs_set_kernel_id(devctx->jobs, *j_id, k_id);
+  tapasco_jobs_set_kernel(devctx->jobs, *j_id, kernel);
+  return TAPASCO_SUCCESS;
+}
+
 tapasco_res_t
 tapasco_device_acquire_job_id(tapasco_devctx_t *devctx, tapasco_job_id_t *j_id,
                               tapasco_kernel_id_t const k_id,
                               tapasco_device_acquire_job_id_flag_t flags) {
-  if (flags)
-    return TAPASCO_ERR_NOT_IMPLEMENTED;
-  *j_id = tapasco_jobs_acquire(devctx->jobs);
-  if (*j_id > 0)
-    tapasco_jobs_set_kernel_id(devctx->jobs, *j_id, k_id);
-  return *j_id > 0 ? TAPASCO_SUCCESS : TAPASCO_ERR_UNKNOWN_ERROR;
+  return acquire_job_id(devctx, j_id, k_id, flags, NULL);
+}
+
+tapasco_res_t tapasco_device_acquire_job_id_timed(
+    tapasco_devctx_t *devctx, tapasco_job_id_t *j_id,
+    tapasco_kernel_id_t const k_id, uint64_t const timeout_ns) {
+  struct timespec deadline;
+  clock_gettime(CLOCK_MONOTONIC, &deadline);
+  deadline.tv_sec += timeout_ns / 1000000000ULL;
+  deadline.tv_nsec += timeout_ns % 1000000000ULL;
+  if (deadline.tv_nsec >= 1000000000L) {
+    deadline.tv_nsec -= 1000000000L;
+    ++deadline.tv_sec;
+  }
+  return acquire_job_id(devctx, j_id, k_id,
+                        TAPASCO_DEVICE_ACQUIRE_JOB_ID_BLOCKING, &deadline);
+}
+
+/* Frees the device buffer kept for argument a of a persistent job. */
+static void free_kept(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id,
+                      size_t const a) {
+  tapasco_transfer_t *t = tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+  if (t && t->kept)
+    tapasco_transfer_release(devctx, j_id, t,
+                             tapasco_jobs_get_slot(devctx->jobs, j_id));
 }
 
 void tapasco_device_release_job_id(tapasco_devctx_t *devctx,
                                    tapasco_job_id_t const job_id) {
+  if (tapasco_jobs_is_persistent(devctx->jobs, job_id)) {
+    size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, job_id);
+    for (size_t a = 0; a < num_args; ++a)
+      free_kept(devctx, job_id, a);
+  }
   tapasco_jobs_release(devctx->jobs, job_id);
 }
 
+tapasco_res_t tapasco_device_job_set_persistent(tapasco_devctx_t *devctx,
+                                                tapasco_job_id_t const j_id) {
+  if (tapasco_jobs_get_state(devctx->jobs, j_id) !=
+      TAPASCO_JOB_STATE_REQUESTED)
+    return TAPASCO_ERR_JOB_ID_NOT_FOUND;
+  if (tapasco_jobs_num_successors(devctx->jobs, j_id) ||
+      tapasco_jobs_has_deps(devctx->jobs, j_id)) {
+    DEVERR(devctx->id, "job " PRIjob ": job graphs cannot be persistent",
+           j_id);
+    return TAPASCO_ERR_NOT_IMPLEMENTED;
+  }
+  tapasco_jobs_set_persistent(devctx->jobs, j_id);
+  return TAPASCO_SUCCESS;
+}
+
 tapasco_res_t
 tapasco_device_job_launch(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id,
                           tapasco_device_job_launch_flag_t const flags) {
+  tapasco_jobs_rearm(devctx->jobs, j_id);
+  if (flags & TAPASCO_DEVICE_JOB_LAUNCH_PIPELINED)
+    return tapasco_scheduler_launch_pipelined(devctx, j_id);
   tapasco_res_t const r = tapasco_scheduler_launch(devctx, j_id);
   if (r != TAPASCO_SUCCESS || (flags & TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING)) {
     return r;
   } else {
-    return tapasco_scheduler_finish_job(devctx, j_id);
+    return tapasco_scheduler_finish_job(devctx, j_id, NULL);
   }
 }
 
+tapasco_res_t tapasco_device_job_launch_batch(
+    tapasco_devctx_t *devctx, size_t const num_jobs,
+    tapasco_job_id_t const *j_ids,
+    tapasco_device_job_launch_flag_t const flags) {
+  size_t launched = 0;
+  tapasco_res_t r = TAPASCO_SUCCESS;
+  for (size_t j = 0; j < num_jobs; ++j)
+    tapasco_jobs_rearm(devctx->jobs, j_ids[j]);
+  if (flags & TAPASCO_DEVICE_JOB_LAUNCH_PIPELINED) {
+    // jobs failing to launch are failed, the others are staged regardless
+    for (size_t j = 0; j < num_jobs; ++j) {
+      tapasco_res_t const lr =
+          tapasco_scheduler_launch_pipelined(devctx, j_ids[j]);
+      if (lr == TAPASCO_SUCCESS)
+        ++launched;
+      else if (r == TAPASCO_SUCCESS)
+        r = lr;
+    }
+    if (r != TAPASCO_SUCCESS)
+      DEVERR(devctx->id, "pipelined batch: %zu of %zu jobs launched", launched,
+             num_jobs);
+    return r;
+  }
+  r = tapasco_scheduler_launch_batch(devctx, num_jobs, j_ids, &launched);
+  if (r == TAPASCO_SUCCESS && (flags & TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING))
+    return r;
+  // blocking mode or partial launch: no job of the batch is left running
+  for (size_t j = 0; j < launched; ++j) {
+    tapasco_res_t const cr =
+        tapasco_scheduler_finish_job(devctx, j_ids[j], NULL);
+    if (r == TAPASCO_SUCCESS)
+      r = cr;
+  }
+  return r;
+}
+
 tapasco_res_t tapasco_device_job_get_arg(tapasco_devctx_t *devctx,
                                          tapasco_job_id_t const j_id,
                                          size_t arg_idx, size_t const arg_len,
@@ -156,15 +273,70 @@ tapasco_res_t tapasco_device_job_set_arg(tapasco_devctx_t *devctx,
   return tapasco_jobs_set_arg(devctx->jobs, j_id, arg_idx, arg_len, arg_value);
 }
 
+tapasco_res_t tapasco_device_job_set_poll_budget(tapasco_devctx_t *devctx,
+                                                 tapasco_job_id_t const j_id,
+                                                 uint32_t const budget_ns) {
+  tapasco_jobs_set_poll_budget(devctx->jobs, j_id, budget_ns);
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t
+tapasco_device_job_set_priority(tapasco_devctx_t *devctx,
+                                tapasco_job_id_t const j_id,
+                                tapasco_job_priority_t const prio) {
+  if ((unsigned)prio >= TAPASCO_JOB_PRIORITIES)
+    return TAPASCO_ERR_INVALID_PRIORITY;
+  tapasco_jobs_set_priority(devctx->jobs, j_id, prio);
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_device_job_set_deadline(tapasco_devctx_t *devctx,
+                                              tapasco_job_id_t const j_id,
+                                              uint64_t const deadline_ns) {
+  struct timespec ts;
+  uint64_t now = 0;
+  if (deadline_ns) {
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    now = (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+  }
+  tapasco_jobs_set_deadline(devctx->jobs, j_id,
+                            deadline_ns ? now + deadline_ns : 0);
+  return TAPASCO_SUCCESS;
+}
+
 tapasco_res_t tapasco_device_job_set_arg_transfer(
     tapasco_devctx_t *devctx, tapasco_job_id_t const job_id, size_t arg_idx,
     size_t const arg_len, void *arg_value,
     tapasco_device_alloc_flag_t const flags,
     tapasco_copy_direction_flag_t const dir_flags) {
+  if (tapasco_jobs_is_persistent(devctx->jobs, job_id) &&
+      arg_idx < tapasco_jobs_arg_count(devctx->jobs, job_id)) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, job_id, arg_idx);
+    // rebinding to host memory of the same size keeps the device buffer
+    if (t && t->kept && t->len == arg_len && t->flags == flags) {
+      t->data = arg_value;
+      t->dir_flags = dir_flags;
+      return TAPASCO_SUCCESS;
+    }
+    free_kept(devctx, job_id, arg_idx);
+  }
   return tapasco_jobs_set_arg_transfer(devctx->jobs, job_id, arg_idx, arg_len,
                                        arg_value, flags, dir_flags);
 }
 
+tapasco_res_t tapasco_device_job_set_arg_from(tapasco_devctx_t *devctx,
+                                              tapasco_job_id_t const job_id,
+                                              size_t arg_idx,
+                                              tapasco_job_id_t const src_job_id,
+                                              size_t src_arg_idx) {
+  DEVLOG(devctx->id, LALL_DEVICE,
+         "job " PRIjob ": arg #%zd from arg #%zd of job " PRIjob, job_id,
+         arg_idx, src_arg_idx, src_job_id);
+  return tapasco_jobs_add_edge(devctx->jobs, src_job_id, src_arg_idx, job_id,
+                               arg_idx);
+}
+
 tapasco_res_t tapasco_device_job_get_return(tapasco_devctx_t *devctx,
                                             tapasco_job_id_t const j_id,
                                             size_t const ret_len,
@@ -0,0 +1,360 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TPC).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/** @file tapasco_fallback.c
+ *  @brief  CPU fallback execution of kernels.
+ *  @author Embedded Systems and Applications Group, TU Darmstadt
+ **/
+#include <assert.h>
+#include <errno.h>
+#include <gen_queue.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <tapasco_cq.h>
+#include <tapasco_device.h>
+#include <tapasco_fallback.h>
+#include <tapasco_logging.h>
+#include <tapasco_pemgmt.h>
+#include <tapasco_perfc.h>
+#include <tapasco_scheduler.h>
+#include <time.h>
+#include <unistd.h>
+
+/* Host implementation of a kernel and its cost model. */
+struct cpu_kernel {
+  tapasco_kernel_id_t k_id;
+  tapasco_cpu_kernel_t fn;
+  void *user_data;
+  tapasco_kernel_t *kernel; // PEs of the kernel (NULL: none)
+  size_t num_pes;
+  _Atomic uint64_t pe_ns;  // running estimate of job runtime on a PE
+  _Atomic uint64_t cpu_ns; // running estimate of job runtime on the CPU
+};
+
+struct tapasco_fallback {
+  tapasco_devctx_t *devctx;
+  _Atomic size_t num_kernels; // entries are never removed, only disabled
+  struct cpu_kernel kernel[TAPASCO_FALLBACK_MAX_KERNELS];
+  _Atomic uint64_t started[TAPASCO_NUM_SLOTS]; // job start times on PEs
+  pthread_mutex_t mtx;                         // registration
+  size_t num_workers;
+  pthread_t *worker;
+  sem_t pending;          // count jobs to run
+  struct gq_t *pending_q; // jobs to run on the CPU
+  _Atomic size_t backlog; // jobs handed over, but not finished yet
+  _Atomic int stop;
+};
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Adds a sample to a running estimate; concurrent updates may be lost. */
+static inline void ewma(_Atomic uint64_t *est, uint64_t const sample) {
+  uint64_t const old = atomic_load(est);
+  atomic_store(est, old ? old - (old >> TAPASCO_FALLBACK_EWMA) +
+                              (sample >> TAPASCO_FALLBACK_EWMA)
+                        : sample);
+}
+
+static struct cpu_kernel *find(tapasco_fallback_t *fb,
+                               tapasco_kernel_id_t const k_id) {
+  size_t const n = atomic_load(&fb->num_kernels);
+  for (size_t i = 0; i < n; ++i)
+    if (fb->kernel[i].k_id == k_id)
+      return fb->kernel[i].fn ? &fb->kernel[i] : NULL;
+  return NULL;
+}
+
+/* Jobs can run on the CPU, if all their buffers have host data. */
+static int runnable(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id) {
+  size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (t && t->len && (!t->data || t->shared))
+      return 0;
+  }
+  return 1;
+}
+
+/* Jobs of kernels with PEs are only offloaded, if this process manages the
+ * PEs: with shared access, the driver arbitrates them between processes. */
+static inline int exclusive(tapasco_devctx_t const *devctx) {
+  return devctx->pdctx->mode != PLATFORM_SHARED_ACCESS;
+}
+
+/* Compares the expected queueing delay for a PE with the estimated runtime on
+ * the CPU, including the jobs already handed over to the workers. */
+static int pays_off(tapasco_fallback_t *fb, struct cpu_kernel *k) {
+  long const credits = tapasco_pemgmt_credits(k->kernel);
+  if (credits > 0)
+    return 0; // a PE is available
+  uint64_t const pe_ns = atomic_load(&k->pe_ns);
+  uint64_t const cpu_ns = atomic_load(&k->cpu_ns);
+  size_t const backlog = atomic_load(&fb->backlog);
+  if (!pe_ns)
+    return 0; // no estimate of the queueing delay yet
+  if (!cpu_ns)
+    return !backlog; // learn the runtime on the CPU while it is idle
+  uint64_t const delay = (uint64_t)(1 - credits) * pe_ns / k->num_pes;
+  return (backlog / fb->num_workers + 1) * cpu_ns < delay;
+}
+
+static void run_job(tapasco_fallback_t *fb, tapasco_job_id_t const j_id) {
+  tapasco_devctx_t *devctx = fb->devctx;
+  uint64_t args[TAPASCO_JOB_MAX_ARGS], ret = 0;
+  void *copy[TAPASCO_JOB_MAX_ARGS];
+  size_t num_copies = 0;
+  struct cpu_kernel *k =
+      find(fb, tapasco_jobs_get_kernel_id(devctx->jobs, j_id));
+  size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  tapasco_res_t r = k ? TAPASCO_SUCCESS : TAPASCO_ERR_KERNEL_NOT_FOUND;
+  // job may have been cancelled while it was waiting for a worker
+  if (!tapasco_jobs_cas_state(devctx->jobs, j_id, TAPASCO_JOB_STATE_SCHEDULED,
+                              TAPASCO_JOB_STATE_RUNNING)) {
+    tapasco_jobs_release(devctx->jobs, j_id);
+    return;
+  }
+  // pass host pointers instead of device handles; a PE cannot change host
+  // data which is not copied back, so the kernel gets a copy of it
+  for (size_t a = 0; a < num_args && r == TAPASCO_SUCCESS; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (t && t->len && !(t->dir_flags & TAPASCO_COPY_DIRECTION_FROM)) {
+      if (!(copy[num_copies] = malloc(t->len))) {
+        r = TAPASCO_ERR_OUT_OF_MEMORY;
+        break;
+      }
+      memcpy(copy[num_copies], t->data, t->len);
+      args[a] = (uintptr_t)copy[num_copies++];
+    } else if (t && t->len)
+      args[a] = (uintptr_t)t->data;
+    else if (tapasco_jobs_is_arg_64bit(devctx->jobs, j_id, a))
+      args[a] = tapasco_jobs_get_arg64(devctx->jobs, j_id, a);
+    else
+      args[a] = tapasco_jobs_get_arg32(devctx->jobs, j_id, a);
+  }
+  if (r == TAPASCO_SUCCESS) {
+    uint64_t const start = now_ns();
+    r = k->fn(num_args, args, &ret, k->user_data);
+    ewma(&k->cpu_ns, now_ns() - start);
+  }
+  while (num_copies)
+    free(copy[--num_copies]);
+  if (r == TAPASCO_SUCCESS) {
+    tapasco_jobs_set_return(devctx->jobs, j_id, sizeof(ret), &ret);
+    r = tapasco_scheduler_complete_job(devctx, j_id);
+  } else {
+    DEVERR(devctx->id, "job " PRIjob ": failed on the CPU: %s (" PRIres ")",
+           j_id, tapasco_strerror(r), r);
+    if (tapasco_jobs_cas_state(devctx->jobs, j_id, TAPASCO_JOB_STATE_RUNNING,
+                               TAPASCO_JOB_STATE_FAILED))
+      tapasco_pemgmt_fail_job(devctx, j_id);
+    else
+      r = TAPASCO_ERR_JOB_ABORTED;
+  }
+  // cancelled while running: the worker holds the last reference
+  if (r == TAPASCO_ERR_JOB_ABORTED) {
+    tapasco_jobs_release(devctx->jobs, j_id);
+    return;
+  }
+  tapasco_cq_t *cq = tapasco_jobs_get_cq(devctx->jobs, j_id);
+  if (cq)
+    tapasco_cq_post(cq, j_id);
+}
+
+static void *run_jobs(void *p) {
+  tapasco_fallback_t *fb = (tapasco_fallback_t *)p;
+  while (1) {
+    while (sem_wait(&fb->pending))
+      ;
+    if (atomic_load(&fb->stop))
+      break;
+    tapasco_job_id_t const j_id =
+        (tapasco_job_id_t)(uintptr_t)gq_dequeue(fb->pending_q);
+    assert(j_id);
+    run_job(fb, j_id);
+    atomic_fetch_sub(&fb->backlog, 1);
+  }
+  return NULL;
+}
+
+static void stop_workers(tapasco_fallback_t *fb) {
+  atomic_store(&fb->stop, 1);
+  for (size_t i = 0; i < fb->num_workers; ++i)
+    sem_post(&fb->pending);
+  for (size_t i = 0; i < fb->num_workers; ++i)
+    pthread_join(fb->worker[i], NULL);
+  fb->num_workers = 0;
+}
+
+/* Starts the worker threads; called with fb->mtx held. */
+static tapasco_res_t start_workers(tapasco_fallback_t *fb) {
+  long n = TAPASCO_FALLBACK_WORKERS;
+  if (n <= 0)
+    n = sysconf(_SC_NPROCESSORS_ONLN);
+  if (n <= 0)
+    n = 1;
+  if (!(fb->worker = (pthread_t *)malloc(n * sizeof(*fb->worker))))
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  for (fb->num_workers = 0; fb->num_workers < (size_t)n; ++fb->num_workers) {
+    if (pthread_create(&fb->worker[fb->num_workers], NULL, run_jobs, fb)) {
+      DEVERR(fb->devctx->id, "could not start CPU worker: %s (%d)",
+             strerror(errno), errno);
+      stop_workers(fb);
+      free(fb->worker);
+      fb->worker = NULL;
+      atomic_store(&fb->stop, 0);
+      return TAPASCO_ERR_PTHREAD_ERROR;
+    }
+  }
+  DEVLOG(fb->devctx->id, LALL_SCHEDULER, "started %zu CPU workers",
+         fb->num_workers);
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_fallback_init(tapasco_devctx_t *devctx,
+                                    tapasco_fallback_t **fallback) {
+  tapasco_fallback_t *fb =
+      (tapasco_fallback_t *)calloc(sizeof(tapasco_fallback_t), 1);
+  if (!fb) {
+    DEVERR(devctx->id, "could not allocate CPU fallback");
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  }
+  fb->devctx = devctx;
+  pthread_mutex_init(&fb->mtx, NULL);
+  sem_init(&fb->pending, 0, 0);
+  fb->pending_q = gq_init();
+  *fallback = fb;
+  return TAPASCO_SUCCESS;
+}
+
+void tapasco_fallback_deinit(tapasco_fallback_t *fb) {
+  if (fb) {
+    stop_workers(fb);
+    free(fb->worker);
+    while (gq_dequeue(fb->pending_q))
+      ;
+    gq_destroy(fb->pending_q);
+    sem_destroy(&fb->pending);
+    pthread_mutex_destroy(&fb->mtx);
+    free(fb);
+  }
+}
+
+int tapasco_fallback_registered(tapasco_fallback_t *fb,
+                                tapasco_kernel_id_t const k_id) {
+  return find(fb, k_id) != NULL;
+}
+
+tapasco_res_t tapasco_device_kernel_set_cpu_fallback(
+    tapasco_devctx_t *devctx, tapasco_kernel_id_t const k_id,
+    tapasco_cpu_kernel_t fn, void *user_data) {
+  tapasco_fallback_t *fb = devctx->fallback;
+  tapasco_res_t r = TAPASCO_SUCCESS;
+  size_t i;
+  pthread_mutex_lock(&fb->mtx);
+  if (fn && !fb->num_workers && (r = start_workers(fb)) != TAPASCO_SUCCESS)
+    goto out;
+  size_t const n = atomic_load(&fb->num_kernels);
+  for (i = 0; i < n && fb->kernel[i].k_id != k_id; ++i)
+    ;
+  if (i == TAPASCO_FALLBACK_MAX_KERNELS) {
+    DEVERR(devctx->id, "too many kernels with a CPU fallback");
+    r = TAPASCO_ERR_OUT_OF_MEMORY;
+    goto out;
+  }
+  struct cpu_kernel *k = &fb->kernel[i];
+  k->fn = fn;
+  k->user_data = user_data;
+  if (i == n) {
+    k->k_id = k_id;
+    k->kernel = tapasco_pemgmt_kernel(devctx->pemgmt, k_id);
+    k->num_pes = tapasco_pemgmt_count(devctx->pemgmt, k_id);
+    atomic_store(&fb->num_kernels, n + 1);
+  }
+  DEVLOG(devctx->id, LALL_SCHEDULER,
+         "k_id = " PRIkernel ": CPU fallback %s, %zu PEs", k_id,
+         fn ? "registered" : "removed", k->num_pes);
+out:
+  pthread_mutex_unlock(&fb->mtx);
+  return r;
+}
+
+int tapasco_fallback_wants(tapasco_devctx_t *devctx,
+                           tapasco_job_id_t const j_id) {
+  tapasco_fallback_t *fb = devctx->fallback;
+  if (!atomic_load(&fb->num_kernels))
+    return 0;
+  struct cpu_kernel *k =
+      find(fb, tapasco_jobs_get_kernel_id(devctx->jobs, j_id));
+  return k && runnable(devctx, j_id) &&
+         (!k->kernel || (exclusive(devctx) && pays_off(fb, k)));
+}
+
+void tapasco_fallback_submit(tapasco_devctx_t *devctx,
+                             tapasco_job_id_t const j_id) {
+  tapasco_fallback_t *fb = devctx->fallback;
+  DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": running on the CPU",
+         j_id);
+  tapasco_jobs_set_slot(devctx->jobs, j_id, TAPASCO_FALLBACK_SLOT);
+  // pipelined jobs are scheduled (and may be cancelled) already
+  tapasco_jobs_cas_state(devctx->jobs, j_id, TAPASCO_JOB_STATE_REQUESTED,
+                         TAPASCO_JOB_STATE_SCHEDULED);
+  atomic_fetch_add(&fb->backlog, 1);
+  gq_enqueue(fb->pending_q, (void *)(uintptr_t)j_id);
+  while (sem_post(&fb->pending))
+    ;
+  tapasco_perfc_cpu_jobs_inc(devctx->id);
+}
+
+int tapasco_fallback_offload(tapasco_devctx_t *devctx,
+                             tapasco_job_id_t const j_id) {
+  if (!tapasco_fallback_wants(devctx, j_id))
+    return 0;
+  tapasco_fallback_submit(devctx, j_id);
+  return 1;
+}
+
+void tapasco_fallback_pe_started(tapasco_devctx_t *devctx,
+                                 tapasco_kernel_id_t const k_id,
+                                 tapasco_slot_id_t const slot_id) {
+  tapasco_fallback_t *fb = devctx->fallback;
+  if (atomic_load(&fb->num_kernels) && exclusive(devctx) && find(fb, k_id))
+    atomic_store(&fb->started[slot_id], now_ns());
+}
+
+void tapasco_fallback_pe_finished(tapasco_devctx_t *devctx,
+                                  tapasco_kernel_id_t const k_id,
+                                  tapasco_slot_id_t const slot_id) {
+  tapasco_fallback_t *fb = devctx->fallback;
+  struct cpu_kernel *k;
+  if (!atomic_load(&fb->num_kernels) || !exclusive(devctx) ||
+      !(k = find(fb, k_id)))
+    return;
+  uint64_t const start = atomic_exchange(&fb->started[slot_id], 0);
+  if (start)
+    ewma(&k->pe_ns, now_ns() - start);
+}
@@ -21,7 +21,11 @@
  *  @author	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 #include <assert.h>
+#include <errno.h>
 #include <gen_fixed_size_pool.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
 #include <tapasco_jobs.h>
@@ -29,31 +33,76 @@
 
 #define JOB_ID_OFFSET 1000
 
+/* Cold part of a job: transfer descriptors and outgoing job graph edges;
+ * attached to a job on its first transfer and returned to the pool when the
+ * job is released, only the entries set in its transfer_map are valid. */
+struct tapasco_job_ext {
+  tapasco_transfer_t t[TAPASCO_JOB_MAX_ARGS];
+  tapasco_job_id_t succ[TAPASCO_JOB_MAX_SUCCESSORS];
+};
+
+inline static void init_ext(struct tapasco_job_ext *e, int i) {}
+
+MAKE_FIXED_SIZE_POOL(tapasco_job_ext, TAPASCO_JOBS_Q_SZ, struct tapasco_job_ext,
+                     init_ext)
+
+/* Hot job header: everything the launch path touches for register-only jobs
+ * is kept in the first cache lines, transfers are kept out of line. */
 struct tapasco_job {
   /** job id */
   tapasco_job_id_t id;
-  /** function id this job will be scheduled on **/
-  tapasco_kernel_id_t k_id;
   /** current state of the job **/
   tapasco_job_state_t state;
-  /** argument array (max 64bit, max 32 args at the moment **/
-  union {
-    uint32_t v32;
-    uint64_t v64;
-  } args[TAPASCO_JOB_MAX_ARGS];
+  /** slot id this job is scheduled on **/
+  tapasco_slot_id_t slot;
   /** argument count **/
-  size_t args_len;
-  /** argument sizes **/
-  size_t args_sz;
+  uint32_t args_len;
+  /** argument sizes (bit set: 64bit argument) **/
+  uint32_t args_sz;
+  /** arguments with transfers (bit set: transfer attached) **/
+  uint32_t transfer_map;
+  /** completion polling budget in ns (0: use budget of kernel) **/
+  uint32_t poll_ns;
+  /** priority class while waiting for a PE **/
+  tapasco_job_priority_t prio;
+  /** deadline in ns (CLOCK_MONOTONIC, 0: none) **/
+  uint64_t deadline_ns;
+  /** time the job was queued for a PE in ns (CLOCK_MONOTONIC) **/
+  uint64_t queued_ns;
+  /** number of dependent jobs in ext->succ **/
+  _Atomic uint32_t num_succ;
+  /** unfinished predecessors + launch token (0: no predecessors) **/
+  _Atomic int deps;
+  /** non-zero, if a predecessor has failed **/
+  int deps_failed;
+  /** releases pending for an aborted job still held by a queue or worker **/
+  _Atomic int refs;
+  /** non-zero, once the finish signal of the PE was received **/
+  _Atomic int signaled;
+  /** non-zero, if job is kept and relaunched after it has finished **/
+  int persistent;
+  /** arguments changed since the last launch (bit set: changed) **/
+  uint32_t dirty;
+  /** tag of the argument registers written at the last launch (0: none) **/
+  uint64_t tag;
+  /** function id this job will be scheduled on **/
+  tapasco_kernel_id_t k_id;
+  /** resolved descriptor of the kernel **/
+  tapasco_kernel_t *kernel;
+  /** completion queue to post this job to when finished (optional) **/
+  tapasco_cq_t *cq;
+  /** transfers and edges (NULL until first transfer is attached) **/
+  struct tapasco_job_ext *ext;
   /** direct return value of job, when finished **/
   union {
     uint64_t ret32;
     uint64_t ret64;
   } ret;
-  /** transfer array (max. 32 transfers) **/
-  tapasco_transfer_t transfers[TAPASCO_JOB_MAX_ARGS];
-  /** slot id this job is scheduled on **/
-  tapasco_slot_id_t slot;
+  /** argument array (max 64bit, max 32 args at the moment **/
+  union {
+    uint32_t v32;
+    uint64_t v64;
+  } args[TAPASCO_JOB_MAX_ARGS];
 };
 typedef struct tapasco_job tapasco_job_t;
 
@@ -63,28 +112,132 @@ inline static void init_job(tapasco_job_t *job, int i) {
   job->id = i + JOB_ID_OFFSET;
   job->args_len = 0;
   job->args_sz = 0;
+  job->prio = TAPASCO_JOB_PRIORITY_NORMAL;
   job->state = TAPASCO_JOB_STATE_READY;
 }
 
 MAKE_FIXED_SIZE_POOL(tapasco_jobs, TAPASCO_JOBS_Q_SZ, tapasco_job_t, init_job)
 
+/* Thread-local cache of free job ids. */
+struct tapasco_jobs_magazine {
+  tapasco_jobs_t *jobs;
+  struct tapasco_jobs_magazine *next; // list of all magazines of jobs
+  atomic_flag busy;                   // see mag_lock
+  size_t cnt;
+  fsp_idx_t idx[TAPASCO_JOBS_MAGAZINE_SZ];
+};
+
 struct tapasco_jobs {
   tapasco_dev_id_t dev_id;
   tapasco_job_id_t job_id_high_watermark;
+  pthread_key_t mag_key;
+  pthread_mutex_t mag_mtx;
+  struct tapasco_jobs_magazine *mags;
+  pthread_mutex_t wait_mtx;
+  pthread_cond_t wait_cv;
+  _Atomic int waiters; // threads blocked in tapasco_jobs_acquire_wait
   struct tapasco_jobs_fsp_t q;
+  struct tapasco_job_ext_fsp_t ext;
 };
 
+/* Magazines are locked by a flag: owners hold it for a few instructions,
+ * other threads take it only to drain the magazine. */
+static inline void mag_lock(struct tapasco_jobs_magazine *mag) {
+  while (atomic_flag_test_and_set_explicit(&mag->busy, memory_order_acquire))
+    sched_yield();
+}
+
+static inline void mag_unlock(struct tapasco_jobs_magazine *mag) {
+  atomic_flag_clear_explicit(&mag->busy, memory_order_release);
+}
+
+/* Returns the job ids of an exiting thread to the pool. */
+static void destroy_magazine(void *p) {
+  struct tapasco_jobs_magazine *mag = (struct tapasco_jobs_magazine *)p;
+  tapasco_jobs_t *jobs = mag->jobs;
+  pthread_mutex_lock(&jobs->mag_mtx);
+  struct tapasco_jobs_magazine **m = &jobs->mags;
+  while (*m != mag)
+    m = &(*m)->next;
+  *m = mag->next;
+  pthread_mutex_unlock(&jobs->mag_mtx);
+  tapasco_jobs_fsp_put_n(&jobs->q, mag->idx, mag->cnt);
+  free(mag);
+  // waiters may be blocked on the ids of this thread
+  if (__atomic_load_n(&jobs->waiters, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&jobs->wait_mtx);
+    pthread_cond_broadcast(&jobs->wait_cv);
+    pthread_mutex_unlock(&jobs->wait_mtx);
+  }
+}
+
+/* Returns the cached ids of all threads to the pool; returns their number. */
+static size_t drain_magazines(tapasco_jobs_t *jobs) {
+  size_t n = 0;
+  pthread_mutex_lock(&jobs->mag_mtx);
+  for (struct tapasco_jobs_magazine *m = jobs->mags; m; m = m->next) {
+    mag_lock(m);
+    tapasco_jobs_fsp_put_n(&jobs->q, m->idx, m->cnt);
+    n += m->cnt;
+    m->cnt = 0;
+    mag_unlock(m);
+  }
+  pthread_mutex_unlock(&jobs->mag_mtx);
+  return n;
+}
+
+static inline struct tapasco_jobs_magazine *get_magazine(tapasco_jobs_t *jobs) {
+  struct tapasco_jobs_magazine *mag =
+      (struct tapasco_jobs_magazine *)pthread_getspecific(jobs->mag_key);
+  if (mag)
+    return mag;
+  if (!(mag = (struct tapasco_jobs_magazine *)calloc(sizeof(*mag), 1)))
+    return NULL;
+  mag->jobs = jobs;
+  atomic_flag_clear(&mag->busy);
+  pthread_mutex_lock(&jobs->mag_mtx);
+  mag->next = jobs->mags;
+  jobs->mags = mag;
+  pthread_mutex_unlock(&jobs->mag_mtx);
+  pthread_setspecific(jobs->mag_key, mag);
+  return mag;
+}
+
 tapasco_res_t tapasco_jobs_init(tapasco_dev_id_t dev_id,
                                 tapasco_jobs_t **jobs) {
   *jobs = (tapasco_jobs_t *)calloc(sizeof(tapasco_jobs_t), 1);
   if (!jobs)
     return TAPASCO_ERR_OUT_OF_MEMORY;
   (*jobs)->dev_id = dev_id;
+  if (pthread_key_create(&(*jobs)->mag_key, destroy_magazine)) {
+    free(*jobs);
+    return TAPASCO_ERR_PTHREAD_ERROR;
+  }
+  pthread_mutex_init(&(*jobs)->mag_mtx, NULL);
+  pthread_mutex_init(&(*jobs)->wait_mtx, NULL);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&(*jobs)->wait_cv, &attr);
+  pthread_condattr_destroy(&attr);
   tapasco_jobs_fsp_init(&(*jobs)->q);
+  tapasco_job_ext_fsp_init(&(*jobs)->ext);
   return TAPASCO_SUCCESS;
 }
 
-void tapasco_jobs_deinit(tapasco_jobs_t *jobs) { free(jobs); }
+void tapasco_jobs_deinit(tapasco_jobs_t *jobs) {
+  // no destructors are called after this, free remaining magazines here
+  pthread_key_delete(jobs->mag_key);
+  while (jobs->mags) {
+    struct tapasco_jobs_magazine *mag = jobs->mags;
+    jobs->mags = mag->next;
+    free(mag);
+  }
+  pthread_mutex_destroy(&jobs->mag_mtx);
+  pthread_cond_destroy(&jobs->wait_cv);
+  pthread_mutex_destroy(&jobs->wait_mtx);
+  free(jobs);
+}
 
 inline tapasco_kernel_id_t
 tapasco_jobs_get_kernel_id(tapasco_jobs_t const *jobs,
@@ -99,6 +252,18 @@ inline void tapasco_jobs_set_kernel_id(tapasco_jobs_t *jobs,
   jobs->q.elems[j_id - JOB_ID_OFFSET].k_id = k_id;
 }
 
+inline tapasco_kernel_t *tapasco_jobs_get_kernel(tapasco_jobs_t const *jobs,
+                                                 tapasco_job_id_t const j_id) {
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].kernel;
+}
+
+inline void tapasco_jobs_set_kernel(tapasco_jobs_t *jobs,
+                                    tapasco_job_id_t const j_id,
+                                    tapasco_kernel_t *kernel) {
+  assert(jobs);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].kernel = kernel;
+}
+
 inline tapasco_job_state_t tapasco_jobs_get_state(tapasco_jobs_t const *jobs,
                                                   tapasco_job_id_t const j_id) {
   return jobs->q.elems[j_id - JOB_ID_OFFSET].state;
@@ -111,6 +276,90 @@ tapasco_jobs_set_state(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
   return jobs->q.elems[j_id - JOB_ID_OFFSET].state = new_state;
 }
 
+int tapasco_jobs_cas_state(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                           tapasco_job_state_t const expected,
+                           tapasco_job_state_t const desired) {
+  assert(jobs);
+  tapasco_job_t *job = &jobs->q.elems[j_id - JOB_ID_OFFSET];
+  tapasco_job_state_t e = expected;
+  return __atomic_compare_exchange_n(&job->state, &e, desired, 0,
+                                     __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+int tapasco_jobs_abort(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                       tapasco_job_state_t const expected, int const held) {
+  assert(jobs);
+  tapasco_job_t *job = &jobs->q.elems[j_id - JOB_ID_OFFSET];
+  // holder releases only after it has seen the abort
+  if (held)
+    atomic_store(&job->refs, 2);
+  if (tapasco_jobs_cas_state(jobs, j_id, expected, TAPASCO_JOB_STATE_ABORTED))
+    return 1;
+  atomic_store(&job->refs, 0);
+  return 0;
+}
+
+void tapasco_jobs_set_persistent(tapasco_jobs_t *jobs,
+                                 tapasco_job_id_t const j_id) {
+  assert(jobs);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].persistent = 1;
+}
+
+int tapasco_jobs_is_persistent(tapasco_jobs_t const *jobs,
+                               tapasco_job_id_t const j_id) {
+  assert(jobs);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].persistent;
+}
+
+int tapasco_jobs_rearm(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id) {
+  assert(jobs);
+  tapasco_job_t *job = &jobs->q.elems[j_id - JOB_ID_OFFSET];
+  if (!job->persistent ||
+      (!tapasco_jobs_cas_state(jobs, j_id, TAPASCO_JOB_STATE_FINISHED,
+                               TAPASCO_JOB_STATE_REQUESTED) &&
+       !tapasco_jobs_cas_state(jobs, j_id, TAPASCO_JOB_STATE_FAILED,
+                               TAPASCO_JOB_STATE_REQUESTED)))
+    return 0;
+  atomic_store(&job->signaled, 0);
+  job->ret.ret64 = 0;
+  for (uint32_t m = job->transfer_map; m; m &= m - 1)
+    job->ext->t[__builtin_ctz(m)].preloaded = 0;
+  return 1;
+}
+
+uint32_t tapasco_jobs_take_dirty(tapasco_jobs_t *jobs,
+                                 tapasco_job_id_t const j_id) {
+  assert(jobs);
+  tapasco_job_t *job = &jobs->q.elems[j_id - JOB_ID_OFFSET];
+  uint32_t const dirty = job->dirty;
+  job->dirty = 0;
+  return dirty;
+}
+
+uint64_t tapasco_jobs_get_tag(tapasco_jobs_t const *jobs,
+                              tapasco_job_id_t const j_id) {
+  assert(jobs);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].tag;
+}
+
+void tapasco_jobs_set_tag(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                          uint64_t const tag) {
+  assert(jobs);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].tag = tag;
+}
+
+void tapasco_jobs_set_signaled(tapasco_jobs_t *jobs,
+                               tapasco_job_id_t const j_id) {
+  assert(jobs);
+  atomic_store(&jobs->q.elems[j_id - JOB_ID_OFFSET].signaled, 1);
+}
+
+int tapasco_jobs_get_signaled(tapasco_jobs_t *jobs,
+                              tapasco_job_id_t const j_id) {
+  assert(jobs);
+  return atomic_load(&jobs->q.elems[j_id - JOB_ID_OFFSET].signaled);
+}
+
 inline tapasco_res_t tapasco_jobs_get_return(tapasco_jobs_t const *jobs,
                                              tapasco_job_id_t const j_id,
                                              size_t const ret_len,
@@ -158,7 +407,10 @@ tapasco_transfer_t *tapasco_jobs_get_arg_transfer(tapasco_jobs_t *jobs,
                                                   size_t const arg_idx) {
   assert(jobs);
   assert(arg_idx < jobs->q.elems[j_id - JOB_ID_OFFSET].args_len);
-  return &jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx];
+  tapasco_job_t const *job = &jobs->q.elems[j_id - JOB_ID_OFFSET];
+  if (!(job->transfer_map & (1U << arg_idx)))
+    return NULL;
+  return &job->ext->t[arg_idx];
 }
 
 inline tapasco_res_t tapasco_jobs_get_arg(tapasco_jobs_t *jobs,
@@ -207,11 +459,32 @@ inline tapasco_res_t tapasco_jobs_set_arg(tapasco_jobs_t *jobs,
     jobs->q.elems[j_id - JOB_ID_OFFSET].args[arg_idx].v64 = v;
     jobs->q.elems[j_id - JOB_ID_OFFSET].args_sz |= 1 << arg_idx;
   }
+  jobs->q.elems[j_id - JOB_ID_OFFSET].dirty |= 1U << arg_idx;
   if (jobs->q.elems[j_id - JOB_ID_OFFSET].args_len < arg_idx + 1)
     jobs->q.elems[j_id - JOB_ID_OFFSET].args_len = arg_idx + 1;
   return TAPASCO_SUCCESS;
 }
 
+/* Returns a cleared transfer descriptor for arg_idx and marks it as used;
+ * attaches the cold part to the job, if necessary. */
+static tapasco_transfer_t *get_ext_transfer(tapasco_jobs_t *jobs,
+                                            tapasco_job_t *job,
+                                            size_t const arg_idx) {
+  if (!job->ext) {
+    fsp_idx_t const idx = tapasco_job_ext_fsp_get(&jobs->ext);
+    // cannot happen, there is one per job
+    if (idx == INVALID_IDX)
+      return NULL;
+    job->ext = &jobs->ext.elems[idx];
+  }
+  tapasco_transfer_t *t = &job->ext->t[arg_idx];
+  memset(t, 0, sizeof(*t));
+  job->transfer_map |= 1U << arg_idx;
+  if (job->args_len < arg_idx + 1)
+    job->args_len = arg_idx + 1;
+  return t;
+}
+
 inline tapasco_res_t
 tapasco_jobs_set_arg_transfer(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
                               size_t const arg_idx, size_t const arg_len,
@@ -225,16 +498,107 @@ tapasco_jobs_set_arg_transfer(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
   if (j_id - JOB_ID_OFFSET > TAPASCO_JOBS_Q_SZ)
     return TAPASCO_ERR_JOB_ID_NOT_FOUND;
 
-  jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].len = arg_len;
-  jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].data = arg_value;
-  jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].flags = flags;
-  jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].dir_flags = dir_flags;
-  jobs->q.elems[j_id - JOB_ID_OFFSET].transfers[arg_idx].preloaded = 0;
-  if (jobs->q.elems[j_id - JOB_ID_OFFSET].args_len < arg_idx + 1)
-    jobs->q.elems[j_id - JOB_ID_OFFSET].args_len = arg_idx + 1;
+  tapasco_job_t *job = &jobs->q.elems[j_id - JOB_ID_OFFSET];
+  tapasco_transfer_t *t = get_ext_transfer(jobs, job, arg_idx);
+  if (!t)
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  t->len = arg_len;
+  t->data = arg_value;
+  t->flags = flags;
+  t->dir_flags = dir_flags;
+  job->dirty |= 1U << arg_idx;
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_jobs_add_edge(tapasco_jobs_t *jobs,
+                                    tapasco_job_id_t const src,
+                                    size_t const src_arg,
+                                    tapasco_job_id_t const dst,
+                                    size_t const dst_arg) {
+  assert(jobs);
+  if (src_arg >= TAPASCO_JOB_MAX_ARGS || dst_arg >= TAPASCO_JOB_MAX_ARGS)
+    return TAPASCO_ERR_INVALID_ARG_INDEX;
+  if (src == dst || src - JOB_ID_OFFSET >= TAPASCO_JOBS_Q_SZ ||
+      dst - JOB_ID_OFFSET >= TAPASCO_JOBS_Q_SZ)
+    return TAPASCO_ERR_JOB_ID_NOT_FOUND;
+
+  tapasco_job_t *s = &jobs->q.elems[src - JOB_ID_OFFSET];
+  tapasco_job_t *d = &jobs->q.elems[dst - JOB_ID_OFFSET];
+  if (s->state != TAPASCO_JOB_STATE_REQUESTED ||
+      d->state != TAPASCO_JOB_STATE_REQUESTED)
+    return TAPASCO_ERR_JOB_ID_NOT_FOUND;
+  if (!(s->transfer_map & (1U << src_arg)))
+    return TAPASCO_ERR_INVALID_ARG_INDEX;
+  tapasco_transfer_t *st = &s->ext->t[src_arg];
+  // PE-local memory is not reachable from the PE of the consumer
+  if (st->flags & TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL)
+    return TAPASCO_ERR_PE_LOCAL_MEMORY_NOT_SUPPORTED;
+  if (s->num_succ >= TAPASCO_JOB_MAX_SUCCESSORS)
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  if (!st->shared) {
+    st->shared = (tapasco_shared_buffer_t *)calloc(sizeof(*st->shared), 1);
+    if (!st->shared)
+      return TAPASCO_ERR_OUT_OF_MEMORY;
+    st->shared->refs = 1; // reference of the producer
+  }
+
+  tapasco_shared_buffer_t *buf = st->shared;
+  size_t const len = st->len;
+  tapasco_device_alloc_flag_t const flags = st->flags;
+  tapasco_transfer_t *dt = get_ext_transfer(jobs, d, dst_arg);
+  if (!dt)
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  dt->len = len;
+  dt->flags = flags;
+  dt->dir_flags = TAPASCO_COPY_DIRECTION_NONE;
+  dt->shared = buf;
+  __atomic_add_fetch(&buf->refs, 1, __ATOMIC_SEQ_CST);
+  s->ext->succ[s->num_succ++] = dst;
+  // first edge also accounts for the launch of dst
+  d->deps = d->deps ? d->deps + 1 : 2;
   return TAPASCO_SUCCESS;
 }
 
+size_t tapasco_jobs_num_successors(tapasco_jobs_t const *jobs,
+                                   tapasco_job_id_t const j_id) {
+  assert(jobs);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].num_succ;
+}
+
+size_t tapasco_jobs_take_successors(tapasco_jobs_t *jobs,
+                                    tapasco_job_id_t const j_id,
+                                    tapasco_job_id_t *succ) {
+  assert(jobs);
+  tapasco_job_t *job = &jobs->q.elems[j_id - JOB_ID_OFFSET];
+  size_t const n = atomic_exchange(&job->num_succ, 0);
+  for (size_t i = 0; i < n; ++i)
+    succ[i] = job->ext->succ[i];
+  return n;
+}
+
+int tapasco_jobs_has_deps(tapasco_jobs_t const *jobs,
+                          tapasco_job_id_t const j_id) {
+  assert(jobs);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].deps > 0;
+}
+
+int tapasco_jobs_dec_deps(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id) {
+  assert(jobs);
+  return atomic_fetch_sub(&jobs->q.elems[j_id - JOB_ID_OFFSET].deps, 1) - 1;
+}
+
+void tapasco_jobs_set_deps_failed(tapasco_jobs_t *jobs,
+                                  tapasco_job_id_t const j_id) {
+  assert(jobs);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].deps_failed = 1;
+}
+
+int tapasco_jobs_deps_failed(tapasco_jobs_t const *jobs,
+                             tapasco_job_id_t const j_id) {
+  assert(jobs);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].deps_failed;
+}
+
 inline tapasco_res_t tapasco_jobs_set_return(tapasco_jobs_t *jobs,
                                              tapasco_job_id_t const j_id,
                                              size_t const ret_len,
@@ -278,24 +642,197 @@ void tapasco_jobs_set_slot(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
   jobs->q.elems[j_id - JOB_ID_OFFSET].slot = slot_id;
 }
 
+tapasco_cq_t *tapasco_jobs_get_cq(tapasco_jobs_t const *jobs,
+                                  tapasco_job_id_t const j_id) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].cq;
+}
+
+void tapasco_jobs_set_cq(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                         tapasco_cq_t *cq) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].cq = cq;
+}
+
+uint32_t tapasco_jobs_get_poll_budget(tapasco_jobs_t const *jobs,
+                                      tapasco_job_id_t const j_id) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].poll_ns;
+}
+
+void tapasco_jobs_set_poll_budget(tapasco_jobs_t *jobs,
+                                  tapasco_job_id_t const j_id,
+                                  uint32_t const budget_ns) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].poll_ns = budget_ns;
+}
+
+tapasco_job_priority_t tapasco_jobs_get_priority(tapasco_jobs_t const *jobs,
+                                                 tapasco_job_id_t const j_id) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].prio;
+}
+
+void tapasco_jobs_set_priority(tapasco_jobs_t *jobs,
+                               tapasco_job_id_t const j_id,
+                               tapasco_job_priority_t const prio) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].prio = prio;
+}
+
+uint64_t tapasco_jobs_get_deadline(tapasco_jobs_t const *jobs,
+                                   tapasco_job_id_t const j_id) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].deadline_ns;
+}
+
+void tapasco_jobs_set_deadline(tapasco_jobs_t *jobs,
+                               tapasco_job_id_t const j_id,
+                               uint64_t const deadline_ns) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].deadline_ns = deadline_ns;
+}
+
+uint64_t tapasco_jobs_get_queued(tapasco_jobs_t const *jobs,
+                                 tapasco_job_id_t const j_id) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  return jobs->q.elems[j_id - JOB_ID_OFFSET].queued_ns;
+}
+
+void tapasco_jobs_set_queued(tapasco_jobs_t *jobs, tapasco_job_id_t const j_id,
+                             uint64_t const queued_ns) {
+  assert(jobs);
+  assert(j_id - JOB_ID_OFFSET < TAPASCO_JOBS_Q_SZ);
+  jobs->q.elems[j_id - JOB_ID_OFFSET].queued_ns = queued_ns;
+}
+
+static inline tapasco_job_id_t claim_job(tapasco_jobs_t *jobs,
+                                         fsp_idx_t const idx) {
+  jobs->q.elems[idx].state = TAPASCO_JOB_STATE_REQUESTED;
+  tapasco_job_id_t const j_id = jobs->q.elems[idx].id;
+  if (j_id > jobs->job_id_high_watermark) {
+    jobs->job_id_high_watermark = j_id;
+    tapasco_perfc_job_id_high_watermark_set(jobs->dev_id, j_id);
+  }
+  return j_id;
+}
+
 inline tapasco_job_id_t tapasco_jobs_acquire(tapasco_jobs_t *jobs) {
   assert(jobs);
-  tapasco_job_id_t j_id = tapasco_jobs_fsp_get(&jobs->q);
-  if (j_id != INVALID_IDX) {
-    jobs->q.elems[j_id].state = TAPASCO_JOB_STATE_REQUESTED;
-    j_id = jobs->q.elems[j_id].id;
-    if (j_id > jobs->job_id_high_watermark) {
-      jobs->job_id_high_watermark = j_id;
-      tapasco_perfc_job_id_high_watermark_set(jobs->dev_id, j_id);
-    }
-    return j_id;
+  struct tapasco_jobs_magazine *mag = get_magazine(jobs);
+  fsp_idx_t idx = INVALID_IDX;
+  if (mag) {
+    mag_lock(mag);
+    // refill half of the magazine, the other half is left for releases
+    if (!mag->cnt)
+      mag->cnt = tapasco_jobs_fsp_get_n(&jobs->q, mag->idx,
+                                        TAPASCO_JOBS_MAGAZINE_SZ / 2);
+    if (mag->cnt)
+      idx = mag->idx[--mag->cnt];
+    mag_unlock(mag);
+  } else {
+    idx = tapasco_jobs_fsp_get(&jobs->q);
   }
+  // pool is empty: take back the ids cached by other threads
+  if (idx == INVALID_IDX && drain_magazines(jobs))
+    idx = tapasco_jobs_fsp_get(&jobs->q);
+  if (idx != INVALID_IDX)
+    return claim_job(jobs, idx);
+  tapasco_perfc_job_ids_exhausted_inc(jobs->dev_id);
   return 0;
 }
 
+tapasco_job_id_t tapasco_jobs_acquire_wait(tapasco_jobs_t *jobs,
+                                           struct timespec const *deadline) {
+  assert(jobs);
+  tapasco_job_id_t const j_id = tapasco_jobs_acquire(jobs);
+  if (j_id)
+    return j_id;
+  fsp_idx_t idx;
+  int r = 0;
+  pthread_mutex_lock(&jobs->wait_mtx);
+  // announce first, releases bypass the magazines while there are waiters;
+  // ids released to a magazine before are taken back by draining it
+  __atomic_add_fetch(&jobs->waiters, 1, __ATOMIC_SEQ_CST);
+  while ((idx = tapasco_jobs_fsp_get(&jobs->q)) == INVALID_IDX &&
+         r != ETIMEDOUT) {
+    if (drain_magazines(jobs))
+      continue;
+    r = deadline ? pthread_cond_timedwait(&jobs->wait_cv, &jobs->wait_mtx,
+                                          deadline)
+                 : pthread_cond_wait(&jobs->wait_cv, &jobs->wait_mtx);
+  }
+  __atomic_sub_fetch(&jobs->waiters, 1, __ATOMIC_SEQ_CST);
+  pthread_mutex_unlock(&jobs->wait_mtx);
+  return idx != INVALID_IDX ? claim_job(jobs, idx) : 0;
+}
+
 inline void tapasco_jobs_release(tapasco_jobs_t *jobs,
                                  tapasco_job_id_t const j_id) {
   assert(jobs);
-  jobs->q.elems[j_id - JOB_ID_OFFSET].state = TAPASCO_JOB_STATE_READY;
-  tapasco_jobs_fsp_put(&jobs->q, j_id - JOB_ID_OFFSET);
+  tapasco_job_t *job = &jobs->q.elems[j_id - JOB_ID_OFFSET];
+  // aborted job still held by a queue or worker: last release recycles it
+  if (atomic_load(&job->refs) && atomic_fetch_sub(&job->refs, 1) > 1)
+    return;
+  job->state = TAPASCO_JOB_STATE_READY;
+  job->cq = NULL;
+  job->poll_ns = 0;
+  job->prio = TAPASCO_JOB_PRIORITY_NORMAL;
+  job->deadline_ns = 0;
+  job->signaled = 0;
+  job->persistent = 0;
+  job->dirty = 0;
+  job->tag = 0;
+  job->args_len = 0;
+  job->args_sz = 0;
+  job->transfer_map = 0;
+  // recently used cold parts are handed out first, whichever job needs one
+  if (job->ext) {
+    tapasco_job_ext_fsp_put(&jobs->ext, job->ext - jobs->ext.elems);
+    job->ext = NULL;
+  }
+  job->num_succ = 0;
+  job->deps = 0;
+  job->deps_failed = 0;
+  struct tapasco_jobs_magazine *mag = get_magazine(jobs);
+  if (!mag) {
+    tapasco_jobs_fsp_put(&jobs->q, j_id - JOB_ID_OFFSET);
+    if (__atomic_load_n(&jobs->waiters, __ATOMIC_SEQ_CST)) {
+      pthread_mutex_lock(&jobs->wait_mtx);
+      pthread_cond_broadcast(&jobs->wait_cv);
+      pthread_mutex_unlock(&jobs->wait_mtx);
+    }
+    return;
+  }
+  // waiters are checked under the magazine lock: a waiter announced later
+  // drains the magazine after this id was put into it
+  mag_lock(mag);
+  if (__atomic_load_n(&jobs->waiters, __ATOMIC_SEQ_CST)) {
+    // hand this id and all cached ids to the blocked threads
+    tapasco_jobs_fsp_put(&jobs->q, j_id - JOB_ID_OFFSET);
+    tapasco_jobs_fsp_put_n(&jobs->q, mag->idx, mag->cnt);
+    mag->cnt = 0;
+    mag_unlock(mag);
+    pthread_mutex_lock(&jobs->wait_mtx);
+    pthread_cond_broadcast(&jobs->wait_cv);
+    pthread_mutex_unlock(&jobs->wait_mtx);
+    return;
+  }
+  // magazine is full: drain upper half back to the pool
+  if (mag->cnt == TAPASCO_JOBS_MAGAZINE_SZ) {
+    mag->cnt = TAPASCO_JOBS_MAGAZINE_SZ / 2;
+    tapasco_jobs_fsp_put_n(&jobs->q, &mag->idx[mag->cnt],
+                           TAPASCO_JOBS_MAGAZINE_SZ - mag->cnt);
+  }
+  mag->idx[mag->cnt++] = j_id - JOB_ID_OFFSET;
+  mag_unlock(mag);
 }
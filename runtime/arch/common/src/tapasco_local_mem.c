@@ -24,23 +24,40 @@
 #include <gen_mem.h>
 #include <platform.h>
 #include <platform_info.h>
+#include <pthread.h>
 #include <stdlib.h>
+#include <string.h>
 #include <tapasco_device.h>
 #include <tapasco_errors.h>
 #include <tapasco_global.h>
 #include <tapasco_local_mem.h>
 #include <tapasco_logging.h>
+#include <tapasco_perfc.h>
 
 typedef struct {
   addr_t base;
   addr_t high;
 } address_space_t;
 
+/* Buffer of host data kept in a local memory between jobs. */
+typedef struct {
+  void const *data;     // host data the buffer belongs to
+  size_t len;           // length in bytes
+  tapasco_handle_t h;   // PE-local address
+  void *shadow;         // last known device contents
+  int busy;             // in use by a job
+  int valid;            // shadow matches device contents
+  unsigned long used;   // last use, for eviction
+} resident_t;
+
 struct tapasco_local_mem {
   tapasco_dev_id_t dev_id;
   tapasco_devctx_t *devctx;
   address_space_t as[PLATFORM_NUM_SLOTS];
-  block_t *lmem[PLATFORM_NUM_SLOTS];
+  gen_mem_t *lmem[PLATFORM_NUM_SLOTS];
+  pthread_mutex_t mtx;
+  unsigned long clock;
+  resident_t res[PLATFORM_NUM_SLOTS][TAPASCO_LOCAL_MEM_RESIDENT];
 };
 
 static inline size_t get_slot_mem(tapasco_devctx_t *devctx,
@@ -69,6 +86,7 @@ tapasco_res_t tapasco_local_mem_init(tapasco_devctx_t *devctx,
     return TAPASCO_ERR_OUT_OF_MEMORY;
   (*lmem)->dev_id = devctx->id;
   (*lmem)->devctx = devctx;
+  pthread_mutex_init(&(*lmem)->mtx, NULL);
   addr_t base = 0;
   for (tapasco_slot_id_t idx = 0; idx < TAPASCO_NUM_SLOTS; ++idx) {
     size_t const sz = get_slot_mem(devctx, idx);
@@ -89,6 +107,13 @@ tapasco_res_t tapasco_local_mem_init(tapasco_devctx_t *devctx,
 
 void tapasco_local_mem_deinit(tapasco_local_mem_t *lmem) {
   if (lmem) {
+    for (tapasco_slot_id_t idx = 0; idx < PLATFORM_NUM_SLOTS; ++idx) {
+      for (size_t i = 0; i < TAPASCO_LOCAL_MEM_RESIDENT; ++i)
+        free(lmem->res[idx][i].shadow);
+      if (lmem->lmem[idx])
+        gen_mem_destroy(&lmem->lmem[idx]);
+    }
+    pthread_mutex_destroy(&lmem->mtx);
     DEVLOG(lmem->dev_id, LALL_MEM, "destroyed");
     free(lmem);
   }
@@ -99,7 +124,9 @@ tapasco_res_t tapasco_local_mem_alloc(tapasco_local_mem_t *lmem,
                                       size_t const sz, tapasco_handle_t *h) {
   tapasco_slot_id_t slot_id_local =
       tapasco_local_mem_get_slot(lmem->devctx, slot_id);
+  pthread_mutex_lock(&lmem->mtx);
   *h = gen_mem_malloc(&lmem->lmem[slot_id_local], sz);
+  pthread_mutex_unlock(&lmem->mtx);
 
   DEVLOG(lmem->dev_id, LALL_MEM,
          "request to allocate %zd bytes for slot_id #" PRIslot "-> " PRIhandle,
@@ -116,7 +143,138 @@ void tapasco_local_mem_dealloc(tapasco_local_mem_t *lmem,
   DEVLOG(lmem->dev_id, LALL_MEM,
          "request to free %zd bytes at slot_id #" PRIslot ": " PRIhandle, sz,
          slot_id_local, h);
+  pthread_mutex_lock(&lmem->mtx);
   gen_mem_free(&lmem->lmem[slot_id_local], h, sz);
+  pthread_mutex_unlock(&lmem->mtx);
+}
+
+/* Frees the least recently used idle resident buffer of a memory; returns 0,
+ * if there was none. Caller must hold the lock. */
+static int evict(tapasco_local_mem_t *lmem, tapasco_slot_id_t const m) {
+  resident_t *v = NULL;
+  for (size_t i = 0; i < TAPASCO_LOCAL_MEM_RESIDENT; ++i) {
+    resident_t *r = &lmem->res[m][i];
+    if (r->len && !r->busy && (!v || r->used < v->used))
+      v = r;
+  }
+  if (!v)
+    return 0;
+  DEVLOG(lmem->dev_id, LALL_MEM,
+         "evicting %zd bytes at " PRIhandle " of slot_id #" PRIslot, v->len,
+         v->h, m);
+  gen_mem_free(&lmem->lmem[m], v->h, v->len);
+  free(v->shadow);
+  memset(v, 0, sizeof(*v));
+  return 1;
+}
+
+tapasco_res_t tapasco_local_mem_acquire(tapasco_local_mem_t *lmem,
+                                        tapasco_slot_id_t const slot_id,
+                                        void const *data, size_t const len,
+                                        tapasco_handle_t *h, int *valid) {
+  tapasco_slot_id_t const m = tapasco_local_mem_get_slot(lmem->devctx, slot_id);
+  resident_t *e = NULL;
+  if (m >= PLATFORM_NUM_SLOTS || !lmem->lmem[m])
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  pthread_mutex_lock(&lmem->mtx);
+  for (size_t i = 0; i < TAPASCO_LOCAL_MEM_RESIDENT && !e; ++i) {
+    resident_t *r = &lmem->res[m][i];
+    if (r->data == data && r->len == len && !r->busy)
+      e = r;
+  }
+  if (e) {
+    *valid = e->valid && !memcmp(e->shadow, data, len);
+  } else {
+    void *shadow = malloc(len);
+    addr_t a = INVALID_ADDRESS;
+    if (shadow)
+      while ((a = gen_mem_malloc(&lmem->lmem[m], len)) == INVALID_ADDRESS &&
+             evict(lmem, m))
+        ;
+    if (a == INVALID_ADDRESS) {
+      pthread_mutex_unlock(&lmem->mtx);
+      free(shadow);
+      return TAPASCO_ERR_OUT_OF_MEMORY;
+    }
+    // take a free entry, or replace the least recently used idle one
+    for (size_t i = 0; i < TAPASCO_LOCAL_MEM_RESIDENT; ++i) {
+      resident_t *r = &lmem->res[m][i];
+      if (!r->len) {
+        e = r;
+        break;
+      }
+      if (!r->busy && (!e || r->used < e->used))
+        e = r;
+    }
+    if (e && e->len) {
+      gen_mem_free(&lmem->lmem[m], e->h, e->len);
+      free(e->shadow);
+    }
+    if (!e) {
+      // all entries busy: plain allocation, not kept resident
+      pthread_mutex_unlock(&lmem->mtx);
+      free(shadow);
+      *h = a;
+      *valid = 0;
+      return TAPASCO_SUCCESS;
+    }
+    e->data = data;
+    e->len = len;
+    e->h = a;
+    e->shadow = shadow;
+    *valid = 0;
+  }
+  e->busy = 1;
+  e->valid = 0;
+  e->used = ++lmem->clock;
+  *h = e->h;
+  pthread_mutex_unlock(&lmem->mtx);
+  if (*valid)
+    tapasco_perfc_lmem_resident_hits_inc(lmem->dev_id);
+  DEVLOG(lmem->dev_id, LALL_MEM,
+         "%zd bytes of %p at " PRIhandle " of slot_id #" PRIslot " (%s)", len,
+         data, *h, m, *valid ? "resident" : "needs copy");
+  return TAPASCO_SUCCESS;
+}
+
+void tapasco_local_mem_release(tapasco_local_mem_t *lmem,
+                               tapasco_slot_id_t const slot_id,
+                               tapasco_handle_t const h, size_t const len,
+                               void const *contents) {
+  tapasco_slot_id_t const m = tapasco_local_mem_get_slot(lmem->devctx, slot_id);
+  pthread_mutex_lock(&lmem->mtx);
+  for (size_t i = 0; i < TAPASCO_LOCAL_MEM_RESIDENT; ++i) {
+    resident_t *r = &lmem->res[m][i];
+    if (r->busy && r->h == h && r->len == len) {
+      if (contents)
+        memcpy(r->shadow, contents, len);
+      r->valid = contents != NULL;
+      r->busy = 0;
+      pthread_mutex_unlock(&lmem->mtx);
+      return;
+    }
+  }
+  // not resident, see tapasco_local_mem_acquire
+  gen_mem_free(&lmem->lmem[m], h, len);
+  pthread_mutex_unlock(&lmem->mtx);
+}
+
+tapasco_slot_id_t tapasco_local_mem_find(tapasco_local_mem_t *lmem,
+                                         void const *data, size_t const len) {
+  pthread_mutex_lock(&lmem->mtx);
+  for (tapasco_slot_id_t m = 0; m < PLATFORM_NUM_SLOTS; ++m) {
+    if (!lmem->lmem[m])
+      continue;
+    for (size_t i = 0; i < TAPASCO_LOCAL_MEM_RESIDENT; ++i) {
+      resident_t const *r = &lmem->res[m][i];
+      if (r->data == data && r->len == len && !r->busy) {
+        pthread_mutex_unlock(&lmem->mtx);
+        return m;
+      }
+    }
+  }
+  pthread_mutex_unlock(&lmem->mtx);
+  return PLATFORM_NUM_SLOTS;
 }
 
 inline size_t tapasco_local_mem_get_size(tapasco_local_mem_t *lmem,
@@ -126,7 +284,7 @@ inline size_t tapasco_local_mem_get_size(tapasco_local_mem_t *lmem,
 
 inline size_t tapasco_local_mem_get_free(tapasco_local_mem_t *lmem,
                                          tapasco_slot_id_t const slot_id) {
-  return lmem->as[slot_id].high - gen_mem_next_base(lmem->lmem[slot_id]);
+  return lmem->lmem[slot_id] ? gen_mem_available(lmem->lmem[slot_id]) : 0;
 }
 
 inline tapasco_slot_id_t tapasco_local_mem_get_slot(tapasco_devctx_t *devctx,
@@ -138,3 +296,11 @@ inline tapasco_slot_id_t tapasco_local_mem_get_slot(tapasco_devctx_t *devctx,
 
   return slot_id;
 }
+
+tapasco_slot_id_t tapasco_local_mem_of_pe(tapasco_devctx_t const *devctx,
+                                          tapasco_slot_id_t const slot_id) {
+  tapasco_slot_id_t const m = slot_id + 1;
+  return m < TAPASCO_NUM_SLOTS && devctx->pdctx->info.composition.memory[m]
+             ? m
+             : TAPASCO_NUM_SLOTS;
+}
@@ -28,6 +28,8 @@
 #include <stdarg.h>
 #include <stdint.h>
 #include <string.h>
+#include <tapasco_bufpool.h>
+#include <tapasco_copies.h>
 #include <tapasco_device.h>
 #include <tapasco_errors.h>
 #include <tapasco_local_mem.h>
@@ -47,7 +49,7 @@ static tapasco_res_t tapasco_device_free_local(
     tapasco_device_alloc_flag_t const flags, tapasco_slot_id_t slot_id) {
   LOG(LALL_MEM, "freeing %zd bytes of pe-local memory for slot #" PRIslot, len,
       slot_id);
-  tapasco_local_mem_dealloc(devctx->lmem, slot_id, len, h);
+  tapasco_local_mem_dealloc(devctx->lmem, slot_id, h, len);
   return TAPASCO_SUCCESS;
 }
 
@@ -151,6 +153,10 @@ tapasco_res_t tapasco_device_alloc(tapasco_devctx_t *devctx,
     return tapasco_device_alloc_local(devctx, h, len, flags, s_id);
   }
   r = platform_alloc(p, len, &addr, PLATFORM_ALLOC_FLAGS_NONE);
+  // idle buffers of the pool may block the allocation
+  if (r != PLATFORM_SUCCESS && devctx->bufpool &&
+      tapasco_bufpool_trim(devctx->bufpool))
+    r = platform_alloc(p, len, &addr, PLATFORM_ALLOC_FLAGS_NONE);
   if (r == PLATFORM_SUCCESS) {
     LOG(LALL_MEM, "allocated %zd bytes at " PRImem, len, addr);
     *h = addr;
@@ -182,15 +188,25 @@ tapasco_res_t tapasco_device_copy_to(tapasco_devctx_t *devctx, void const *src,
                                      tapasco_device_copy_flag_t const flags,
                                      ...) {
   platform_devctx_t *p = devctx->pdctx;
+  tapasco_slot_id_t slot_id = 0;
   LOG(LALL_MEM, "dst = " PRIhandle ", len = %zd, flags = " PRIflags, dst, len,
       (CSTflags)flags);
-  if (flags & TAPASCO_DEVICE_COPY_NONBLOCKING)
-    return TAPASCO_ERR_NONBLOCKING_MODE_NOT_SUPPORTED;
-  if (flags & TAPASCO_DEVICE_COPY_PE_LOCAL) {
+  if (flags &
+      (TAPASCO_DEVICE_COPY_PE_LOCAL | TAPASCO_DEVICE_COPY_NONBLOCKING)) {
     va_list ap;
     va_start(ap, flags);
-    tapasco_slot_id_t slot_id = va_arg(ap, tapasco_slot_id_t);
+    if (flags & TAPASCO_DEVICE_COPY_PE_LOCAL)
+      slot_id = va_arg(ap, tapasco_slot_id_t);
+    tapasco_copy_id_t *copy_id = flags & TAPASCO_DEVICE_COPY_NONBLOCKING
+                                     ? va_arg(ap, tapasco_copy_id_t *)
+                                     : NULL;
     va_end(ap);
+    if (flags & TAPASCO_DEVICE_COPY_NONBLOCKING)
+      return copy_id ? tapasco_copies_submit(
+                           devctx, 1, (void *)src, dst, len,
+                           flags & ~TAPASCO_DEVICE_COPY_NONBLOCKING, slot_id,
+                           copy_id)
+                     : TAPASCO_ERR_INVALID_ARG;
     return tapasco_device_copy_to_local(devctx, src, dst, len, flags, slot_id);
   }
   if (flags)
@@ -207,15 +223,25 @@ tapasco_res_t tapasco_device_copy_from(tapasco_devctx_t *devctx,
                                        tapasco_device_copy_flag_t const flags,
                                        ...) {
   platform_devctx_t *p = devctx->pdctx;
+  tapasco_slot_id_t slot_id = 0;
   LOG(LALL_MEM, "src = " PRIhandle ", len = %zd, flags = " PRIflags, src, len,
       (CSTflags)flags);
-  if (flags & TAPASCO_DEVICE_COPY_NONBLOCKING)
-    return TAPASCO_ERR_NONBLOCKING_MODE_NOT_SUPPORTED;
-  if (flags & TAPASCO_DEVICE_COPY_PE_LOCAL) {
+  if (flags &
+      (TAPASCO_DEVICE_COPY_PE_LOCAL | TAPASCO_DEVICE_COPY_NONBLOCKING)) {
     va_list ap;
     va_start(ap, flags);
-    tapasco_slot_id_t slot_id = va_arg(ap, tapasco_slot_id_t);
+    if (flags & TAPASCO_DEVICE_COPY_PE_LOCAL)
+      slot_id = va_arg(ap, tapasco_slot_id_t);
+    tapasco_copy_id_t *copy_id = flags & TAPASCO_DEVICE_COPY_NONBLOCKING
+                                     ? va_arg(ap, tapasco_copy_id_t *)
+                                     : NULL;
     va_end(ap);
+    if (flags & TAPASCO_DEVICE_COPY_NONBLOCKING)
+      return copy_id ? tapasco_copies_submit(
+                           devctx, 0, dst, src, len,
+                           flags & ~TAPASCO_DEVICE_COPY_NONBLOCKING, slot_id,
+                           copy_id)
+                     : TAPASCO_ERR_INVALID_ARG;
     return tapasco_device_copy_from_local(devctx, src, dst, len, flags,
                                           slot_id);
   }
@@ -21,84 +21,325 @@
  *  @author J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 #include <assert.h>
-#include <gen_stack.h>
-#include <khash.h>
+#include <errno.h>
+#include <gen_queue.h>
 #include <platform.h>
-#include <semaphore.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <tapasco_cq.h>
 #include <tapasco_delayed_transfers.h>
 #include <tapasco_device.h>
 #include <tapasco_errors.h>
+#include <tapasco_fallback.h>
 #include <tapasco_global.h>
 #include <tapasco_jobs.h>
+#include <tapasco_local_mem.h>
 #include <tapasco_logging.h>
 #include <tapasco_pemgmt.h>
 #include <tapasco_perfc.h>
 #include <tapasco_regs.h>
+#include <tapasco_scheduler.h>
+#include <time.h>
 
-typedef size_t midx_t;
+/** Number of words in the bitmap of available PEs of a kernel. */
+#define FREE_WORDS ((TAPASCO_NUM_SLOTS + 63) / 64)
 
-/* Group of PEs by their kernel id. */
+/* Waiting job with a deadline. */
+struct edf_entry {
+  uint64_t deadline;
+  tapasco_job_id_t j_id;
+};
+
+/* Descriptor of all PEs of a kernel, resolved once per job. */
 struct tapasco_kernel {
+  _Atomic long credits;                      // av. PEs - queued jobs
+  _Atomic uint64_t free[FREE_WORDS];         // bitmap of available PEs
+  struct gq_t *runq[TAPASCO_JOB_PRIORITIES]; // waiting jobs, per class
+  _Atomic uint32_t poll_ns;                  // completion polling budget
+  _Atomic uint32_t handovers;                // PEs handed to waiting jobs
+  _Atomic size_t num_edf;                    // waiting jobs with deadlines
+  pthread_mutex_t edf_mtx;
+  struct edf_entry *edf; // min-heap of waiting jobs by deadline
   tapasco_kernel_id_t k_id;
-  struct gs_t pe_stk; // available PEs
-  sem_t sem;          // count av. PEs
+  size_t num_pes;          // number of PEs
+  tapasco_slot_id_t *slot; // slot ids of PEs
+  tapasco_slot_id_t *mem;  // slot ids of local memories of PEs
+} __attribute__((aligned(64)));
+
+/* Buffers of a job cancelled while its PE was running. */
+struct quarantine {
+  tapasco_job_id_t j_id;
+  size_t num;
+  tapasco_transfer_t t[];
 };
 
 /* Represents a processing element on the device. */
 struct tapasco_pe {
   tapasco_kernel_id_t id;
   tapasco_slot_id_t slot_id;
+  tapasco_kernel_t *kernel;      // kernel descriptor
+  size_t idx;                    // index in kernel descriptor
+  _Atomic tapasco_job_id_t j_id; // job currently running on PE
+  uint64_t tag; // arguments of persistent job in registers (0: unknown)
+  struct quarantine *_Atomic quarantine; // buffers PE may still access
 };
 typedef struct tapasco_pe tapasco_pe_t;
 
-/** Initialize the hash map type kernel ids -> index. */
-KHASH_MAP_INIT_INT(kidmap, midx_t)
-
 /* Management entity. */
 struct tapasco_pemgmt {
   tapasco_dev_id_t dev_id;
+  tapasco_devctx_t const *devctx;
   tapasco_pe_t *pe[TAPASCO_NUM_SLOTS];
-  struct tapasco_kernel kernel[TAPASCO_NUM_SLOTS];
-  khash_t(kidmap) * kidmap;
+  size_t num_kernels;
+  tapasco_kernel_id_t k_id[TAPASCO_NUM_SLOTS]; // sorted kernel ids
+  tapasco_kernel_t *kernel;                    // kernel table, same order
+  tapasco_slot_id_t slot[TAPASCO_NUM_SLOTS];   // slots grouped by kernel
+  tapasco_slot_id_t mem[TAPASCO_NUM_SLOTS];    // local memories, same order
+  _Atomic uint64_t next_tag; // for arguments of persistent jobs
+  _Atomic int dispatch_waiters;
+  pthread_mutex_t dispatch_mtx;
+  pthread_cond_t dispatched;
 };
 
-static tapasco_pe_t *tapasco_pemgmt_create_pe(tapasco_kernel_id_t const k_id,
+static tapasco_pe_t *tapasco_pemgmt_create_pe(tapasco_kernel_t *kernel,
                                               tapasco_slot_id_t const slot_id) {
   tapasco_pe_t *f = (tapasco_pe_t *)calloc(sizeof(tapasco_pe_t), 1);
-  f->id = k_id;
+  f->id = kernel->k_id;
   f->slot_id = slot_id;
+  f->kernel = kernel;
+  f->idx = kernel->num_pes;
   return f;
 }
 
-static inline void tapasco_pemgmt_destroy_pe(tapasco_pe_t *f) { free(f); }
+static inline void tapasco_pemgmt_destroy_pe(tapasco_pe_t *f) {
+  if (f)
+    free(atomic_load(&f->quarantine)); // buffers are gone with the device
+  free(f);
+}
+
+static inline void put_free_pe(tapasco_pe_t *pe) {
+  atomic_fetch_or(&pe->kernel->free[pe->idx / 64], 1ULL << (pe->idx % 64));
+}
+
+static inline tapasco_slot_id_t take_free_pe(tapasco_kernel_t *kernel) {
+  size_t const words = (kernel->num_pes + 63) / 64;
+  // releasing thread may not have marked the PE as available yet: yield to
+  // it, it may be waiting for this CPU
+  while (1) {
+    for (size_t w = 0; w < words; ++w) {
+      uint64_t f = atomic_load(&kernel->free[w]);
+      while (f) {
+        uint64_t const b = f & -f;
+        uint64_t const old = atomic_fetch_and(&kernel->free[w], ~b);
+        if (old & b)
+          return kernel->slot[w * 64 + __builtin_ctzll(b)];
+        f = old & ~b;
+      }
+    }
+    sched_yield();
+  }
+}
+
+/* Claims the available PE attached to local memory in slot near, if any. */
+static inline tapasco_slot_id_t take_near_pe(tapasco_kernel_t *kernel,
+                                             tapasco_slot_id_t const near) {
+  for (size_t i = 0; i < kernel->num_pes; ++i) {
+    uint64_t const b = 1ULL << (i % 64);
+    if (kernel->mem[i] == near &&
+        (atomic_fetch_and(&kernel->free[i / 64], ~b) & b))
+      return kernel->slot[i];
+  }
+  return take_free_pe(kernel);
+}
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
-static void setup_pes_from_status(platform_devctx_t *ctx, tapasco_pemgmt_t *p) {
-  midx_t kbucket = 0, bucket_idx;
-  int ret;
-  khiter_t k;
+static void edf_push(tapasco_kernel_t *kernel, uint64_t const deadline,
+                     tapasco_job_id_t const j_id) {
+  pthread_mutex_lock(&kernel->edf_mtx);
+  struct edf_entry *h = kernel->edf;
+  size_t const n = atomic_load(&kernel->num_edf);
+  size_t i = n;
+  assert(n < TAPASCO_JOBS_Q_SZ);
+  while (i > 0 && h[(i - 1) / 2].deadline > deadline) {
+    h[i] = h[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  h[i].deadline = deadline;
+  h[i].j_id = j_id;
+  atomic_store(&kernel->num_edf, n + 1);
+  pthread_mutex_unlock(&kernel->edf_mtx);
+}
+
+static tapasco_job_id_t edf_pop(tapasco_kernel_t *kernel) {
+  tapasco_job_id_t j_id = 0;
+  if (!atomic_load(&kernel->num_edf))
+    return 0;
+  pthread_mutex_lock(&kernel->edf_mtx);
+  size_t n = atomic_load(&kernel->num_edf);
+  if (n) {
+    struct edf_entry *h = kernel->edf;
+    struct edf_entry const last = h[--n];
+    size_t i = 0, c;
+    j_id = h[0].j_id;
+    while ((c = 2 * i + 1) < n) {
+      if (c + 1 < n && h[c + 1].deadline < h[c].deadline)
+        ++c;
+      if (last.deadline <= h[c].deadline)
+        break;
+      h[i] = h[c];
+      i = c;
+    }
+    h[i] = last;
+    atomic_store(&kernel->num_edf, n);
+  }
+  pthread_mutex_unlock(&kernel->edf_mtx);
+  return j_id;
+}
+
+/* Takes the next waiting job: earliest deadline first, then by priority
+ * class; every TAPASCO_PEMGMT_AGING-th handover serves the classes in reverse
+ * order, so that low priority jobs cannot starve. */
+static tapasco_job_id_t take_queued(tapasco_kernel_t *kernel) {
+  int const aging = atomic_fetch_add(&kernel->handovers, 1) %
+                        TAPASCO_PEMGMT_AGING ==
+                    TAPASCO_PEMGMT_AGING - 1;
+  tapasco_job_id_t j_id;
+  // launching thread may not have enqueued the job yet: yield to it, it may
+  // be waiting for this CPU
+  while (1) {
+    if (!aging && (j_id = edf_pop(kernel)))
+      return j_id;
+    for (int i = 0; i < TAPASCO_JOB_PRIORITIES; ++i) {
+      void *e = gq_dequeue(
+          kernel->runq[aging ? TAPASCO_JOB_PRIORITIES - 1 - i : i]);
+      if (e)
+        return (tapasco_job_id_t)(uintptr_t)e;
+    }
+    if (aging && (j_id = edf_pop(kernel)))
+      return j_id;
+    sched_yield();
+  }
+}
+
+/* Queues a job for the next available PE of the kernel. */
+static void queue_job(tapasco_pemgmt_t *ctx, tapasco_kernel_t *kernel,
+                      tapasco_job_id_t const j_id) {
+  tapasco_jobs_t *jobs = ctx->devctx->jobs;
+  uint64_t const deadline = tapasco_jobs_get_deadline(jobs, j_id);
+  tapasco_job_priority_t const prio = tapasco_jobs_get_priority(jobs, j_id);
+  tapasco_jobs_set_queued(jobs, j_id, now_ns());
+  if (deadline)
+    edf_push(kernel, deadline, j_id);
+  else
+    gq_enqueue(kernel->runq[prio], (void *)(uintptr_t)j_id);
+  tapasco_perfc_jobs_queued_inc(ctx->dev_id);
+  switch (prio) {
+  case TAPASCO_JOB_PRIORITY_HIGH:
+    tapasco_perfc_queued_high_inc(ctx->dev_id);
+    break;
+  case TAPASCO_JOB_PRIORITY_NORMAL:
+    tapasco_perfc_queued_normal_inc(ctx->dev_id);
+    break;
+  default:
+    tapasco_perfc_queued_low_inc(ctx->dev_id);
+  }
+}
+
+/* Accounts the queueing delay of a job handed a PE by its priority class. */
+static void account_handover(tapasco_pemgmt_t *ctx,
+                             tapasco_job_id_t const j_id) {
+  tapasco_jobs_t *jobs = ctx->devctx->jobs;
+  uint64_t const now = now_ns();
+  uint64_t const deadline = tapasco_jobs_get_deadline(jobs, j_id);
+  int const us = (int)((now - tapasco_jobs_get_queued(jobs, j_id)) / 1000);
+  switch (tapasco_jobs_get_priority(jobs, j_id)) {
+  case TAPASCO_JOB_PRIORITY_HIGH:
+    tapasco_perfc_queue_us_high_add(ctx->dev_id, us);
+    break;
+  case TAPASCO_JOB_PRIORITY_NORMAL:
+    tapasco_perfc_queue_us_normal_add(ctx->dev_id, us);
+    break;
+  default:
+    tapasco_perfc_queue_us_low_add(ctx->dev_id, us);
+  }
+  if (deadline && now > deadline) {
+    DEVLOG(ctx->dev_id, LALL_PEMGMT,
+           "job " PRIjob ": missed deadline by %llu ns", j_id,
+           (unsigned long long)(now - deadline));
+    tapasco_perfc_deadline_misses_inc(ctx->dev_id);
+  }
+}
+
+static tapasco_res_t setup_pes_from_status(platform_devctx_t *ctx,
+                                           tapasco_pemgmt_t *p) {
+  // collect sorted kernel ids
   for (tapasco_slot_id_t slot = 0; slot < TAPASCO_NUM_SLOTS; ++slot) {
     platform_kernel_id_t const k_id = ctx->info.composition.kernel[slot];
-    p->pe[slot] = k_id ? tapasco_pemgmt_create_pe(k_id, slot) : NULL;
-    if (p->pe[slot]) {
-      k = kh_get(kidmap, p->kidmap, k_id);
-      if (k == kh_end(p->kidmap)) {
-        k = kh_put(kidmap, p->kidmap, k_id, &ret);
-        kh_val(p->kidmap, k) = kbucket;
-        sem_init(&p->kernel[kbucket].sem, 0, 0);
-        kbucket++;
-      }
-      bucket_idx = kh_val(p->kidmap, k);
-      DEVLOG(ctx->dev_id, LALL_PEMGMT, "k_id " PRIkernel " -> kind #%u", k_id,
-             bucket_idx);
-      gs_push(&p->kernel[bucket_idx].pe_stk, p->pe[slot]);
-      sem_post(&p->kernel[bucket_idx].sem);
+    size_t i = 0;
+    if (!k_id)
+      continue;
+    while (i < p->num_kernels && p->k_id[i] < k_id)
+      ++i;
+    if (i < p->num_kernels && p->k_id[i] == k_id)
+      continue;
+    memmove(&p->k_id[i + 1], &p->k_id[i],
+            (p->num_kernels - i) * sizeof(*p->k_id));
+    p->k_id[i] = k_id;
+    ++p->num_kernels;
+  }
+
+  p->kernel = (tapasco_kernel_t *)aligned_alloc(
+      64, (p->num_kernels ? p->num_kernels : 1) * sizeof(*p->kernel));
+  if (!p->kernel)
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  memset(p->kernel, 0, p->num_kernels * sizeof(*p->kernel));
+  int edf_ok = 1;
+  for (size_t k = 0; k < p->num_kernels; ++k) {
+    tapasco_kernel_t *kernel = &p->kernel[k];
+    for (int c = 0; c < TAPASCO_JOB_PRIORITIES; ++c)
+      kernel->runq[c] = gq_init();
+    pthread_mutex_init(&kernel->edf_mtx, NULL);
+    kernel->edf =
+        (struct edf_entry *)malloc(TAPASCO_JOBS_Q_SZ * sizeof(*kernel->edf));
+    edf_ok = edf_ok && kernel->edf;
+  }
+  if (!edf_ok)
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+
+  size_t num_pes = 0;
+  for (size_t k = 0; k < p->num_kernels; ++k) {
+    tapasco_kernel_t *kernel = &p->kernel[k];
+    kernel->k_id = p->k_id[k];
+    kernel->slot = &p->slot[num_pes];
+    kernel->mem = &p->mem[num_pes];
+    for (tapasco_slot_id_t slot = 0; slot < TAPASCO_NUM_SLOTS; ++slot) {
+      if (ctx->info.composition.kernel[slot] != kernel->k_id)
+        continue;
+      p->pe[slot] = tapasco_pemgmt_create_pe(kernel, slot);
+      kernel->slot[kernel->num_pes] = slot;
+      kernel->mem[kernel->num_pes] =
+          tapasco_local_mem_of_pe(p->devctx, slot);
+      put_free_pe(p->pe[slot]);
+      ++kernel->num_pes;
     }
+    atomic_store(&kernel->credits, kernel->num_pes);
+    num_pes += kernel->num_pes;
+    DEVLOG(ctx->dev_id, LALL_PEMGMT, "k_id " PRIkernel " -> kind #%zu, %zu PEs",
+           kernel->k_id, k, kernel->num_pes);
   }
-  DEVLOG(ctx->dev_id, LALL_PEMGMT, "initialized %d kind%s of PEs", kbucket,
-         kbucket > 1 ? "s" : "");
+  DEVLOG(ctx->dev_id, LALL_PEMGMT, "initialized %zu kind%s of PEs",
+         p->num_kernels, p->num_kernels > 1 ? "s" : "");
+  return TAPASCO_SUCCESS;
 }
 
 tapasco_res_t tapasco_pemgmt_init(const tapasco_devctx_t *devctx,
@@ -109,22 +350,37 @@ tapasco_res_t tapasco_pemgmt_init(const tapasco_devctx_t *devctx,
   if (!pemgmt)
     return TAPASCO_ERR_OUT_OF_MEMORY;
   (*pemgmt)->dev_id = devctx->id;
-  (*pemgmt)->kidmap = kh_init(kidmap);
-  setup_pes_from_status(devctx->pdctx, *pemgmt);
+  (*pemgmt)->devctx = devctx;
+  pthread_mutex_init(&(*pemgmt)->dispatch_mtx, NULL);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&(*pemgmt)->dispatched, &attr);
+  pthread_condattr_destroy(&attr);
+  if ((res = setup_pes_from_status(devctx->pdctx, *pemgmt)) !=
+      TAPASCO_SUCCESS) {
+    tapasco_pemgmt_deinit(*pemgmt);
+    *pemgmt = NULL;
+  }
   return res;
 }
 
 void tapasco_pemgmt_deinit(tapasco_pemgmt_t *pemgmt) {
-  for (khiter_t k = kh_begin(pemgmt->kidmap); k != kh_end(pemgmt->kidmap);
-       ++k) {
-    if (kh_exist(pemgmt->kidmap, k)) {
-      midx_t bucket_idx = kh_val(pemgmt->kidmap, k);
-      sem_close(&pemgmt->kernel[bucket_idx].sem);
-      while (gs_pop(&pemgmt->kernel[bucket_idx].pe_stk))
-        ;
+  if (pemgmt->kernel) {
+    for (size_t k = 0; k < pemgmt->num_kernels; ++k) {
+      tapasco_kernel_t *kernel = &pemgmt->kernel[k];
+      for (int c = 0; c < TAPASCO_JOB_PRIORITIES; ++c) {
+        while (gq_dequeue(kernel->runq[c]))
+          ;
+        gq_destroy(kernel->runq[c]);
+      }
+      pthread_mutex_destroy(&kernel->edf_mtx);
+      free(kernel->edf);
     }
+    free(pemgmt->kernel);
   }
-  kh_destroy(kidmap, pemgmt->kidmap);
+  pthread_cond_destroy(&pemgmt->dispatched);
+  pthread_mutex_destroy(&pemgmt->dispatch_mtx);
   for (int i = 0; i < TAPASCO_NUM_SLOTS; ++i)
     tapasco_pemgmt_destroy_pe(pemgmt->pe[i]);
   free(pemgmt);
@@ -165,40 +421,407 @@ void tapasco_pemgmt_setup_system(tapasco_devctx_t *devctx,
   }
 }
 
+tapasco_kernel_t *tapasco_pemgmt_kernel(tapasco_pemgmt_t const *ctx,
+                                        tapasco_kernel_id_t const k_id) {
+  size_t l = 0, r = ctx->num_kernels;
+  while (l < r) {
+    size_t const m = (l + r) / 2;
+    if (ctx->k_id[m] < k_id)
+      l = m + 1;
+    else
+      r = m;
+  }
+  return l < ctx->num_kernels && ctx->k_id[l] == k_id ? &ctx->kernel[l]
+                                                      : NULL;
+}
+
+/* Processes with shared access obtain PEs from the device driver. */
+static inline int shared(tapasco_devctx_t const *devctx) {
+  return devctx->pdctx->mode == PLATFORM_SHARED_ACCESS;
+}
+
+/* Blocks until the driver grants a PE of the kernel to this process. */
+static tapasco_slot_id_t acquire_shared(tapasco_pemgmt_t *ctx,
+                                        tapasco_kernel_t *kernel) {
+  tapasco_slot_id_t slot_id;
+  platform_res_t const r =
+      platform_acquire_pe(ctx->devctx->pdctx, kernel->k_id, &slot_id);
+  if (r != PLATFORM_SUCCESS) {
+    DEVERR(ctx->dev_id, "k_id = " PRIkernel ": could not acquire PE: %s",
+           kernel->k_id, platform_strerror(r));
+    return TAPASCO_NUM_SLOTS;
+  }
+  if (slot_id >= TAPASCO_NUM_SLOTS || !ctx->pe[slot_id] ||
+      ctx->pe[slot_id]->kernel != kernel) {
+    DEVERR(ctx->dev_id, "k_id = " PRIkernel ": driver granted slot " PRIslot,
+           kernel->k_id, slot_id);
+    if (slot_id < TAPASCO_NUM_SLOTS)
+      platform_release_pe(ctx->devctx->pdctx, slot_id);
+    return TAPASCO_NUM_SLOTS;
+  }
+  DEVLOG(ctx->dev_id, LALL_PEMGMT, "k_id = " PRIkernel ", slot_id = " PRIslot,
+         kernel->k_id, slot_id);
+  // other processes may have changed the registers since it was released
+  ctx->pe[slot_id]->tag = 0;
+  tapasco_perfc_pe_acquired_inc(ctx->dev_id);
+  return slot_id;
+}
+
 tapasco_slot_id_t tapasco_pemgmt_acquire_pe(tapasco_pemgmt_t *ctx,
-                                            tapasco_kernel_id_t const k_id) {
-  const khiter_t k = kh_get(kidmap, ctx->kidmap, k_id);
-  assert(k != kh_end(ctx->kidmap));
-  const midx_t bucket_idx = kh_val(ctx->kidmap, k);
-  while (sem_wait(&ctx->kernel[bucket_idx].sem))
-    ;
-  tapasco_pe_t *pe = (tapasco_pe_t *)gs_pop(&ctx->kernel[bucket_idx].pe_stk);
+                                            tapasco_kernel_t *kernel,
+                                            tapasco_job_id_t const j_id,
+                                            tapasco_slot_id_t const near) {
+  assert(kernel);
+  if (shared(ctx->devctx))
+    return acquire_shared(ctx, kernel);
+  if (atomic_fetch_sub(&kernel->credits, 1) <= 0) {
+    // no PE available: PE will be handed over by tapasco_pemgmt_hand_over
+    DEVLOG(ctx->dev_id, LALL_PEMGMT,
+           "k_id = " PRIkernel ": no PE available, queueing job " PRIjob,
+           kernel->k_id, j_id);
+    queue_job(ctx, kernel, j_id);
+    return TAPASCO_PEMGMT_JOB_QUEUED;
+  }
+  tapasco_slot_id_t const slot_id = near < TAPASCO_NUM_SLOTS
+                                        ? take_near_pe(kernel, near)
+                                        : take_free_pe(kernel);
   DEVLOG(ctx->dev_id, LALL_PEMGMT, "k_id = " PRIkernel ", slot_id = " PRIslot,
-         k_id, pe->slot_id);
+         kernel->k_id, slot_id);
   tapasco_perfc_pe_acquired_inc(ctx->dev_id);
-  return pe->slot_id;
+  return slot_id;
 }
 
-void tapasco_pemgmt_release_pe(tapasco_pemgmt_t *ctx,
+void tapasco_pemgmt_release_pe(tapasco_devctx_t *devctx,
                                tapasco_slot_id_t const s_id) {
+  tapasco_pemgmt_t *ctx = devctx->pemgmt;
   assert(s_id >= 0 && s_id < TAPASCO_NUM_SLOTS);
   assert(ctx->pe[s_id]);
-  const khiter_t k = kh_get(kidmap, ctx->kidmap, ctx->pe[s_id]->id);
-  assert(k != kh_end(ctx->kidmap));
-  const midx_t bucket_idx = kh_val(ctx->kidmap, k);
+  tapasco_kernel_t *kernel = ctx->pe[s_id]->kernel;
   DEVLOG(ctx->dev_id, LALL_PEMGMT, "slot_id = " PRIslot, s_id);
   tapasco_perfc_pe_released_inc(ctx->dev_id);
-  gs_push(&ctx->kernel[bucket_idx].pe_stk, ctx->pe[s_id]);
-  while (sem_post(&ctx->kernel[bucket_idx].sem))
+  if (shared(devctx)) {
+    // registers are not ours any more once the driver passes the PE on
+    ctx->pe[s_id]->tag = 0;
+    platform_release_pe(devctx->pdctx, s_id);
+    return;
+  }
+  // a job is waiting for this kernel: the stager hands the PE over, while
+  // this thread goes on with the job it released the PE for
+  if (atomic_fetch_add(&kernel->credits, 1) < 0) {
+    tapasco_scheduler_post_handover(devctx, s_id);
+    return;
+  }
+  put_free_pe(ctx->pe[s_id]);
+}
+
+void tapasco_pemgmt_hand_over(tapasco_devctx_t *devctx,
+                              tapasco_slot_id_t const s_id) {
+  tapasco_pemgmt_t *ctx = devctx->pemgmt;
+  assert(s_id >= 0 && s_id < TAPASCO_NUM_SLOTS);
+  assert(ctx->pe[s_id]);
+  tapasco_kernel_t *kernel = ctx->pe[s_id]->kernel;
+  do {
+    tapasco_job_id_t const j_id = take_queued(kernel);
+    account_handover(ctx, j_id);
+    DEVLOG(ctx->dev_id, LALL_PEMGMT,
+           "dispatching queued job " PRIjob " to slot_id = " PRIslot, j_id,
+           s_id);
+    tapasco_perfc_pe_acquired_inc(ctx->dev_id);
+    tapasco_res_t const r = tapasco_pemgmt_dispatch(devctx, j_id, s_id);
+    if (r == TAPASCO_SUCCESS)
+      return;
+    // job failed, report it and try next waiting job; cancelled jobs are
+    // gone already
+    tapasco_cq_t *cq = r != TAPASCO_ERR_JOB_ABORTED
+                           ? tapasco_jobs_get_cq(devctx->jobs, j_id)
+                           : NULL;
+    if (cq)
+      tapasco_cq_post(cq, j_id);
+    tapasco_perfc_pe_released_inc(ctx->dev_id);
+  } while (atomic_fetch_add(&kernel->credits, 1) < 0);
+  put_free_pe(ctx->pe[s_id]);
+}
+
+static inline void notify_dispatched(tapasco_pemgmt_t *ctx) {
+  atomic_thread_fence(memory_order_seq_cst);
+  if (atomic_load(&ctx->dispatch_waiters)) {
+    pthread_mutex_lock(&ctx->dispatch_mtx);
+    pthread_cond_broadcast(&ctx->dispatched);
+    pthread_mutex_unlock(&ctx->dispatch_mtx);
+  }
+}
+
+void tapasco_pemgmt_fail_job(tapasco_devctx_t *devctx,
+                             tapasco_job_id_t const j_id) {
+  tapasco_job_state_t st;
+  // cancelled jobs stay aborted
+  do {
+    if ((st = tapasco_jobs_get_state(devctx->jobs, j_id)) ==
+        TAPASCO_JOB_STATE_ABORTED)
+      return;
+  } while (!tapasco_jobs_cas_state(devctx->jobs, j_id, st,
+                                   TAPASCO_JOB_STATE_FAILED));
+  notify_dispatched(devctx->pemgmt);
+  if (tapasco_jobs_num_successors(devctx->jobs, j_id))
+    tapasco_scheduler_post_completed(devctx, j_id);
+}
+
+int tapasco_pemgmt_finish_job(tapasco_devctx_t *devctx,
+                              tapasco_job_id_t const j_id) {
+  if (!tapasco_jobs_cas_state(devctx->jobs, j_id, TAPASCO_JOB_STATE_RUNNING,
+                              TAPASCO_JOB_STATE_FINISHED))
+    return 0;
+  notify_dispatched(devctx->pemgmt);
+  return 1;
+}
+
+/* Frees the buffers of a job which will not finish. */
+static void discard_transfers(tapasco_devctx_t *devctx,
+                              tapasco_job_id_t const j_id,
+                              tapasco_slot_id_t const slot_id) {
+  size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (t && t->len > 0)
+      tapasco_transfer_discard(devctx, j_id, t, slot_id);
+  }
+}
+
+/* Moves the buffers of a cancelled job to its PE, which may still access
+ * them: they are freed by @see tapasco_pemgmt_free_quarantined. */
+static void quarantine_transfers(tapasco_devctx_t *devctx,
+                                 tapasco_job_id_t const j_id,
+                                 tapasco_slot_id_t const slot_id) {
+  size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  struct quarantine *q = (struct quarantine *)malloc(
+      sizeof(*q) + num_args * sizeof(tapasco_transfer_t));
+  if (!q) {
+    DEVERR(devctx->id, "job " PRIjob ": could not quarantine buffers", j_id);
+    return; // leaking them is safer than handing them out again
+  }
+  q->j_id = j_id;
+  q->num = 0;
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (!t || t->len == 0)
+      continue;
+    q->t[q->num++] = *t;
+    // job id is released without freeing them
+    t->kept = 0;
+    t->shared = NULL;
+  }
+  atomic_store(&devctx->pemgmt->pe[slot_id]->quarantine, q);
+}
+
+void tapasco_pemgmt_free_quarantined(tapasco_devctx_t *devctx,
+                                     tapasco_slot_id_t const s_id) {
+  assert(s_id >= 0 && s_id < TAPASCO_NUM_SLOTS);
+  tapasco_pe_t *pe = devctx->pemgmt->pe[s_id];
+  struct quarantine *q = pe ? atomic_exchange(&pe->quarantine, NULL) : NULL;
+  if (!q)
+    return;
+  DEVLOG(devctx->id, LALL_PEMGMT,
+         "job " PRIjob ": freeing %zu quarantined buffers of slot #" PRIslot,
+         q->j_id, q->num, s_id);
+  for (size_t i = 0; i < q->num; ++i)
+    tapasco_transfer_discard(devctx, q->j_id, &q->t[i], s_id);
+  free(q);
+}
+
+/* Drops a job which was cancelled before its PE was started: its buffers are
+ * freed, and the dispatching thread releases its reference to the job. */
+static tapasco_res_t drop_aborted(tapasco_devctx_t *devctx,
+                                  tapasco_job_id_t const j_id,
+                                  tapasco_slot_id_t const slot_id) {
+  DEVLOG(devctx->id, LALL_PEMGMT, "job " PRIjob ": cancelled before start",
+         j_id);
+  discard_transfers(devctx, j_id, slot_id);
+  tapasco_jobs_release(devctx->jobs, j_id);
+  return TAPASCO_ERR_JOB_ABORTED;
+}
+
+tapasco_res_t tapasco_pemgmt_dispatch(tapasco_devctx_t *devctx,
+                                      tapasco_job_id_t const j_id,
+                                      tapasco_slot_id_t const slot_id) {
+  tapasco_res_t r;
+  DEVLOG(devctx->id, LALL_PEMGMT,
+         "job " PRIjob ": preparing slot #" PRIslot " ...", j_id, slot_id);
+  tapasco_jobs_set_slot(devctx->jobs, j_id, slot_id);
+  tapasco_scheduler_job_dispatched(devctx, j_id);
+  if ((r = tapasco_pemgmt_prepare_pe(devctx, j_id, slot_id)) !=
+      TAPASCO_SUCCESS) {
+    DEVERR(devctx->id,
+           "could not prepare slot #" PRIslot " for job #" PRIjob
+           ": %s (" PRIres ")",
+           slot_id, j_id, tapasco_strerror(r), r);
+    tapasco_pemgmt_fail_job(devctx, j_id);
+    if (tapasco_jobs_get_state(devctx->jobs, j_id) ==
+        TAPASCO_JOB_STATE_ABORTED) {
+      tapasco_jobs_release(devctx->jobs, j_id);
+      return TAPASCO_ERR_JOB_ABORTED;
+    }
+    return r;
+  }
+
+  DEVLOG(devctx->id, LALL_PEMGMT,
+         "job " PRIjob ": starting PE in slot #" PRIslot " ...", j_id, slot_id);
+  // job may have been cancelled while it was waiting
+  tapasco_pemgmt_set_job(devctx->pemgmt, slot_id, j_id);
+  if (!tapasco_jobs_cas_state(devctx->jobs, j_id, TAPASCO_JOB_STATE_SCHEDULED,
+                              TAPASCO_JOB_STATE_RUNNING)) {
+    tapasco_pemgmt_set_job(devctx->pemgmt, slot_id, 0);
+    return drop_aborted(devctx, j_id, slot_id);
+  }
+  tapasco_fallback_pe_started(
+      devctx, tapasco_jobs_get_kernel_id(devctx->jobs, j_id), slot_id);
+  if ((r = tapasco_pemgmt_start_pe(devctx, slot_id)) != TAPASCO_SUCCESS) {
+    DEVERR(devctx->id,
+           "could not start PE in slot #" PRIslot ": %s (" PRIres ")", slot_id,
+           tapasco_strerror(r), r);
+    // cancelled meanwhile: the job and its PE belong to the canceller
+    if (!tapasco_pemgmt_claim_job(devctx->pemgmt, slot_id, j_id))
+      return TAPASCO_SUCCESS;
+    tapasco_pemgmt_fail_job(devctx, j_id);
+    return r;
+  }
+  notify_dispatched(devctx->pemgmt);
+  return r;
+}
+
+/* Waits for the next dispatch or completion; returns 0 on timeout. */
+static inline int wait_dispatch(tapasco_pemgmt_t *ctx,
+                                struct timespec const *deadline) {
+  if (!deadline)
+    return !pthread_cond_wait(&ctx->dispatched, &ctx->dispatch_mtx);
+  return pthread_cond_timedwait(&ctx->dispatched, &ctx->dispatch_mtx,
+                                deadline) != ETIMEDOUT;
+}
+
+tapasco_job_state_t
+tapasco_pemgmt_wait_dispatched(tapasco_devctx_t *devctx,
+                               tapasco_job_id_t const j_id,
+                               struct timespec const *deadline) {
+  tapasco_pemgmt_t *ctx = devctx->pemgmt;
+  tapasco_job_state_t st = tapasco_jobs_get_state(devctx->jobs, j_id);
+  if (st != TAPASCO_JOB_STATE_SCHEDULED)
+    return st;
+  atomic_fetch_add(&ctx->dispatch_waiters, 1);
+  pthread_mutex_lock(&ctx->dispatch_mtx);
+  atomic_thread_fence(memory_order_seq_cst);
+  while ((st = tapasco_jobs_get_state(devctx->jobs, j_id)) ==
+             TAPASCO_JOB_STATE_SCHEDULED &&
+         wait_dispatch(ctx, deadline))
     ;
+  pthread_mutex_unlock(&ctx->dispatch_mtx);
+  atomic_fetch_sub(&ctx->dispatch_waiters, 1);
+  return st;
+}
+
+tapasco_job_state_t
+tapasco_pemgmt_wait_finished(tapasco_devctx_t *devctx,
+                             tapasco_job_id_t const j_id,
+                             struct timespec const *deadline) {
+  tapasco_pemgmt_t *ctx = devctx->pemgmt;
+  tapasco_job_state_t st;
+  atomic_fetch_add(&ctx->dispatch_waiters, 1);
+  pthread_mutex_lock(&ctx->dispatch_mtx);
+  atomic_thread_fence(memory_order_seq_cst);
+  while ((st = tapasco_jobs_get_state(devctx->jobs, j_id)) !=
+             TAPASCO_JOB_STATE_FINISHED &&
+         st != TAPASCO_JOB_STATE_FAILED && st != TAPASCO_JOB_STATE_ABORTED &&
+         wait_dispatch(ctx, deadline))
+    ;
+  pthread_mutex_unlock(&ctx->dispatch_mtx);
+  atomic_fetch_sub(&ctx->dispatch_waiters, 1);
+  return st;
+}
+
+void tapasco_pemgmt_signal_job(tapasco_devctx_t *devctx,
+                               tapasco_job_id_t const j_id) {
+  tapasco_jobs_set_signaled(devctx->jobs, j_id);
+  notify_dispatched(devctx->pemgmt);
+}
+
+int tapasco_pemgmt_job_ready(tapasco_devctx_t *devctx,
+                             tapasco_job_id_t const j_id) {
+  switch (tapasco_jobs_get_state(devctx->jobs, j_id)) {
+  case TAPASCO_JOB_STATE_FINISHED:
+  case TAPASCO_JOB_STATE_FAILED:
+  case TAPASCO_JOB_STATE_ABORTED:
+    return 1;
+  case TAPASCO_JOB_STATE_RUNNING: // jobs on PEs finish by their signal
+    return tapasco_jobs_get_signaled(devctx->jobs, j_id);
+  default:
+    return 0;
+  }
+}
+
+/* Copies the ready jobs of j_ids to ready, returns their number. */
+static size_t ready_jobs(tapasco_devctx_t *devctx, size_t const num_jobs,
+                         tapasco_job_id_t const *j_ids,
+                         tapasco_job_id_t *ready) {
+  size_t n = 0;
+  for (size_t i = 0; i < num_jobs; ++i)
+    if (tapasco_pemgmt_job_ready(devctx, j_ids[i]))
+      ready[n++] = j_ids[i];
+  return n;
+}
+
+size_t tapasco_pemgmt_wait_ready(tapasco_devctx_t *devctx,
+                                 size_t const num_jobs,
+                                 tapasco_job_id_t const *j_ids,
+                                 size_t const min_ready,
+                                 tapasco_job_id_t *ready,
+                                 struct timespec const *deadline) {
+  tapasco_pemgmt_t *ctx = devctx->pemgmt;
+  int timed_out = 0;
+  size_t n = ready_jobs(devctx, num_jobs, j_ids, ready);
+  if (n >= min_ready)
+    return n;
+  atomic_fetch_add(&ctx->dispatch_waiters, 1);
+  pthread_mutex_lock(&ctx->dispatch_mtx);
+  atomic_thread_fence(memory_order_seq_cst);
+  while ((n = ready_jobs(devctx, num_jobs, j_ids, ready)) < min_ready &&
+         !timed_out)
+    timed_out = !wait_dispatch(ctx, deadline);
+  pthread_mutex_unlock(&ctx->dispatch_mtx);
+  atomic_fetch_sub(&ctx->dispatch_waiters, 1);
+  return n;
+}
+
+void tapasco_pemgmt_set_job(tapasco_pemgmt_t *ctx,
+                            tapasco_slot_id_t const s_id,
+                            tapasco_job_id_t const j_id) {
+  assert(s_id >= 0 && s_id < TAPASCO_NUM_SLOTS);
+  assert(ctx->pe[s_id]);
+  atomic_store(&ctx->pe[s_id]->j_id, j_id);
+}
+
+int tapasco_pemgmt_claim_job(tapasco_pemgmt_t *ctx,
+                             tapasco_slot_id_t const s_id,
+                             tapasco_job_id_t const j_id) {
+  assert(s_id >= 0 && s_id < TAPASCO_NUM_SLOTS);
+  assert(ctx->pe[s_id]);
+  tapasco_job_id_t expected = j_id;
+  return atomic_compare_exchange_strong(&ctx->pe[s_id]->j_id, &expected, 0);
+}
+
+tapasco_job_id_t tapasco_pemgmt_get_job(tapasco_pemgmt_t *ctx,
+                                        tapasco_slot_id_t const s_id) {
+  assert(s_id >= 0 && s_id < TAPASCO_NUM_SLOTS);
+  return ctx->pe[s_id] ? atomic_load(&ctx->pe[s_id]->j_id) : 0;
 }
 
 size_t tapasco_pemgmt_count(tapasco_pemgmt_t const *ctx,
                             tapasco_kernel_id_t const k_id) {
-  size_t ret = 0;
-  for (tapasco_slot_id_t i = 0; i < TAPASCO_NUM_SLOTS; ++i)
-    ret += ctx->pe[i] ? ctx->pe[i]->id == k_id : 0;
-  return ret;
+  tapasco_kernel_t const *kernel = tapasco_pemgmt_kernel(ctx, k_id);
+  return kernel ? kernel->num_pes : 0;
+}
+
+long tapasco_pemgmt_credits(tapasco_kernel_t *kernel) {
+  return atomic_load(&kernel->credits);
 }
 
 size_t tapasco_device_kernel_pe_count(tapasco_devctx_t *devctx,
@@ -206,18 +829,125 @@ size_t tapasco_device_kernel_pe_count(tapasco_devctx_t *devctx,
   return tapasco_pemgmt_count(devctx->pemgmt, k_id);
 }
 
+uint32_t tapasco_pemgmt_get_poll_budget(tapasco_pemgmt_t const *ctx,
+                                        tapasco_slot_id_t const s_id) {
+  assert(ctx->pe[s_id]);
+  return atomic_load(&ctx->pe[s_id]->kernel->poll_ns);
+}
+
+tapasco_res_t
+tapasco_device_kernel_set_poll_budget(tapasco_devctx_t *devctx,
+                                      tapasco_kernel_id_t const k_id,
+                                      uint32_t const budget_ns) {
+  tapasco_kernel_t *kernel = tapasco_pemgmt_kernel(devctx->pemgmt, k_id);
+  if (!kernel) {
+    DEVERR(devctx->id, "kernel " PRIkernel " not found", k_id);
+    return TAPASCO_ERR_KERNEL_NOT_FOUND;
+  }
+  DEVLOG(devctx->id, LALL_PEMGMT,
+         "k_id = " PRIkernel ": completion polling budget %u ns", k_id,
+         budget_ns);
+  atomic_store(&kernel->poll_ns, budget_ns);
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_device_set_share(tapasco_devctx_t *devctx,
+                                      uint32_t const weight) {
+  platform_res_t const r = platform_set_share(devctx->pdctx, weight);
+  if (r != PLATFORM_SUCCESS) {
+    DEVERR(devctx->id, "could not set share weight %u: %s (" PRIres ")",
+           weight, platform_strerror(r), r);
+    return TAPASCO_ERR_PLATFORM_FAILURE;
+  }
+  DEVLOG(devctx->id, LALL_PEMGMT, "share weight %u", weight);
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_device_get_share(tapasco_devctx_t *devctx,
+                                      uint32_t *weight, uint64_t *pe_ns) {
+  platform_res_t const r = platform_get_share(devctx->pdctx, weight, pe_ns);
+  if (r != PLATFORM_SUCCESS) {
+    DEVERR(devctx->id, "could not get share: %s (" PRIres ")",
+           platform_strerror(r), r);
+    return TAPASCO_ERR_PLATFORM_FAILURE;
+  }
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_device_job_cancel(tapasco_devctx_t *devctx,
+                                       tapasco_job_id_t const j_id) {
+  tapasco_jobs_t *jobs = devctx->jobs;
+  if (tapasco_jobs_get_cq(jobs, j_id)) {
+    DEVERR(devctx->id, "job " PRIjob " is attached to a completion queue",
+           j_id);
+    return TAPASCO_ERR_JOB_ON_CQ;
+  }
+  if (tapasco_jobs_num_successors(jobs, j_id) ||
+      tapasco_jobs_has_deps(jobs, j_id)) {
+    DEVERR(devctx->id, "job " PRIjob ": cannot cancel jobs in a job graph",
+           j_id);
+    return TAPASCO_ERR_NOT_IMPLEMENTED;
+  }
+  while (1) {
+    tapasco_slot_id_t const slot_id = tapasco_jobs_get_slot(jobs, j_id);
+    switch (tapasco_jobs_get_state(jobs, j_id)) {
+    case TAPASCO_JOB_STATE_REQUESTED:
+      DEVERR(devctx->id, "job " PRIjob " was not launched", j_id);
+      return TAPASCO_ERR_JOB_ID_NOT_FOUND;
+    case TAPASCO_JOB_STATE_SCHEDULED:
+      // still held by a queue: dropped when it is taken from there
+      if (!tapasco_jobs_abort(jobs, j_id, TAPASCO_JOB_STATE_SCHEDULED, 1))
+        continue;
+      break;
+    case TAPASCO_JOB_STATE_RUNNING:
+      if (slot_id == TAPASCO_FALLBACK_SLOT) {
+        // CPU worker cannot be interrupted, it drops the job when done
+        if (!tapasco_jobs_abort(jobs, j_id, TAPASCO_JOB_STATE_RUNNING, 1))
+          continue;
+        break;
+      }
+      // job is being completed, if its PE has been claimed already
+      if (!tapasco_pemgmt_claim_job(devctx->pemgmt, slot_id, j_id))
+        return TAPASCO_SUCCESS;
+      tapasco_jobs_set_state(jobs, j_id, TAPASCO_JOB_STATE_ABORTED);
+      // PE may still be running: keep it until the device is reset
+      DEVERR(devctx->id,
+             "job " PRIjob ": cancelled, quarantining slot #" PRIslot, j_id,
+             slot_id);
+      tapasco_perfc_pe_quarantined_inc(devctx->id);
+      quarantine_transfers(devctx, j_id, slot_id);
+      break;
+    default: // finished, failed or cancelled already
+      return TAPASCO_SUCCESS;
+    }
+    break;
+  }
+  DEVLOG(devctx->id, LALL_PEMGMT, "job " PRIjob ": cancelled", j_id);
+  tapasco_perfc_jobs_cancelled_inc(devctx->id);
+  notify_dispatched(devctx->pemgmt);
+  return TAPASCO_SUCCESS;
+}
+
 tapasco_res_t tapasco_pemgmt_prepare_pe(tapasco_devctx_t *devctx,
                                         tapasco_job_id_t const j_id,
                                         tapasco_slot_id_t const slot_id) {
   tapasco_res_t r = TAPASCO_SUCCESS;
   assert(devctx->jobs);
+  tapasco_pe_t *pe = devctx->pemgmt->pe[slot_id];
   size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  uint64_t const tag = tapasco_jobs_get_tag(devctx->jobs, j_id);
+  uint32_t const dirty = tapasco_jobs_take_dirty(devctx->jobs, j_id);
+  // persistent job relaunched on the same PE: only changed args are written
+  uint32_t const write = tag && pe->tag == tag ? dirty : ~0U;
+  if (write != ~0U)
+    tapasco_perfc_jobs_relaunched_inc(devctx->id);
+  pe->tag = 0;
   for (size_t a = 0; a < num_args; ++a) {
     tapasco_handle_t h = tapasco_regs_arg_register(devctx, slot_id, a);
     tapasco_transfer_t *t =
         tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
 
-    if (t->len > 0) {
+    if (t && t->len > 0) {
       DEVLOG(devctx->id, LALL_PEMGMT,
              "job " PRIjob ": transferring %zd byte arg #%zd", j_id, t->len, a);
       if (t->preloaded == 0) {
@@ -230,6 +960,8 @@ tapasco_res_t tapasco_pemgmt_prepare_pe(tapasco_devctx_t *devctx,
                "Using preloaded data for argument %zd at handle " PRIhandle, a,
                t->handle);
       }
+      if (!(write & (1U << a)) && t->handle == t->written)
+        continue;
       DEVLOG(devctx->id, LALL_PEMGMT,
              "job " PRIjob ": writing handle to arg #%zd (" PRIhandle ")", j_id,
              a, t->handle);
@@ -237,11 +969,17 @@ tapasco_res_t tapasco_pemgmt_prepare_pe(tapasco_devctx_t *devctx,
                              PLATFORM_CTL_FLAGS_NONE) != PLATFORM_SUCCESS) {
         return TAPASCO_ERR_PLATFORM_FAILURE;
       }
-    } else if ((r = tapasco_write_arg(devctx, devctx->jobs, j_id, h, a)) !=
-               TAPASCO_SUCCESS) {
+      t->written = t->handle;
+    } else if ((write & (1U << a)) &&
+               (r = tapasco_write_arg(devctx, devctx->jobs, j_id, h, a)) !=
+                   TAPASCO_SUCCESS) {
       return r;
     }
   }
+  if (tapasco_jobs_is_persistent(devctx->jobs, j_id)) {
+    pe->tag = atomic_fetch_add(&devctx->pemgmt->next_tag, 1) + 1;
+    tapasco_jobs_set_tag(devctx->jobs, j_id, pe->tag);
+  }
   return TAPASCO_SUCCESS;
 }
 
@@ -298,24 +1036,33 @@ tapasco_res_t tapasco_pemgmt_finish_pe(tapasco_devctx_t *devctx,
   DEVLOG(devctx->id, LALL_PEMGMT, "job #" PRIjob ": read result value 0x%08llx",
          j_id, ret);
 
-  // Read back values from all argument registers
-  for (size_t a = 0; a < num_args; ++a) {
-    tapasco_handle_t h = tapasco_regs_arg_register(devctx, slot_id, a);
-    tapasco_transfer_t *t =
-        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
-
-    if ((r = tapasco_read_arg(devctx, devctx->jobs, j_id, h, a)) !=
-        TAPASCO_SUCCESS) {
-      return r;
-    }
-    if (t->len > 0) {
-      r = tapasco_transfer_from(devctx, devctx->jobs, j_id, t, slot_id);
-      if (r != TAPASCO_SUCCESS) {
+  // Snapshot all argument registers, PE is not needed afterwards; persistent
+  // jobs keep their arguments as they were set
+  if (!tapasco_jobs_is_persistent(devctx->jobs, j_id)) {
+    for (size_t a = 0; a < num_args; ++a) {
+      tapasco_handle_t h = tapasco_regs_arg_register(devctx, slot_id, a);
+      if ((r = tapasco_read_arg(devctx, devctx->jobs, j_id, h, a)) !=
+          TAPASCO_SUCCESS) {
         return r;
       }
     }
   }
 
-  tapasco_pemgmt_release_pe(pemgmt, slot_id);
-  return TAPASCO_SUCCESS;
+  // release PE before copying outputs, so next job can start meanwhile
+  tapasco_fallback_pe_finished(
+      devctx, tapasco_jobs_get_kernel_id(devctx->jobs, j_id), slot_id);
+  tapasco_pemgmt_set_job(pemgmt, slot_id, 0);
+  tapasco_pemgmt_release_pe(devctx, slot_id);
+
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (t && t->len > 0) {
+      tapasco_res_t const tr =
+          tapasco_transfer_from(devctx, devctx->jobs, j_id, t, slot_id);
+      if (tr != TAPASCO_SUCCESS && r == TAPASCO_SUCCESS)
+        r = tr;
+    }
+  }
+  return r;
 }
@@ -60,12 +60,12 @@ TAPASCO_PERFC_COUNTERS
 #endif
 
 const char *tapasco_perfc_tostring(tapasco_dev_id_t const dev_id) {
-  static char _buf[1024];
+  static char _buf[2048];
 #define _PC(name) "%39s:\t%8ld\n"
   const char *const fmt = TAPASCO_PERFC_COUNTERS "\n%c";
 #undef _PC
 #define _PC(name) STR(name), tapasco_perfc_##name##_get(dev_id),
-  snprintf(_buf, 1024, fmt, TAPASCO_PERFC_COUNTERS 0);
+  snprintf(_buf, sizeof(_buf), fmt, TAPASCO_PERFC_COUNTERS 0);
   return _buf;
 }
 
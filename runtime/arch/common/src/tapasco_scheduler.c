@@ -21,50 +21,291 @@
  *  @author J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
  **/
 #include <assert.h>
+#include <errno.h>
+#include <gen_queue.h>
 #include <platform.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <tapasco_bufpool.h>
+#include <tapasco_cq.h>
 #include <tapasco_delayed_transfers.h>
 #include <tapasco_device.h>
+#include <tapasco_fallback.h>
+#include <tapasco_local_mem.h>
 #include <tapasco_logging.h>
 #include <tapasco_pemgmt.h>
 #include <tapasco_perfc.h>
 #include <tapasco_regs.h>
 #include <tapasco_scheduler.h>
+#include <time.h>
 #include <unistd.h>
 
-tapasco_res_t tapasco_scheduler_launch(tapasco_devctx_t *devctx,
-                                       tapasco_job_id_t const j_id) {
-  assert(devctx->jobs);
-  tapasco_kernel_id_t const k_id =
-      tapasco_jobs_get_kernel_id(devctx->jobs, j_id);
-  tapasco_slot_id_t slot_id;
-  tapasco_res_t r;
+/* Pipelined jobs of a kernel held back by the stager, while
+ * TAPASCO_SCHEDULER_STAGING_DEPTH jobs of the kernel wait for a PE. */
+struct held_jobs {
+  tapasco_kernel_t *kernel;
+  size_t n;       // number of jobs in q
+  struct gq_t *q; // in launch order
+};
 
-  DEVLOG(devctx->id, LALL_SCHEDULER, "Preloading transfers for Job %d", j_id);
+/* Scheduler state: staging thread for pipelined launches, completion thread
+ * for jobs with dependent jobs. */
+struct tapasco_scheduler {
+  tapasco_devctx_t *devctx;
+  pthread_t stager;
+  sem_t staging;           // count jobs to stage and PEs to hand over
+  struct gq_t *staging_q;  // jobs to stage, in launch order
+  struct gq_t *handover_q; // released PEs (slot + 1) with jobs waiting
+  struct held_jobs held[TAPASCO_NUM_SLOTS]; // per kernel, stager only
+  size_t num_kernels;                       // entries of held in use
+  _Atomic size_t num_held;                  // jobs held back in total
+  pthread_t completer;
+  sem_t completed;          // count jobs to complete
+  struct gq_t *completed_q; // finished jobs with successors
+  _Atomic size_t budget;    // max. bytes preloaded for waiting jobs
+  _Atomic size_t staged;    // bytes preloaded for jobs not dispatched yet
+  _Atomic int stop;
+};
+
+/* Reserves sz bytes of the staging budget; returns 0, if exhausted. */
+static int admit(tapasco_devctx_t *devctx, size_t const sz) {
+  tapasco_scheduler_t *s = devctx->scheduler;
+  size_t cur = atomic_load(&s->staged);
+  do {
+    if (cur + sz > atomic_load(&s->budget))
+      return 0;
+  } while (!atomic_compare_exchange_weak(&s->staged, &cur, cur + sz));
+  tapasco_perfc_staged_kib_set(devctx->id, (cur + sz) >> 10);
+  return 1;
+}
+
+/* Returns sz bytes to the staging budget. */
+static void unstage(tapasco_devctx_t *devctx, size_t const sz) {
+  tapasco_scheduler_t *s = devctx->scheduler;
+  size_t const cur = atomic_fetch_sub(&s->staged, sz) - sz;
+  tapasco_perfc_staged_kib_set(devctx->id, cur >> 10);
+}
+
+/* Transfers which allocate device memory when preloaded. */
+static inline int is_preloadable(tapasco_transfer_t const *t) {
+  return t && t->len && !(t->flags & TAPASCO_DEVICE_COPY_PE_LOCAL) &&
+         !(t->shared && t->shared->handle);
+}
+
+static void preload_transfers(tapasco_devctx_t *devctx,
+                              tapasco_job_id_t const j_id) {
+  tapasco_res_t r;
+  size_t sz = 0, staged = 0;
+  // pipelined jobs are scheduled (and may be cancelled) already
+  tapasco_jobs_cas_state(devctx->jobs, j_id, TAPASCO_JOB_STATE_REQUESTED,
+                         TAPASCO_JOB_STATE_SCHEDULED);
   size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
   for (size_t a = 0; a < num_args; ++a) {
     tapasco_transfer_t *t =
         tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (is_preloadable(t))
+      sz += t->len;
+  }
+  if (!sz)
+    return;
+  // buffers of deferred jobs are allocated when they are dispatched
+  if (!admit(devctx, sz)) {
+    DEVLOG(devctx->id, LALL_SCHEDULER,
+           "job " PRIjob ": staging budget exhausted, deferring transfers",
+           j_id);
+    tapasco_perfc_staging_deferred_inc(devctx->id);
+    return;
+  }
+  DEVLOG(devctx->id, LALL_SCHEDULER, "Preloading transfers for Job %d", j_id);
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (!t)
+      continue;
 
-    if (t->len && !(t->flags & TAPASCO_DEVICE_COPY_PE_LOCAL)) {
+    if (is_preloadable(t)) {
       if ((r = tapasco_transfer_to(devctx, j_id, t, 0)) != TAPASCO_SUCCESS) {
         DEVLOG(devctx->id, LALL_SCHEDULER, "Failed to preload transfer");
       } else {
         t->preloaded = 1;
+        staged += t->len;
       }
     } else {
       if (t->flags & TAPASCO_DEVICE_COPY_PE_LOCAL) {
-        DEVLOG(devctx->id, LALL_SCHEDULER, "Can not preload local memory");
+        DEVLOG(devctx->id, LALL_SCHEDULER,
+               "Local memory is loaded once the PE is chosen");
       }
     }
   }
+  if (staged < sz)
+    unstage(devctx, sz - staged);
+}
+
+void tapasco_scheduler_job_dispatched(tapasco_devctx_t *devctx,
+                                      tapasco_job_id_t const j_id) {
+  tapasco_scheduler_t *s = devctx->scheduler;
+  // a PE was handed to a queued job, held jobs of its kernel may pass now
+  if (s && atomic_load(&s->num_held))
+    while (sem_post(&s->staging))
+      ;
+  size_t sz = 0;
+  size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (t && t->preloaded == 1) {
+      t->preloaded = 2; // still preloaded, but no longer staged
+      sz += t->len;
+    }
+  }
+  if (sz)
+    unstage(devctx, sz);
+}
+
+/* Frees the buffers preloaded for a job which was not dispatched and returns
+ * them to the staging budget; the job preloads again when it is relaunched. */
+static void drop_staged(tapasco_devctx_t *devctx,
+                        tapasco_job_id_t const j_id) {
+  size_t sz = 0;
+  size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (!t || t->preloaded != 1)
+      continue;
+    if (t->shared) {
+      // successors keep their reference, the producer has not run yet
+      tapasco_bufpool_put(devctx->bufpool, t->handle, t->len);
+      t->shared->handle = 0;
+    } else {
+      tapasco_transfer_discard(devctx, j_id, t, 0);
+    }
+    t->preloaded = 0;
+    sz += t->len;
+  }
+  if (sz)
+    unstage(devctx, sz);
+}
+
+tapasco_res_t tapasco_device_set_staging_budget(tapasco_devctx_t *devctx,
+                                                size_t const budget) {
+  DEVLOG(devctx->id, LALL_SCHEDULER, "staging budget %zu bytes", budget);
+  atomic_store(&devctx->scheduler->budget, budget);
+  tapasco_perfc_staging_budget_kib_set(devctx->id, budget >> 10);
+  return TAPASCO_SUCCESS;
+}
+
+/* Releases the shared buffers held by a job which will not run. */
+static void drop_shared(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id) {
+  size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (t && t->shared)
+      tapasco_transfer_release(devctx, j_id, t, 0);
+  }
+}
+
+/* Fails a job because one of its predecessors failed. */
+static void fail_dependent(tapasco_devctx_t *devctx,
+                           tapasco_job_id_t const j_id) {
+  DEVERR(devctx->id, "job " PRIjob ": predecessor failed", j_id);
+  drop_shared(devctx, j_id);
+  tapasco_pemgmt_fail_job(devctx, j_id);
+}
+
+/* Holds back a job with unfinished predecessors: returns 1, if the job was
+ * parked and will be started by its last predecessor, -1 if a predecessor has
+ * failed, 0 if the job can be started now. */
+static int park_job(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id) {
+  if (!tapasco_jobs_has_deps(devctx->jobs, j_id))
+    return 0;
+  tapasco_jobs_set_state(devctx->jobs, j_id, TAPASCO_JOB_STATE_SCHEDULED);
+  if (tapasco_jobs_dec_deps(devctx->jobs, j_id) > 0) {
+    DEVLOG(devctx->id, LALL_SCHEDULER,
+           "job " PRIjob ": waiting for predecessors", j_id);
+    return 1;
+  }
+  if (tapasco_jobs_deps_failed(devctx->jobs, j_id)) {
+    fail_dependent(devctx, j_id);
+    return -1;
+  }
+  return 0;
+}
+
+/* Hands the buffers of a finished (or failed) job to its successors and starts
+ * those, whose predecessors have all finished. */
+static void release_successors(tapasco_devctx_t *devctx,
+                               tapasco_job_id_t const j_id, int const ok) {
+  tapasco_job_id_t succ[TAPASCO_JOB_MAX_SUCCESSORS];
+  size_t const n = tapasco_jobs_take_successors(devctx->jobs, j_id, succ);
+  if (!n)
+    return;
+  if (!ok)
+    drop_shared(devctx, j_id);
+  for (size_t i = 0; i < n; ++i) {
+    if (!ok)
+      tapasco_jobs_set_deps_failed(devctx->jobs, succ[i]);
+    if (tapasco_jobs_dec_deps(devctx->jobs, succ[i]))
+      continue;
+    if (tapasco_jobs_deps_failed(devctx->jobs, succ[i])) {
+      fail_dependent(devctx, succ[i]);
+      tapasco_cq_t *cq = tapasco_jobs_get_cq(devctx->jobs, succ[i]);
+      if (cq)
+        tapasco_cq_post(cq, succ[i]);
+    } else {
+      DEVLOG(devctx->id, LALL_SCHEDULER,
+             "job " PRIjob ": predecessors finished, launching", succ[i]);
+      tapasco_scheduler_launch_pipelined(devctx, succ[i]);
+    }
+  }
+}
+
+/* Returns the slot of the local memory holding PE-local data of the job. */
+static tapasco_slot_id_t find_resident(tapasco_devctx_t *devctx,
+                                       tapasco_job_id_t const j_id) {
+  size_t const num_args = tapasco_jobs_arg_count(devctx->jobs, j_id);
+  for (size_t a = 0; a < num_args; ++a) {
+    tapasco_transfer_t *t =
+        tapasco_jobs_get_arg_transfer(devctx->jobs, j_id, a);
+    if (t && t->data && (t->flags & TAPASCO_DEVICE_ALLOC_FLAGS_PE_LOCAL)) {
+      tapasco_slot_id_t const m =
+          tapasco_local_mem_find(devctx->lmem, t->data, t->len);
+      if (m < TAPASCO_NUM_SLOTS)
+        return m;
+    }
+  }
+  return TAPASCO_NUM_SLOTS;
+}
+
+static tapasco_res_t start_job(tapasco_devctx_t *devctx,
+                               tapasco_job_id_t const j_id) {
+  tapasco_slot_id_t slot_id;
+  tapasco_res_t r;
+  tapasco_kernel_t *kernel = tapasco_jobs_get_kernel(devctx->jobs, j_id);
 
   DEVLOG(devctx->id, LALL_SCHEDULER,
          "job " PRIjob ": launching for kernel " PRIkernel
          ", acquiring PE ... ",
-         j_id, k_id);
+         j_id, tapasco_jobs_get_kernel_id(devctx->jobs, j_id));
 
-  slot_id = tapasco_pemgmt_acquire_pe(devctx->pemgmt, k_id);
-  if (slot_id < 0 || slot_id >= TAPASCO_NUM_SLOTS) {
+  // kernels without PEs run on the CPU only
+  if (!kernel) {
+    DEVERR(devctx->id, "job " PRIjob ": cannot run on the CPU", j_id);
+    return TAPASCO_ERR_KERNEL_NOT_FOUND;
+  }
+
+  slot_id = tapasco_pemgmt_acquire_pe(devctx->pemgmt, kernel, j_id,
+                                      find_resident(devctx, j_id));
+  if (slot_id == TAPASCO_PEMGMT_JOB_QUEUED) {
+    DEVLOG(devctx->id, LALL_SCHEDULER,
+           "job " PRIjob ": all PEs busy, job was queued", j_id);
+    return TAPASCO_SUCCESS;
+  }
+  if (slot_id >= TAPASCO_NUM_SLOTS) {
     DEVERR(devctx->id, "received illegal slot id #%u", slot_id);
     return TAPASCO_ERR_INVALID_SLOT_ID;
   }
@@ -76,53 +317,503 @@ tapasco_res_t tapasco_scheduler_launch(tapasco_devctx_t *devctx,
     tapasco_perfc_pe_high_watermark_set(devctx->id, _slot_high_watermark);
 #endif
 
-  DEVLOG(devctx->id, LALL_SCHEDULER,
-         "job " PRIjob ": preparing slot #" PRIslot " ...", j_id, slot_id);
-  if ((r = tapasco_pemgmt_prepare_pe(devctx, j_id, slot_id)) !=
+  if ((r = tapasco_pemgmt_dispatch(devctx, j_id, slot_id)) !=
       TAPASCO_SUCCESS) {
-    DEVERR(devctx->id,
-           "could not prepare slot #" PRIslot " for job #" PRIjob
-           ": %s (" PRIres ")",
-           slot_id, j_id, tapasco_strerror(r), r);
+    tapasco_pemgmt_release_pe(devctx, slot_id);
     return r;
   }
+  return TAPASCO_SUCCESS;
+}
 
-  DEVLOG(devctx->id, LALL_SCHEDULER,
-         "job " PRIjob ": starting PE in slot #" PRIslot " ...", j_id, slot_id);
-  tapasco_jobs_set_slot(devctx->jobs, j_id, slot_id);
+tapasco_res_t tapasco_scheduler_launch(tapasco_devctx_t *devctx,
+                                       tapasco_job_id_t const j_id) {
+  assert(devctx->jobs);
+  tapasco_res_t r;
+  int const parked = park_job(devctx, j_id);
+  if (parked)
+    return parked > 0 ? TAPASCO_SUCCESS : TAPASCO_ERR_JOB_DISPATCH_FAILED;
+  if (!tapasco_fallback_offload(devctx, j_id)) {
+    preload_transfers(devctx, j_id);
+    if ((r = start_job(devctx, j_id)) != TAPASCO_SUCCESS)
+      return r;
+  }
+  tapasco_perfc_jobs_launched_inc(devctx->id);
+  return TAPASCO_SUCCESS;
+}
 
-  if ((r = tapasco_pemgmt_start_pe(devctx, slot_id)) != TAPASCO_SUCCESS) {
+/* Preloads the transfers of a pipelined job and dispatches or queues it. */
+static void stage_job(tapasco_devctx_t *devctx, tapasco_job_id_t const j_id) {
+  tapasco_res_t r;
+  preload_transfers(devctx, j_id);
+  if ((r = start_job(devctx, j_id)) == TAPASCO_ERR_JOB_ABORTED) {
+    return; // cancelled while it was staged, dropped already
+  } else if (r != TAPASCO_SUCCESS) {
     DEVERR(devctx->id,
-           "could not start PE in slot #" PRIslot ": %s (" PRIres ")", slot_id,
+           "job " PRIjob ": pipelined launch failed: %s (" PRIres ")", j_id,
            tapasco_strerror(r), r);
-    return r;
+    tapasco_pemgmt_fail_job(devctx, j_id);
+    tapasco_cq_t *cq = tapasco_jobs_get_cq(devctx->jobs, j_id);
+    if (cq)
+      tapasco_cq_post(cq, j_id);
+  } else {
+    tapasco_perfc_jobs_launched_inc(devctx->id);
   }
+}
 
-  tapasco_perfc_jobs_launched_inc(devctx->id);
+/* Returns non-zero, if enough jobs of the kernel wait for a PE already. */
+static inline int at_staging_depth(tapasco_kernel_t *kernel) {
+  // credits < 0 means that -credits jobs are waiting for a PE
+  return tapasco_pemgmt_credits(kernel) <=
+         -(long)TAPASCO_SCHEDULER_STAGING_DEPTH;
+}
+
+/* Returns the held jobs of a kernel; each kernel has at least one PE. */
+static struct held_jobs *get_held(tapasco_scheduler_t *s,
+                                  tapasco_kernel_t *kernel) {
+  for (size_t k = 0; k < s->num_kernels; ++k)
+    if (s->held[k].kernel == kernel)
+      return &s->held[k];
+  assert(s->num_kernels < TAPASCO_NUM_SLOTS);
+  struct held_jobs *h = &s->held[s->num_kernels++];
+  h->kernel = kernel;
+  h->q = gq_init();
+  return h;
+}
+
+/* Stages held jobs, in launch order per kernel, until their kernels reach
+ * the staging depth again. */
+static void stage_held(tapasco_scheduler_t *s) {
+  for (size_t k = 0; k < s->num_kernels; ++k) {
+    struct held_jobs *h = &s->held[k];
+    while (h->n && !at_staging_depth(h->kernel)) {
+      tapasco_job_id_t const j_id =
+          (tapasco_job_id_t)(uintptr_t)gq_dequeue(h->q);
+      --h->n;
+      atomic_fetch_sub(&s->num_held, 1);
+      stage_job(s->devctx, j_id);
+    }
+  }
+}
+
+/* Takes a pipelined job from the staging queue: runs it on the CPU, holds it
+ * back or stages it. */
+static void take_job(tapasco_scheduler_t *s, tapasco_job_id_t const j_id) {
+  tapasco_devctx_t *devctx = s->devctx;
+  tapasco_kernel_t *kernel = tapasco_jobs_get_kernel(devctx->jobs, j_id);
+  struct held_jobs *h = kernel ? get_held(s, kernel) : NULL;
+  // jobs run on the CPU, if waiting for a PE would take longer
+  if (tapasco_fallback_offload(devctx, j_id)) {
+    tapasco_perfc_jobs_launched_inc(devctx->id);
+  } else if (h && (h->n || at_staging_depth(kernel))) {
+    // bound the number of staged jobs waiting for a PE of the kernel, but let
+    // jobs of other kernels pass; the job is counted before the depth is
+    // checked again by stage_held, so that a concurrent dispatch wakes us
+    gq_enqueue(h->q, (void *)(uintptr_t)j_id);
+    ++h->n;
+    atomic_fetch_add(&s->num_held, 1);
+  } else {
+    stage_job(devctx, j_id);
+  }
+}
+
+static void *stage_jobs(void *p) {
+  tapasco_scheduler_t *s = (tapasco_scheduler_t *)p;
+  while (1) {
+    while (sem_wait(&s->staging))
+      ;
+    if (atomic_load(&s->stop))
+      break;
+    uintptr_t const h = (uintptr_t)gq_dequeue(s->handover_q);
+    if (h)
+      tapasco_pemgmt_hand_over(s->devctx, (tapasco_slot_id_t)(h - 1));
+    // no job: woken by a handover or a dispatch to stage held jobs
+    tapasco_job_id_t const j_id =
+        (tapasco_job_id_t)(uintptr_t)gq_dequeue(s->staging_q);
+    if (j_id)
+      take_job(s, j_id);
+    stage_held(s);
+  }
+  return NULL;
+}
+
+static void *complete_jobs(void *p) {
+  tapasco_scheduler_t *s = (tapasco_scheduler_t *)p;
+  tapasco_devctx_t *devctx = s->devctx;
+  while (1) {
+    while (sem_wait(&s->completed))
+      ;
+    if (atomic_load(&s->stop))
+      break;
+    tapasco_job_id_t const j_id =
+        (tapasco_job_id_t)(uintptr_t)gq_dequeue(s->completed_q);
+    assert(j_id);
+    // failed jobs have been reported already, only their successors remain
+    int const failed = tapasco_jobs_get_state(devctx->jobs, j_id) ==
+                       TAPASCO_JOB_STATE_FAILED;
+    tapasco_res_t const r = tapasco_scheduler_complete_job(devctx, j_id);
+    if (r != TAPASCO_SUCCESS && !failed)
+      DEVERR(devctx->id, "job " PRIjob " failed: %s (" PRIres ")", j_id,
+             tapasco_strerror(r), r);
+    tapasco_cq_t *cq = tapasco_jobs_get_cq(devctx->jobs, j_id);
+    if (cq && !failed)
+      tapasco_cq_post(cq, j_id);
+  }
+  return NULL;
+}
+
+tapasco_res_t tapasco_scheduler_init(tapasco_devctx_t *devctx,
+                                     tapasco_scheduler_t **scheduler) {
+  tapasco_scheduler_t *s =
+      (tapasco_scheduler_t *)calloc(sizeof(tapasco_scheduler_t), 1);
+  if (!s) {
+    DEVERR(devctx->id, "could not allocate scheduler");
+    return TAPASCO_ERR_OUT_OF_MEMORY;
+  }
+  s->devctx = devctx;
+  s->budget = TAPASCO_SCHEDULER_STAGING_BUDGET;
+  tapasco_perfc_staging_budget_kib_set(devctx->id, s->budget >> 10);
+  s->staging_q = gq_init();
+  s->handover_q = gq_init();
+  sem_init(&s->staging, 0, 0);
+  s->completed_q = gq_init();
+  sem_init(&s->completed, 0, 0);
+  if (pthread_create(&s->stager, NULL, stage_jobs, s)) {
+    DEVERR(devctx->id, "could not start staging thread: %s (%d)",
+           strerror(errno), errno);
+    sem_destroy(&s->completed);
+    gq_destroy(s->completed_q);
+    sem_destroy(&s->staging);
+    gq_destroy(s->handover_q);
+    gq_destroy(s->staging_q);
+    free(s);
+    return TAPASCO_ERR_PTHREAD_ERROR;
+  }
+  if (pthread_create(&s->completer, NULL, complete_jobs, s)) {
+    DEVERR(devctx->id, "could not start completion thread: %s (%d)",
+           strerror(errno), errno);
+    atomic_store(&s->stop, 1);
+    sem_post(&s->staging);
+    pthread_join(s->stager, NULL);
+    sem_destroy(&s->completed);
+    gq_destroy(s->completed_q);
+    sem_destroy(&s->staging);
+    gq_destroy(s->handover_q);
+    gq_destroy(s->staging_q);
+    free(s);
+    return TAPASCO_ERR_PTHREAD_ERROR;
+  }
+  *scheduler = s;
   return TAPASCO_SUCCESS;
 }
 
+void tapasco_scheduler_deinit(tapasco_scheduler_t *s) {
+  if (s) {
+    atomic_store(&s->stop, 1);
+    sem_post(&s->staging);
+    sem_post(&s->completed);
+    pthread_join(s->stager, NULL);
+    pthread_join(s->completer, NULL);
+    while (gq_dequeue(s->staging_q))
+      ;
+    gq_destroy(s->staging_q);
+    while (gq_dequeue(s->handover_q))
+      ;
+    gq_destroy(s->handover_q);
+    for (size_t k = 0; k < s->num_kernels; ++k) {
+      while (gq_dequeue(s->held[k].q))
+        ;
+      gq_destroy(s->held[k].q);
+    }
+    sem_destroy(&s->staging);
+    while (gq_dequeue(s->completed_q))
+      ;
+    gq_destroy(s->completed_q);
+    sem_destroy(&s->completed);
+    free(s);
+  }
+}
+
+tapasco_res_t tapasco_scheduler_launch_pipelined(tapasco_devctx_t *devctx,
+                                                 tapasco_job_id_t const j_id) {
+  tapasco_scheduler_t *s = devctx->scheduler;
+  assert(s);
+  int const parked = park_job(devctx, j_id);
+  if (parked)
+    return parked > 0 ? TAPASCO_SUCCESS : TAPASCO_ERR_JOB_DISPATCH_FAILED;
+  DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": handing over to stager",
+         j_id);
+  tapasco_jobs_set_state(devctx->jobs, j_id, TAPASCO_JOB_STATE_SCHEDULED);
+  gq_enqueue(s->staging_q, (void *)(uintptr_t)j_id);
+  while (sem_post(&s->staging))
+    ;
+  return TAPASCO_SUCCESS;
+}
+
+tapasco_res_t tapasco_scheduler_launch_batch(tapasco_devctx_t *devctx,
+                                             size_t const num_jobs,
+                                             tapasco_job_id_t const *j_ids,
+                                             size_t *num_launched) {
+  assert(devctx->jobs);
+  tapasco_res_t r = TAPASCO_SUCCESS;
+  size_t j;
+  DEVLOG(devctx->id, LALL_SCHEDULER, "launching batch of %zd jobs", num_jobs);
+  // stage all inputs first, so that DMA for the whole batch is issued
+  // before the first PE is occupied or a job is handed to the CPU
+  for (j = 0; j < num_jobs; ++j)
+    if (!tapasco_jobs_has_deps(devctx->jobs, j_ids[j]))
+      preload_transfers(devctx, j_ids[j]);
+  // jobs waiting for predecessors are started by the last predecessor, jobs
+  // run on the CPU by a worker instead
+  for (j = 0; j < num_jobs; ++j) {
+    int const parked = park_job(devctx, j_ids[j]);
+    if (parked < 0) {
+      r = TAPASCO_ERR_JOB_DISPATCH_FAILED;
+      break;
+    }
+    if (parked)
+      continue;
+    if (tapasco_fallback_wants(devctx, j_ids[j])) {
+      drop_staged(devctx, j_ids[j]);
+      tapasco_fallback_submit(devctx, j_ids[j]);
+      continue;
+    }
+    if ((r = start_job(devctx, j_ids[j])) != TAPASCO_SUCCESS) {
+      if (r != TAPASCO_ERR_JOB_ABORTED)
+        break;
+      r = TAPASCO_SUCCESS; // cancelled meanwhile, not a launch failure
+    }
+  }
+  // jobs which were not started (including the failed one) free their
+  // preloaded buffers and no longer count against the staging budget; their
+  // successors fail, so that no parked job waits for them
+  for (size_t k = j; k < num_jobs; ++k) {
+    drop_staged(devctx, j_ids[k]);
+    release_successors(devctx, j_ids[k], 0);
+  }
+  tapasco_perfc_jobs_launched_add(devctx->id, j);
+  if (num_launched)
+    *num_launched = j;
+  return r;
+}
+
 inline tapasco_res_t tapasco_device_job_collect(tapasco_devctx_t *devctx,
                                                 tapasco_job_id_t const job_id) {
-  return tapasco_scheduler_finish_job(devctx, job_id);
+  return tapasco_scheduler_finish_job(devctx, job_id, NULL);
+}
+
+/* Sets deadline to timeout_ns from now (CLOCK_MONOTONIC). */
+static void set_deadline(struct timespec *deadline, uint64_t const timeout_ns) {
+  clock_gettime(CLOCK_MONOTONIC, deadline);
+  deadline->tv_sec += timeout_ns / 1000000000ULL;
+  deadline->tv_nsec += timeout_ns % 1000000000ULL;
+  if (deadline->tv_nsec >= 1000000000L) {
+    deadline->tv_nsec -= 1000000000L;
+    ++deadline->tv_sec;
+  }
+}
+
+tapasco_res_t tapasco_device_job_collect_timed(tapasco_devctx_t *devctx,
+                                               tapasco_job_id_t const job_id,
+                                               uint64_t const timeout_ns) {
+  struct timespec deadline;
+  set_deadline(&deadline, timeout_ns);
+  tapasco_res_t const r =
+      tapasco_scheduler_finish_job(devctx, job_id, &deadline);
+  if (r == TAPASCO_ERR_TIMEOUT) {
+    DEVLOG(devctx->id, LALL_SCHEDULER,
+           "job " PRIjob ": not finished after %llu ns", job_id,
+           (unsigned long long)timeout_ns);
+    tapasco_perfc_jobs_timed_out_inc(devctx->id);
+  }
+  return r;
+}
+
+int tapasco_device_job_ready(tapasco_devctx_t *devctx,
+                             tapasco_job_id_t const job_id) {
+  return tapasco_pemgmt_job_ready(devctx, job_id);
+}
+
+tapasco_res_t tapasco_device_job_wait_some(
+    tapasco_devctx_t *devctx, size_t const num_jobs,
+    tapasco_job_id_t const *job_ids, size_t const min_ready,
+    tapasco_job_id_t *ready_ids, size_t *num_ready, uint64_t const timeout_ns) {
+  struct timespec deadline;
+  *num_ready = 0;
+  for (size_t i = 0; i < num_jobs; ++i) {
+    tapasco_job_state_t const st =
+        tapasco_jobs_get_state(devctx->jobs, job_ids[i]);
+    if (st == TAPASCO_JOB_STATE_READY || st == TAPASCO_JOB_STATE_REQUESTED) {
+      DEVERR(devctx->id, "job " PRIjob " was not launched", job_ids[i]);
+      return TAPASCO_ERR_JOB_ID_NOT_FOUND;
+    }
+    // completion queues receive the signals of their jobs
+    if (tapasco_jobs_get_cq(devctx->jobs, job_ids[i])) {
+      DEVERR(devctx->id, "job " PRIjob " is attached to a completion queue",
+             job_ids[i]);
+      return TAPASCO_ERR_JOB_ON_CQ;
+    }
+  }
+  size_t const min_n = min_ready < num_jobs ? min_ready : num_jobs;
+  if (timeout_ns != TAPASCO_WAIT_FOREVER)
+    set_deadline(&deadline, timeout_ns);
+  *num_ready = tapasco_pemgmt_wait_ready(
+      devctx, num_jobs, job_ids, min_n, ready_ids,
+      timeout_ns != TAPASCO_WAIT_FOREVER ? &deadline : NULL);
+  DEVLOG(devctx->id, LALL_SCHEDULER, "%zu of %zu jobs ready", *num_ready,
+         num_jobs);
+  return *num_ready >= min_n ? TAPASCO_SUCCESS : TAPASCO_ERR_TIMEOUT;
+}
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Polls the interrupt status register of the PE in the given slot for up to
+ * budget_ns; returns non-zero, if the PE has finished. */
+static int poll_slot(tapasco_devctx_t *devctx, tapasco_slot_id_t const slot_id,
+                     uint32_t const budget_ns) {
+  platform_devctx_t *p = devctx->pdctx;
+  if (platform_poll_slot_begin(p, slot_id) != PLATFORM_SUCCESS)
+    return 0;
+  tapasco_handle_t const isr =
+      tapasco_regs_named_register(devctx, slot_id, TAPASCO_REG_IAR);
+  volatile uint32_t *r =
+      (volatile uint32_t *)((uintptr_t)device_regspace_arch_ptr(p) +
+                            ((uintptr_t)isr - device_regspace_arch_base(p)));
+  uint64_t const deadline = now_ns() + budget_ns;
+  int finished;
+  while (!(finished = *r & 1) && now_ns() < deadline)
+    ;
+  if ((finished = platform_poll_slot_end(p, slot_id, finished)))
+    tapasco_perfc_poll_hits_inc(devctx->id);
+  else
+    tapasco_perfc_poll_misses_inc(devctx->id);
+  return finished;
+}
+
+/* Maps the state of a job completed by another thread to a result. */
+static tapasco_res_t job_result(tapasco_job_state_t const st) {
+  switch (st) {
+  case TAPASCO_JOB_STATE_FINISHED:
+    return TAPASCO_SUCCESS;
+  case TAPASCO_JOB_STATE_FAILED:
+    return TAPASCO_ERR_JOB_DISPATCH_FAILED;
+  case TAPASCO_JOB_STATE_ABORTED:
+    return TAPASCO_ERR_JOB_ABORTED;
+  default: // still waiting or running
+    return TAPASCO_ERR_TIMEOUT;
+  }
 }
 
 tapasco_res_t tapasco_scheduler_finish_job(tapasco_devctx_t *devctx,
-                                           tapasco_job_id_t const j_id) {
+                                           tapasco_job_id_t const j_id,
+                                           struct timespec const *deadline) {
   platform_res_t pr;
+  tapasco_job_state_t st;
+  if (tapasco_jobs_get_cq(devctx->jobs, j_id)) {
+    DEVERR(devctx->id, "job " PRIjob " is attached to a completion queue",
+           j_id);
+    return TAPASCO_ERR_JOB_ON_CQ;
+  }
+  // jobs with successors are completed by the scheduler
+  if (tapasco_jobs_num_successors(devctx->jobs, j_id))
+    return job_result(tapasco_pemgmt_wait_finished(devctx, j_id, deadline));
+  // job may still be waiting in the run queue of its kernel
+  st = tapasco_pemgmt_wait_dispatched(devctx, j_id, deadline);
+  if (st != TAPASCO_JOB_STATE_RUNNING)
+    return job_result(st);
   const tapasco_slot_id_t slot_id = tapasco_jobs_get_slot(devctx->jobs, j_id);
+  // jobs on the CPU are completed by their worker
+  if (slot_id == TAPASCO_FALLBACK_SLOT)
+    return job_result(tapasco_pemgmt_wait_finished(devctx, j_id, deadline));
   DEVLOG(devctx->id, LALL_SCHEDULER,
          "job " PRIjob ":  waiting for slot #" PRIslot " ...", j_id, slot_id);
+  uint32_t budget_ns = tapasco_jobs_get_poll_budget(devctx->jobs, j_id);
+  if (!budget_ns)
+    budget_ns = tapasco_pemgmt_get_poll_budget(devctx->pemgmt, slot_id);
+  // with shared access, the signal of a polled slot could reach the next
+  // process holding the PE
+  if (devctx->pdctx->mode == PLATFORM_SHARED_ACCESS)
+    budget_ns = 0;
+  if (budget_ns && poll_slot(devctx, slot_id, budget_ns)) {
+    DEVLOG(devctx->id, LALL_SCHEDULER, "job " PRIjob ": finished while polling",
+           j_id);
+    return tapasco_scheduler_complete_job(devctx, j_id);
+  }
   tapasco_perfc_waiting_for_job_set(devctx->id, j_id);
-  if ((pr = platform_wait_for_slot(devctx->pdctx, slot_id)) !=
-      PLATFORM_SUCCESS) {
+  pr = deadline
+           ? platform_wait_for_slot_timed(devctx->pdctx, slot_id, deadline)
+           : platform_wait_for_slot(devctx->pdctx, slot_id);
+  tapasco_perfc_waiting_for_job_set(devctx->id, 0);
+  if (pr == PERR_TIMEOUT)
+    return TAPASCO_ERR_TIMEOUT;
+  if (pr != PLATFORM_SUCCESS) {
     DEVERR(devctx->id, "waiting for job #" PRIjob " failed: %s (" PRIres ")",
            j_id, platform_strerror(pr), pr);
     return TAPASCO_ERR_PLATFORM_FAILURE;
   }
-  tapasco_perfc_waiting_for_job_set(devctx->id, 0);
+  // a quarantined PE may finish late, after its job was cancelled
+  if (tapasco_pemgmt_get_job(devctx->pemgmt, slot_id) != j_id) {
+    tapasco_pemgmt_free_quarantined(devctx, slot_id);
+    return TAPASCO_ERR_JOB_ABORTED;
+  }
   DEVLOG(devctx->id, LALL_SCHEDULER,
          "job " PRIjob ": returned successfully from waiting", j_id);
+  return tapasco_scheduler_complete_job(devctx, j_id);
+}
+
+tapasco_res_t tapasco_scheduler_complete_job(tapasco_devctx_t *devctx,
+                                             tapasco_job_id_t const j_id) {
+  tapasco_res_t r;
+  switch (tapasco_jobs_get_state(devctx->jobs, j_id)) {
+  case TAPASCO_JOB_STATE_FINISHED: // completed by the scheduler already
+    return TAPASCO_SUCCESS;
+  case TAPASCO_JOB_STATE_FAILED:
+    release_successors(devctx, j_id, 0);
+    return TAPASCO_ERR_JOB_DISPATCH_FAILED;
+  case TAPASCO_JOB_STATE_ABORTED: // cleaned up by the canceller
+    return TAPASCO_ERR_JOB_ABORTED;
+  default:
+    break;
+  }
+  tapasco_slot_id_t const slot_id = tapasco_jobs_get_slot(devctx->jobs, j_id);
+  int const on_cpu = slot_id == TAPASCO_FALLBACK_SLOT;
+  // either this thread or tapasco_device_job_cancel takes the PE off the job
+  if (!on_cpu && !tapasco_pemgmt_claim_job(devctx->pemgmt, slot_id, j_id))
+    return TAPASCO_ERR_JOB_ABORTED;
+  int const has_succ = tapasco_jobs_num_successors(devctx->jobs, j_id) > 0;
   tapasco_perfc_jobs_completed_inc(devctx->id);
-  return tapasco_pemgmt_finish_pe(devctx, j_id);
+  // jobs on the CPU have no PE to finish, results are in place already
+  r = on_cpu ? TAPASCO_SUCCESS : tapasco_pemgmt_finish_pe(devctx, j_id);
+  if (r == TAPASCO_SUCCESS) {
+    if (!tapasco_pemgmt_finish_job(devctx, j_id))
+      return TAPASCO_ERR_JOB_ABORTED; // cancelled while running on the CPU
+  } else if (has_succ) // wake up threads waiting for the scheduler
+    tapasco_pemgmt_fail_job(devctx, j_id);
+  release_successors(devctx, j_id, r == TAPASCO_SUCCESS);
+  return r;
+}
+
+void tapasco_scheduler_post_completed(tapasco_devctx_t *devctx,
+                                      tapasco_job_id_t const j_id) {
+  tapasco_scheduler_t *s = devctx->scheduler;
+  assert(s);
+  DEVLOG(devctx->id, LALL_SCHEDULER,
+         "job " PRIjob ": handing over to completion thread", j_id);
+  gq_enqueue(s->completed_q, (void *)(uintptr_t)j_id);
+  while (sem_post(&s->completed))
+    ;
+}
+
+void tapasco_scheduler_post_handover(tapasco_devctx_t *devctx,
+                                     tapasco_slot_id_t const s_id) {
+  tapasco_scheduler_t *s = devctx->scheduler;
+  assert(s);
+  DEVLOG(devctx->id, LALL_SCHEDULER,
+         "slot #" PRIslot ": handing over to staging thread", s_id);
+  gq_enqueue(s->handover_q, (void *)((uintptr_t)s_id + 1));
+  while (sem_post(&s->staging))
+    ;
 }
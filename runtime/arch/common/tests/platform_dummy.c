@@ -22,40 +22,73 @@
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
 #include <platform.h>
+#include <platform_devctx.h>
+#include <string.h>
 
-platform_res_t platform_read_mem(platform_ctx_t const *ctx,
-                                 platform_mem_addr_t const start_addr,
-                                 size_t const no_of_bytes, void *data,
-                                 platform_mem_flags_t const flags) {
+platform_res_t platform_create_device(platform_ctx_t *ctx,
+                                      platform_dev_id_t const dev_id,
+                                      platform_access_t const mode,
+                                      platform_devctx_t **pdctx) {
+  return PERR_NOT_IMPLEMENTED;
+}
+
+void platform_destroy_device(platform_ctx_t *ctx, platform_devctx_t *pdctx) {}
+
+platform_res_t platform_info(platform_devctx_t const *ctx,
+                             platform_info_t *info) {
+  memcpy(info, &ctx->info, sizeof(*info));
   return PLATFORM_SUCCESS;
 }
 
-platform_res_t platform_write_mem(platform_ctx_t const *ctx,
-                                  platform_mem_addr_t const start_addr,
-                                  size_t const no_of_bytes, void const *data,
-                                  platform_mem_flags_t const flags) {
+volatile void *device_regspace_arch_ptr(const platform_devctx_t *devctx) {
+  return NULL;
+}
+
+uintptr_t device_regspace_arch_base(const platform_devctx_t *devctx) {
+  return 0;
+}
+
+platform_res_t platform_wait_for_slot(platform_devctx_t *ctx,
+                                      platform_slot_id_t const slot) {
   return PLATFORM_SUCCESS;
 }
 
-platform_res_t platform_read_ctl(platform_ctx_t const *ctx,
-                                 platform_ctl_addr_t const start_addr,
-                                 size_t const no_of_bytes, void *data,
-                                 platform_ctl_flags_t const flags) {
+platform_res_t platform_wait_for_slot_timed(platform_devctx_t *ctx,
+                                            platform_slot_id_t const slot,
+                                            struct timespec const *deadline) {
   return PLATFORM_SUCCESS;
 }
 
-platform_res_t platform_write_ctl(platform_ctx_t const *ctx,
-                                  platform_ctl_addr_t const start_addr,
-                                  size_t const no_of_bytes, void const *data,
-                                  platform_ctl_flags_t const flags) {
+void platform_signal_received(platform_devctx_t *ctx,
+                              platform_signal_received_f cb, void *arg) {}
+
+platform_res_t platform_poll_slot_begin(platform_devctx_t *ctx,
+                                        platform_slot_id_t const slot) {
   return PLATFORM_SUCCESS;
 }
 
-platform_res_t platform_write_ctl_and_wait(platform_ctx_t *ctx,
-                                           platform_ctl_addr_t const w_addr,
-                                           size_t const w_no_of_bytes,
-                                           void const *w_data,
-                                           uint32_t const event,
-                                           platform_ctl_flags_t const flags) {
+int platform_poll_slot_end(platform_devctx_t *ctx,
+                           platform_slot_id_t const slot, int const finished) {
+  return finished;
+}
+
+platform_res_t platform_acquire_pe(platform_devctx_t *ctx,
+                                   platform_kernel_id_t const k_id,
+                                   platform_slot_id_t *slot) {
+  return PERR_NOT_IMPLEMENTED;
+}
+
+platform_res_t platform_release_pe(platform_devctx_t *ctx,
+                                   platform_slot_id_t const slot) {
   return PLATFORM_SUCCESS;
 }
+
+platform_res_t platform_set_share(platform_devctx_t *ctx,
+                                  uint32_t const weight) {
+  return PERR_NOT_IMPLEMENTED;
+}
+
+platform_res_t platform_get_share(platform_devctx_t *ctx, uint32_t *weight,
+                                  uint64_t *pe_ns) {
+  return PERR_NOT_IMPLEMENTED;
+}
@@ -0,0 +1,172 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TaPaSCo).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/**
+ *  @file	tapasco_cancel_test.c
+ *  @brief	Job cancellation test.
+ *  		Launches a job with a device buffer on a fake device, cancels
+ *  		it while its PE is running and checks that the buffer is not
+ *  		handed out again before the PE has finished.
+ *  @author	Embedded Systems and Applications Group, TU Darmstadt
+ **/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <platform_devctx.h>
+#include <tapasco_bufpool.h>
+#include <tapasco_device.h>
+#include <tapasco_fallback.h>
+#include <tapasco_jobs.h>
+#include <tapasco_pemgmt.h>
+#include <tapasco_scheduler.h>
+
+#define KERNEL_ID 42
+#define BUF_SZ 4096
+
+/* @{ globals */
+static platform_devctx_t _pdctx;
+static tapasco_devctx_t _devctx;
+static platform_mem_addr_t _next = 0x1000;
+static int _failed;
+/* globals @} */
+
+/* @{ fake device: PEs never finish, memory is never reused by the device */
+static platform_res_t write_ctl(platform_devctx_t const *ctx,
+                                platform_ctl_addr_t const addr,
+                                size_t const length, void const *data,
+                                platform_ctl_flags_t const flags) {
+  return PLATFORM_SUCCESS;
+}
+
+static platform_res_t read_ctl(platform_devctx_t const *ctx,
+                               platform_ctl_addr_t const addr,
+                               size_t const length, void *data,
+                               platform_ctl_flags_t const flags) {
+  memset(data, 0, length);
+  return PLATFORM_SUCCESS;
+}
+
+static platform_res_t alloc(platform_devctx_t *ctx, size_t const len,
+                            platform_mem_addr_t *addr,
+                            platform_alloc_flags_t const flags) {
+  *addr = _next;
+  _next += len;
+  return PLATFORM_SUCCESS;
+}
+
+static platform_res_t dealloc(platform_devctx_t *ctx, size_t const len,
+                              platform_mem_addr_t const addr,
+                              platform_alloc_flags_t const flags) {
+  return PLATFORM_SUCCESS;
+}
+
+static platform_res_t write_mem(platform_devctx_t const *ctx,
+                                platform_mem_addr_t const addr,
+                                size_t const length, void const *data,
+                                platform_mem_flags_t const flags) {
+  return PLATFORM_SUCCESS;
+}
+
+static platform_res_t read_mem(platform_devctx_t const *ctx,
+                               platform_mem_addr_t const addr,
+                               size_t const length, void *data,
+                               platform_mem_flags_t const flags) {
+  return PLATFORM_SUCCESS;
+}
+
+static void setup_device(void) {
+  _pdctx.info.composition.kernel[0] = KERNEL_ID;
+  _pdctx.dops.write_ctl = write_ctl;
+  _pdctx.dops.read_ctl = read_ctl;
+  _pdctx.dops.alloc = alloc;
+  _pdctx.dops.dealloc = dealloc;
+  _pdctx.dops.write_mem = write_mem;
+  _pdctx.dops.read_mem = read_mem;
+  _devctx.pdctx = &_pdctx;
+  tapasco_res_t r = tapasco_jobs_init(0, &_devctx.jobs);
+  r = r == TAPASCO_SUCCESS ? tapasco_pemgmt_init(&_devctx, &_devctx.pemgmt) : r;
+  r = r == TAPASCO_SUCCESS ? tapasco_bufpool_init(&_devctx, &_devctx.bufpool)
+                           : r;
+  r = r == TAPASCO_SUCCESS
+          ? tapasco_scheduler_init(&_devctx, &_devctx.scheduler)
+          : r;
+  r = r == TAPASCO_SUCCESS ? tapasco_fallback_init(&_devctx, &_devctx.fallback)
+                           : r;
+  if (r != TAPASCO_SUCCESS) {
+    fprintf(stderr, "ERROR: could not set up device: %s\n",
+            tapasco_strerror(r));
+    exit(EXIT_FAILURE);
+  }
+}
+/* fake device @} */
+
+#define CHECK(c)                                                               \
+  do {                                                                         \
+    if (!(c)) {                                                                \
+      fprintf(stderr, "FAILED: %s (line %d)\n", #c, __LINE__);                 \
+      ++_failed;                                                               \
+    }                                                                          \
+  } while (0)
+
+/* @{ tests */
+static void test_cancel_running(void) {
+  static char data[BUF_SZ];
+  tapasco_job_id_t j_id;
+  tapasco_handle_t h = 0;
+  CHECK(tapasco_device_acquire_job_id(&_devctx, &j_id, KERNEL_ID, 0) ==
+        TAPASCO_SUCCESS);
+  CHECK(tapasco_device_job_set_arg_transfer(&_devctx, j_id, 0, BUF_SZ, data,
+                                            TAPASCO_DEVICE_ALLOC_FLAGS_NONE,
+                                            TAPASCO_COPY_DIRECTION_BOTH) ==
+        TAPASCO_SUCCESS);
+  CHECK(tapasco_device_job_launch(&_devctx, j_id,
+                                  TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING) ==
+        TAPASCO_SUCCESS);
+  CHECK(tapasco_jobs_get_state(_devctx.jobs, j_id) ==
+        TAPASCO_JOB_STATE_RUNNING);
+  tapasco_slot_id_t const slot_id = tapasco_jobs_get_slot(_devctx.jobs, j_id);
+  tapasco_handle_t const buf =
+      tapasco_jobs_get_arg_transfer(_devctx.jobs, j_id, 0)->handle;
+
+  CHECK(tapasco_device_job_cancel(&_devctx, j_id) == TAPASCO_SUCCESS);
+  tapasco_device_release_job_id(&_devctx, j_id);
+  // PE may still write to the buffer of the cancelled job
+  CHECK(tapasco_bufpool_get(_devctx.bufpool, &h, BUF_SZ) == TAPASCO_SUCCESS);
+  CHECK(h != buf);
+  tapasco_bufpool_put(_devctx.bufpool, h, BUF_SZ);
+
+  // once the PE has finished, the buffer is returned to the pool
+  tapasco_pemgmt_free_quarantined(&_devctx, slot_id);
+  CHECK(tapasco_bufpool_get(_devctx.bufpool, &h, BUF_SZ) == TAPASCO_SUCCESS);
+  CHECK(h == buf);
+  tapasco_bufpool_put(_devctx.bufpool, h, BUF_SZ);
+}
+/* tests @} */
+
+/* @{ main */
+int main(int argc, char *argv[]) {
+  setup_device();
+  test_cancel_running();
+  if (_failed)
+    fprintf(stderr, "%d checks failed\n", _failed);
+  else
+    printf("all checks passed\n");
+  return _failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+/* main @} */
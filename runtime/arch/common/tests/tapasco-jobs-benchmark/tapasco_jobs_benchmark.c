@@ -0,0 +1,196 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TaPaSCo).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/**
+ *  @file	tapasco_jobs_benchmark.c
+ *  @brief	Job id pool scaling benchmark.
+ *  		Starts an increasing number of threads, each acquiring and
+ *  		releasing job ids as fast as possible, and reports the average
+ *  		cost of an acquire/release pair per thread count.
+ *  		A second pass runs the job part of the launch path: each job
+ *  		gets scalar arguments (and optionally a transfer), which are
+ *  		then read back the way the PE management prepares a PE.
+ *  @author	Embedded Systems and Applications Group, TU Darmstadt
+ **/
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <tapasco_jobs.h>
+
+#define DEFAULT_ITERATIONS 1000000L
+#define DEFAULT_MAX_THREADS 32L
+/** number of job ids held by each thread at the same time **/
+#define JOBS_IN_FLIGHT 2
+/** number of jobs in flight in launch pass (split among threads) **/
+#define LAUNCH_JOBS_IN_FLIGHT 192
+/** number of scalar arguments per job in launch pass **/
+#define LAUNCH_ARGS 4
+
+/* @{ globals */
+static tapasco_jobs_t *_jobs;
+static long _iterations;
+static long _failed;
+static int _transfers;
+static long _in_flight;
+/* globals @} */
+
+/* @{ thread main */
+static void *thread_main(void *p) {
+  tapasco_job_id_t j_id[JOBS_IN_FLIGHT];
+  long failed = 0;
+  for (long i = 0; i < _iterations; ++i) {
+    for (int j = 0; j < JOBS_IN_FLIGHT; ++j)
+      failed += !(j_id[j] = tapasco_jobs_acquire(_jobs));
+    for (int j = 0; j < JOBS_IN_FLIGHT; ++j)
+      if (j_id[j])
+        tapasco_jobs_release(_jobs, j_id[j]);
+  }
+  __atomic_add_fetch(&_failed, failed, __ATOMIC_RELAXED);
+  return NULL;
+}
+
+static void *launch_main(void *p) {
+  tapasco_job_id_t j_id[LAUNCH_JOBS_IN_FLIGHT];
+  static int buf[16];
+  long failed = 0;
+  for (long i = 0; i < _iterations / _in_flight; ++i) {
+    for (int j = 0; j < _in_flight; ++j) {
+      if (!(j_id[j] = tapasco_jobs_acquire(_jobs))) {
+        ++failed;
+        continue;
+      }
+      tapasco_jobs_set_kernel_id(_jobs, j_id[j], 42);
+      for (size_t a = 0; a < LAUNCH_ARGS; ++a) {
+        uint32_t const v = (uint32_t)(i + a);
+        tapasco_jobs_set_arg(_jobs, j_id[j], a, sizeof(v), &v);
+      }
+      if (_transfers)
+        tapasco_jobs_set_arg_transfer(_jobs, j_id[j], LAUNCH_ARGS, sizeof(buf),
+                                      buf, TAPASCO_DEVICE_ALLOC_FLAGS_NONE,
+                                      TAPASCO_COPY_DIRECTION_TO);
+      tapasco_jobs_set_state(_jobs, j_id[j], TAPASCO_JOB_STATE_SCHEDULED);
+    }
+    for (int j = 0; j < _in_flight; ++j) {
+      if (!j_id[j])
+        continue;
+      size_t const num_args = tapasco_jobs_arg_count(_jobs, j_id[j]);
+      uint64_t sum = 0;
+      for (size_t a = 0; a < num_args; ++a) {
+        tapasco_transfer_t *t =
+            tapasco_jobs_get_arg_transfer(_jobs, j_id[j], a);
+        if (t && t->len > 0)
+          sum += t->len;
+        else
+          sum += tapasco_jobs_get_arg32(_jobs, j_id[j], a);
+      }
+      tapasco_jobs_set_return(_jobs, j_id[j], sizeof(sum), &sum);
+      tapasco_jobs_release(_jobs, j_id[j]);
+    }
+  }
+  __atomic_add_fetch(&_failed, failed, __ATOMIC_RELAXED);
+  return NULL;
+}
+/* thread main @} */
+
+/* @{ run */
+static double run(long const thrdcnt, void *(*f)(void *)) {
+  struct timespec tv_begin, tv_end;
+  pthread_t threads[thrdcnt];
+  clock_gettime(CLOCK_MONOTONIC_RAW, &tv_begin);
+  for (long i = 0; i < thrdcnt; ++i) {
+    if (pthread_create(&threads[i], NULL, f, NULL)) {
+      fprintf(stderr, "ERROR: could not create thread: %s\n", strerror(errno));
+      threads[i] = (pthread_t)0;
+    }
+  }
+  for (long i = 0; i < thrdcnt; ++i)
+    if (threads[i])
+      pthread_join(threads[i], NULL);
+  clock_gettime(CLOCK_MONOTONIC_RAW, &tv_end);
+  return (tv_end.tv_sec - tv_begin.tv_sec) * 1e9 +
+         (tv_end.tv_nsec - tv_begin.tv_nsec);
+}
+/* run @} */
+
+/* @{ program usage */
+static void print_usage(void) {
+  fprintf(stderr,
+          "Usage: tapasco-jobs-benchmark [<MAX_THREADS> [<ITERATIONS>]]\n"
+          "where\n"
+          "\t<MAX_THREADS> = max. number of threads (>= 1)\n"
+          "\t<ITERATIONS> = number of iterations per thread\n\n");
+}
+/* program usage @} */
+
+/* @{ main */
+int main(int argc, char *argv[]) {
+  long max_threads = DEFAULT_MAX_THREADS;
+  errno = 0;
+  _iterations = DEFAULT_ITERATIONS;
+  if (argc > 1)
+    max_threads = strtol(argv[1], NULL, 0);
+  if (argc > 2)
+    _iterations = strtol(argv[2], NULL, 0);
+  if (errno || max_threads < 1 || _iterations < 1) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+
+  if (tapasco_jobs_init(0, &_jobs) != TAPASCO_SUCCESS) {
+    fprintf(stderr, "ERROR: could not initialize jobs\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("Starting job id benchmark with %ld iterations of %d jobs per "
+         "thread.\n",
+         _iterations, JOBS_IN_FLIGHT);
+  printf("%8s %16s %16s %10s\n", "threads", "ns / acq+rel", "Mops / s",
+         "failed");
+  for (long t = 1; t <= max_threads; t *= 2) {
+    _failed = 0;
+    double const ns = run(t, thread_main);
+    double const ops = (double)t * _iterations * JOBS_IN_FLIGHT;
+    printf("%8ld %16.2f %16.2f %10ld\n", t, ns * t / ops, ops / (ns / 1e3),
+           _failed);
+  }
+
+  for (_transfers = 0; _transfers <= 1; ++_transfers) {
+    printf("\nJob launch path with %d scalar args%s, %d jobs in flight.\n",
+           LAUNCH_ARGS, _transfers ? " + 1 transfer" : "",
+           LAUNCH_JOBS_IN_FLIGHT);
+    printf("%8s %16s %16s %10s\n", "threads", "ns / job", "Mjobs / s",
+           "failed");
+    for (long t = 1; t <= max_threads; t *= 2) {
+      _failed = 0;
+      _in_flight = LAUNCH_JOBS_IN_FLIGHT / t;
+      double const ns = run(t, launch_main);
+      double const ops = (double)t * (_iterations / _in_flight) * _in_flight;
+      printf("%8ld %16.2f %16.2f %10ld\n", t, ns * t / ops, ops / (ns / 1e3),
+             _failed);
+    }
+  }
+
+  tapasco_jobs_deinit(_jobs);
+  return EXIT_SUCCESS;
+}
+/* main @} */
+/* vim: set foldmarker=@{,@} foldlevel=0 foldmethod=marker : */
@@ -0,0 +1,145 @@
+//
+// Copyright (C) 2026 Embedded Systems and Applications Group, TU Darmstadt
+//
+// This file is part of Tapasco (TaPaSCo).
+//
+// Tapasco is free software: you can redistribute it and/or modify
+// it under the terms of the GNU Lesser General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// Tapasco is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU Lesser General Public License for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
+//
+/**
+ *  @file	tapasco_pemgmt_benchmark.c
+ *  @brief	PE management micro benchmark.
+ *  		Measures the host-side overhead of a job launch in the PE
+ *  		management, i.e., kernel lookup, PE count, acquire and release
+ *  		of a PE, on a fake composition; no device is required.
+ *  @author	Embedded Systems and Applications Group, TU Darmstadt
+ **/
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <platform_devctx.h>
+#include <tapasco_device.h>
+#include <tapasco_pemgmt.h>
+
+#define NUM_KERNELS 16
+#define PES_PER_KERNEL (TAPASCO_NUM_SLOTS / NUM_KERNELS)
+#define DEFAULT_LAUNCHES 10000000L
+#define DEFAULT_THREADS 1L
+
+/* @{ globals */
+static platform_devctx_t _pdctx;
+static tapasco_devctx_t _devctx;
+static long _launches;
+/* globals @} */
+
+/* @{ fake composition */
+static inline tapasco_kernel_id_t kernel_id(long const i) {
+  return (tapasco_kernel_id_t)(i % NUM_KERNELS) * 13 + 1; // sparse ids
+}
+
+static void setup_composition(void) {
+  for (tapasco_slot_id_t s = 0; s < TAPASCO_NUM_SLOTS; ++s)
+    _pdctx.info.composition.kernel[s] = kernel_id(s);
+  _devctx.pdctx = &_pdctx;
+}
+/* fake composition @} */
+
+/* @{ thread main */
+static void *thread_main(void *p) {
+  long const t = (long)p;
+  tapasco_pemgmt_t *pemgmt = _devctx.pemgmt;
+  for (long i = t; __atomic_sub_fetch(&_launches, 1, __ATOMIC_RELAXED) >= 0;
+       ++i) {
+    tapasco_kernel_id_t const k_id = kernel_id(i);
+    if (!tapasco_device_kernel_pe_count(&_devctx, k_id))
+      return NULL;
+    tapasco_kernel_t *kernel = tapasco_pemgmt_kernel(pemgmt, k_id);
+    tapasco_slot_id_t const s =
+        tapasco_pemgmt_acquire_pe(pemgmt, kernel, 1, TAPASCO_NUM_SLOTS);
+    tapasco_pemgmt_release_pe(&_devctx, s);
+  }
+  return NULL;
+}
+/* thread main @} */
+
+/* @{ run */
+static void run(long const thrdcnt) {
+  pthread_t threads[thrdcnt];
+  for (long i = 0; i < thrdcnt; ++i) {
+    if (pthread_create(&threads[i], NULL, thread_main, (void *)i)) {
+      fprintf(stderr, "ERROR: could not create thread: %s\n", strerror(errno));
+      threads[i] = (pthread_t)0;
+    }
+  }
+  for (long i = 0; i < thrdcnt; ++i)
+    if (threads[i])
+      pthread_join(threads[i], NULL);
+}
+/* run @} */
+
+/* @{ program usage */
+static void print_usage(void) {
+  fprintf(stderr,
+          "Usage: tapasco-pemgmt-benchmark [<NUM_THREADS> [<NUM_LAUNCHES>]]\n"
+          "where\n"
+          "\t<NUM_THREADS> = number of threads (1 - %d)\n"
+          "\t<NUM_LAUNCHES> = total number of launches\n\n",
+          PES_PER_KERNEL);
+}
+/* program usage @} */
+
+/* @{ main */
+int main(int argc, char *argv[]) {
+  struct timespec tv_begin, tv_end;
+  long thrdcnt = DEFAULT_THREADS;
+  long launches = DEFAULT_LAUNCHES;
+  errno = 0;
+  if (argc > 1)
+    thrdcnt = strtol(argv[1], NULL, 0);
+  if (argc > 2)
+    launches = strtol(argv[2], NULL, 0);
+  // more threads than PEs per kernel would queue jobs, which needs a device
+  if (errno || thrdcnt < 1 || thrdcnt > PES_PER_KERNEL || launches < 1) {
+    print_usage();
+    return EXIT_FAILURE;
+  }
+  _launches = launches;
+
+  setup_composition();
+  if (tapasco_pemgmt_init(&_devctx, &_devctx.pemgmt) != TAPASCO_SUCCESS) {
+    fprintf(stderr, "ERROR: could not initialize PE management\n");
+    return EXIT_FAILURE;
+  }
+
+  printf("Starting PE management benchmark with %ld threads for %ld "
+         "launches on %d kernels with %d PEs each.\n",
+         thrdcnt, launches, NUM_KERNELS, PES_PER_KERNEL);
+  clock_gettime(CLOCK_MONOTONIC_RAW, &tv_begin);
+  run(thrdcnt);
+  clock_gettime(CLOCK_MONOTONIC_RAW, &tv_end);
+  double const ns = (tv_end.tv_sec - tv_begin.tv_sec) * 1e9 +
+                    (tv_end.tv_nsec - tv_begin.tv_nsec);
+
+  printf("Run took %3.4f ms.\n", ns / 1e6);
+  printf("Average launch overhead: %8.2f ns\n", ns / launches);
+  printf("Average throughput: %12.1f launches/s\n", launches / (ns / 1e9));
+
+  tapasco_pemgmt_deinit(_devctx.pemgmt);
+  return EXIT_SUCCESS;
+}
+/* main @} */
+/* vim: set foldmarker=@{,@} foldlevel=0 foldmethod=marker : */
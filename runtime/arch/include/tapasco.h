@@ -161,6 +161,101 @@ tapasco_res_t tapasco_device_info(tapasco_devctx_t *dev_ctx,
 size_t tapasco_device_kernel_pe_count(tapasco_devctx_t *dev_ctx,
                                       tapasco_kernel_id_t const k_id);
 
+/**
+ * Sets the staging budget of the device: the max. number of bytes of device
+ * memory preloaded for launched jobs still waiting for a PE. Transfers of jobs
+ * launched while the budget is exhausted are deferred until the job is
+ * dispatched. Current usage is tracked by the perfc counter staged_kib.
+ * @param dev_ctx device context
+ * @param budget budget in bytes (default: TAPASCO_SCHEDULER_STAGING_BUDGET)
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_set_staging_budget(tapasco_devctx_t *dev_ctx,
+                                                size_t const budget);
+
+/**
+ * Sets the watermarks of the buffer pool of the device: device buffers of
+ * finished jobs are kept by size class and reused for the transfers of the
+ * next jobs. When more than high_watermark bytes are idle, the least recently
+ * used buffers are freed until at most low_watermark bytes remain.
+ * @param dev_ctx device context
+ * @param low_watermark idle bytes kept after trimming
+ *        (default: TAPASCO_BUFPOOL_LOW_WATERMARK)
+ * @param high_watermark max. idle bytes, 0 disables the pool
+ *        (default: TAPASCO_BUFPOOL_HIGH_WATERMARK)
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_set_buffer_pool(tapasco_devctx_t *dev_ctx,
+                                             size_t const low_watermark,
+                                             size_t const high_watermark);
+
+/**
+ * Returns the statistics of the buffer pool of the device.
+ * @param dev_ctx device context
+ * @param stats output parameter for the statistics
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t
+tapasco_device_buffer_pool_stats(tapasco_devctx_t *dev_ctx,
+                                 tapasco_buffer_pool_stats_t *stats);
+
+/**
+ * Sets the default completion polling budget for all jobs of kernel k_id,
+ * @see tapasco_device_job_set_poll_budget.
+ * @param dev_ctx device context
+ * @param k_id kernel id
+ * @param budget_ns polling budget in ns (0: wait for interrupts only)
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t
+tapasco_device_kernel_set_poll_budget(tapasco_devctx_t *dev_ctx,
+                                      tapasco_kernel_id_t const k_id,
+                                      uint32_t const budget_ns);
+
+/**
+ * Registers a host implementation of kernel k_id. Jobs of the kernel run on a
+ * pool of CPU worker threads instead of a PE, if the kernel has no PEs in the
+ * loaded bitstream, or if all its PEs are busy and the expected queueing delay
+ * exceeds the estimated runtime on the CPU; runtimes on PEs and on the CPU are
+ * learned from finished jobs. Jobs using device buffers without host data,
+ * e.g., job graph intermediates, always run on PEs, as do all jobs of kernels
+ * with PEs if the device is opened with shared access. Argument values are not
+ * written back.
+ * @param dev_ctx device context
+ * @param k_id kernel id
+ * @param fn host implementation (NULL: remove)
+ * @param user_data passed on to fn
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_kernel_set_cpu_fallback(
+    tapasco_devctx_t *dev_ctx, tapasco_kernel_id_t const k_id,
+    tapasco_cpu_kernel_t fn, void *user_data);
+
+/**
+ * Sets the share weight of this process for PEs of a device with shared
+ * access: the device driver grants PEs to the waiting process with the least
+ * PE time consumed relative to its weight, so that each process receives
+ * PE time in proportion to its weight. Raising the weight requires the
+ * CAP_SYS_NICE capability. Administrators can inspect and set the weights
+ * of all processes via /sys/class/misc/tlkm_<dev_id>/tenants.
+ * @param dev_ctx device context
+ * @param weight share weight (1 - 10000, default: 100)
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_set_share(tapasco_devctx_t *dev_ctx,
+                                      uint32_t const weight);
+
+/**
+ * Returns the share weight of this process and the PE time it consumed on
+ * the device, i.e., the time it held PEs.
+ * @param dev_ctx device context
+ * @param weight share weight (out)
+ * @param pe_ns PE time consumed in ns (out)
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_get_share(tapasco_devctx_t *dev_ctx,
+                                      uint32_t *weight, uint64_t *pe_ns);
+
 /**
  * Checks if the specified capability is available in the current bitstream.
  * @param dev_ctx device context
@@ -254,7 +349,9 @@ tapasco_device_load_bitstream(tapasco_devctx_t *dev_ctx, size_t const len,
  **/
 
 /**
- * Allocates a chunk of len bytes on the device.
+ * Allocates a chunk of len bytes on the device. If device memory is
+ * exhausted, idle buffers of the buffer pool are freed and the allocation is
+ * retried.
  * @param dev_ctx device context
  * @param h output parameter to write the handle to
  * @param len size in bytes
@@ -278,12 +375,20 @@ void tapasco_device_free(tapasco_devctx_t *dev_ctx, tapasco_handle_t handle,
 
 /**
  * Copys memory from main memory to the FPGA device.
+ * With TAPASCO_DEVICE_COPY_NONBLOCKING, the copy is run by a transfer worker
+ * thread and the call returns at once; the last variadic argument must be a
+ * tapasco_copy_id_t * receiving the id of the copy (after the slot id of
+ * PE-local copies). src must remain valid until the copy has finished, @see
+ * tapasco_device_copy_wait.
  * @param dev_ctx device context
  * @param src source address
  * @param dst destination device handle (prev. alloc'ed with tapasco_alloc)
  * @param len number of bytes to copy
- * @param flags	flags for copy operation, e.g., TAPASCO_COPY_NONBLOCKING
- * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
+ * @param flags	flags for copy operation, e.g., TAPASCO_DEVICE_COPY_NONBLOCKING
+ * @return TAPASCO_SUCCESS if copy was successful (or scheduled, if
+ *         nonblocking), TAPASCO_ERR_COPY_BUSY if too many nonblocking copies
+ *         are in flight, TAPASCO_ERR_INVALID_ARG if nonblocking without copy
+ *         id, an error code otherwise
  **/
 tapasco_res_t tapasco_device_copy_to(tapasco_devctx_t *dev_ctx, void const *src,
                                      tapasco_handle_t dst, size_t len,
@@ -292,12 +397,20 @@ tapasco_res_t tapasco_device_copy_to(tapasco_devctx_t *dev_ctx, void const *src,
 
 /**
  * Copys memory from FPGA device memory to main memory.
+ * With TAPASCO_DEVICE_COPY_NONBLOCKING, the copy is run by a transfer worker
+ * thread and the call returns at once; the last variadic argument must be a
+ * tapasco_copy_id_t * receiving the id of the copy (after the slot id of
+ * PE-local copies). dst is valid after the copy has finished, @see
+ * tapasco_device_copy_wait.
  * @param dev_ctx device context
  * @param src source device handle (prev. alloc'ed with tapasco_alloc)
  * @param dst destination address
  * @param len number of bytes to copy
- * @param flags	flags for copy operation, e.g., TAPASCO_COPY_NONBLOCKING
- * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
+ * @param flags	flags for copy operation, e.g., TAPASCO_DEVICE_COPY_NONBLOCKING
+ * @return TAPASCO_SUCCESS if copy was successful (or scheduled, if
+ *         nonblocking), TAPASCO_ERR_COPY_BUSY if too many nonblocking copies
+ *         are in flight, TAPASCO_ERR_INVALID_ARG if nonblocking without copy
+ *         id, an error code otherwise
  **/
 tapasco_res_t tapasco_device_copy_from(tapasco_devctx_t *dev_ctx,
                                        tapasco_handle_t src, void *dst,
@@ -305,6 +418,27 @@ tapasco_res_t tapasco_device_copy_from(tapasco_devctx_t *dev_ctx,
                                        tapasco_device_copy_flag_t const flags,
                                        ...);
 
+/**
+ * Returns non-zero, if the given nonblocking copy has finished, i.e., waiting
+ * for it will not block; does not block itself.
+ * @param dev_ctx device context
+ * @param copy_id copy id
+ * @return non-zero, if the copy has finished
+ **/
+int tapasco_device_copy_ready(tapasco_devctx_t *dev_ctx,
+                              tapasco_copy_id_t const copy_id);
+
+/**
+ * Waits until the given nonblocking copy has finished and releases its id;
+ * every nonblocking copy must be waited for exactly once.
+ * @param dev_ctx device context
+ * @param copy_id copy id
+ * @return result of the copy, TAPASCO_ERR_COPY_ID_NOT_FOUND if the id is
+ *         unknown or was waited for already
+ **/
+tapasco_res_t tapasco_device_copy_wait(tapasco_devctx_t *dev_ctx,
+                                       tapasco_copy_id_t const copy_id);
+
 /** @} **/
 
 /** @defgroup exec Execution Control
@@ -314,19 +448,35 @@ tapasco_res_t tapasco_device_copy_from(tapasco_devctx_t *dev_ctx,
 /**
  * Obtains a job context to associate kernel parameters with, i.e., that can
  * be used in @see tapasco_set_arg calls to set kernel arguments.
- * Note: May block until job context is available.
+ * Note: Blocks until a job context is available, unless
+ * TAPASCO_DEVICE_ACQUIRE_JOB_ID_NONBLOCKING is given.
  * @param dev_ctx device context
  * @param j_id pointer to job_id var
  * @param k_id kernel id
  * @param flags or'ed flags for the call,
  *        @see tapasco_device_acquire_job_id_flag_t for options
- * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ * @return TAPASCO_SUCCESS if successful, TAPASCO_ERR_NO_JOB_ID_AVAILABLE if
+ *         non-blocking and all job ids are in use, an error code otherwise
  **/
 tapasco_res_t
 tapasco_device_acquire_job_id(tapasco_devctx_t *dev_ctx, tapasco_job_id_t *j_id,
                               tapasco_kernel_id_t const k_id,
                               tapasco_device_acquire_job_id_flag_t flags);
 
+/**
+ * Obtains a job context like @see tapasco_device_acquire_job_id, but waits
+ * at most timeout_ns nanoseconds for a job context to become available.
+ * @param dev_ctx device context
+ * @param j_id pointer to job_id var
+ * @param k_id kernel id
+ * @param timeout_ns max. time to wait in ns
+ * @return TAPASCO_SUCCESS if successful, TAPASCO_ERR_TIMEOUT if no job id
+ *         became available in time, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_acquire_job_id_timed(
+    tapasco_devctx_t *dev_ctx, tapasco_job_id_t *j_id,
+    tapasco_kernel_id_t const k_id, uint64_t const timeout_ns);
+
 /**
  * Releases a job id obtained via @see tapasco_acquire_job_id. Does not affect
  * related handles alloc'ed via tapasco_alloc, which must be release separately,
@@ -340,6 +490,8 @@ void tapasco_device_release_job_id(tapasco_devctx_t *dev_ctx,
 /**
  * Launches the given job and releases its id (does not affect alloc'ed handles,
  * means only that kernel arguments can no longer be set using this id).
+ * If all PEs of the kernel are busy, the job is queued and dispatched as soon
+ * as one becomes available, i.e., nonblocking launches never wait for a PE.
  * @param dev_ctx device context
  * @param job_id job id
  * @param flags launch flags, e.g., TAPASCO_DEVICE_JOB_LAUNCH_BLOCKING
@@ -351,6 +503,30 @@ tapasco_device_job_launch(tapasco_devctx_t *dev_ctx,
                           tapasco_job_id_t const job_id,
                           tapasco_device_job_launch_flag_t const flags);
 
+/**
+ * Launches a batch of jobs in a single pass: transfers for all jobs are
+ * preloaded first, then a PE is acquired, programmed and started for each
+ * job in the order given. The job ids serve as completion handles, i.e., each
+ * job must be collected via @see tapasco_device_job_collect in nonblocking
+ * mode. If any job fails to launch, all jobs of the batch that were already
+ * started are collected before returning, so that none remains outstanding.
+ * Jobs that find no free PE are queued and started as soon as a PE of their
+ * kernel becomes available. Pipelined batches hand every job to the stager:
+ * jobs which fail to launch are failed, i.e., collecting them returns an
+ * error, and the error of the first one is returned.
+ * @param dev_ctx device context
+ * @param num_jobs number of job ids in job_ids
+ * @param job_ids array of job ids with arguments set
+ * @param flags launch flags, e.g., TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING
+ * @return TAPASCO_SUCCESS if all jobs were launched (and executed
+ *         successfully, if blocking), an error code otherwise
+ **/
+tapasco_res_t
+tapasco_device_job_launch_batch(tapasco_devctx_t *dev_ctx,
+                                size_t const num_jobs,
+                                tapasco_job_id_t const *job_ids,
+                                tapasco_device_job_launch_flag_t const flags);
+
 /**
  * Waits for the given job and returns after it has finished.
  * @param dev_ctx device context
@@ -361,6 +537,188 @@ tapasco_device_job_launch(tapasco_devctx_t *dev_ctx,
 tapasco_res_t tapasco_device_job_collect(tapasco_devctx_t *dev_ctx,
                                          tapasco_job_id_t const job_id);
 
+/**
+ * Waits at most timeout_ns nanoseconds for the given job. If the job has not
+ * finished by then, it keeps running: it can be collected again, or cancelled
+ * via @see tapasco_device_job_cancel. Timeouts are counted by the perfc
+ * counter jobs_timed_out.
+ * @param dev_ctx device context
+ * @param job_id job id
+ * @param timeout_ns max. time to wait in ns
+ * @return TAPASCO_SUCCESS, if execution finished successfully,
+ *         TAPASCO_ERR_TIMEOUT if the job is still running, an error code
+ *         otherwise.
+ **/
+tapasco_res_t tapasco_device_job_collect_timed(tapasco_devctx_t *dev_ctx,
+                                               tapasco_job_id_t const job_id,
+                                               uint64_t const timeout_ns);
+
+/**
+ * Cancels a launched job, e.g., after @see tapasco_device_job_collect_timed
+ * timed out: the job is aborted, collecting it returns
+ * TAPASCO_ERR_JOB_ABORTED, and its id must still be released. Jobs waiting for
+ * a PE or a CPU worker are dropped when they are taken from the queue. If the
+ * job is running on a PE, no data is copied back, and the PE is quarantined
+ * with its device buffers: it is not used again until the device is reset,
+ * i.e., closed and reopened. Its buffers are freed once a thread still
+ * collecting the job sees the PE finish, or else at the reset. Jobs running
+ * on the CPU finish, but their results are discarded. Jobs which finish
+ * concurrently are not affected. Threads blocked in an untimed collect of a
+ * job running on a PE are not woken up. Counted by the perfc counters
+ * jobs_cancelled and pe_quarantined.
+ * @param dev_ctx device context
+ * @param job_id job id
+ * @return TAPASCO_SUCCESS, if the job was cancelled or has already finished,
+ *         TAPASCO_ERR_JOB_ON_CQ for jobs attached to a completion queue,
+ *         TAPASCO_ERR_NOT_IMPLEMENTED for jobs in a job graph, an error code
+ *         otherwise.
+ **/
+tapasco_res_t tapasco_device_job_cancel(tapasco_devctx_t *dev_ctx,
+                                        tapasco_job_id_t const job_id);
+
+/**
+ * Returns non-zero, if the given launched job has finished (or failed, or was
+ * cancelled), i.e., collecting it will not block; does not block itself.
+ * @param dev_ctx device context
+ * @param job_id job id
+ * @return non-zero, if job is ready to be collected
+ **/
+int tapasco_device_job_ready(tapasco_devctx_t *dev_ctx,
+                             tapasco_job_id_t const job_id);
+
+/**
+ * Waits until at least min_ready of the given launched jobs are ready to be
+ * collected, @see tapasco_device_job_ready, and returns all ready jobs; jobs
+ * are not collected. Waiting threads are woken up by the finish signals of
+ * the PEs, a min_ready of 1 waits for any job, a min_ready of 0 only queries
+ * the jobs. Jobs attached to a completion queue cannot be waited for.
+ * @param dev_ctx device context
+ * @param num_jobs number of jobs in job_ids
+ * @param job_ids job ids
+ * @param min_ready number of ready jobs to wait for (max. num_jobs)
+ * @param ready_ids output array for ready job ids (num_jobs elements)
+ * @param num_ready output parameter for the number of ready jobs
+ * @param timeout_ns max. time to wait in ns (TAPASCO_WAIT_FOREVER: no limit)
+ * @return TAPASCO_SUCCESS, if at least min_ready jobs are ready,
+ *         TAPASCO_ERR_TIMEOUT if fewer jobs were ready in time, an error code
+ *         otherwise.
+ **/
+tapasco_res_t tapasco_device_job_wait_some(
+    tapasco_devctx_t *dev_ctx, size_t const num_jobs,
+    tapasco_job_id_t const *job_ids, size_t const min_ready,
+    tapasco_job_id_t *ready_ids, size_t *num_ready, uint64_t const timeout_ns);
+
+/**
+ * Sets the priority class of a job. When all PEs of its kernel are busy, the
+ * next free PE is handed to the waiting job with the earliest deadline, then
+ * to waiting jobs of the highest class. Every TAPASCO_PEMGMT_AGING-th
+ * handover serves the classes in reverse order, so low priority work is not
+ * starved. Must be set before the job is launched.
+ * @param dev_ctx device context
+ * @param job_id job id
+ * @param prio priority class (default: TAPASCO_JOB_PRIORITY_NORMAL)
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t
+tapasco_device_job_set_priority(tapasco_devctx_t *dev_ctx,
+                                tapasco_job_id_t const job_id,
+                                tapasco_job_priority_t const prio);
+
+/**
+ * Sets a deadline for a job: while waiting for a PE, jobs with deadlines are
+ * served earliest deadline first and ahead of all priority classes. Jobs
+ * dispatched after their deadline are counted by the perfc counter
+ * deadline_misses. Must be set before the job is launched.
+ * @param dev_ctx device context
+ * @param job_id job id
+ * @param deadline_ns deadline in ns from now (0: no deadline)
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_job_set_deadline(tapasco_devctx_t *dev_ctx,
+                                              tapasco_job_id_t const job_id,
+                                              uint64_t const deadline_ns);
+
+/**
+ * Makes a job persistent, for kernels launched many times with the same
+ * argument layout: after it has been collected, the job keeps its arguments
+ * and can be launched again; only arguments set in between are written to
+ * the PE, if the job is relaunched on the PE it ran on last. Device buffers of
+ * transfers stay allocated between launches (except PE-local ones), data is
+ * still copied as requested by each transfer. Argument registers are not read
+ * back after a launch, @see tapasco_device_job_get_arg returns the values
+ * set. Must be called before the first launch; jobs in job graphs cannot be
+ * persistent. Device buffers are freed when the job id is released.
+ * @param dev_ctx device context
+ * @param job_id job id
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_job_set_persistent(tapasco_devctx_t *dev_ctx,
+                                                tapasco_job_id_t const job_id);
+
+/**
+ * Sets the completion polling budget of a job: when the job is collected,
+ * the interrupt status register of its PE is polled for up to budget_ns
+ * nanoseconds before the thread falls back to waiting for the interrupt.
+ * Lowers the completion latency of short jobs at the cost of a busy core.
+ * @param dev_ctx device context
+ * @param job_id job id
+ * @param budget_ns polling budget in ns (0: use budget of kernel)
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_job_set_poll_budget(tapasco_devctx_t *dev_ctx,
+                                                 tapasco_job_id_t const job_id,
+                                                 uint32_t const budget_ns);
+
+/**
+ * Creates a completion queue. Jobs attached to a completion queue via
+ * @see tapasco_device_job_set_cq are posted to it when they finish and can
+ * then be reaped in batches by a single thread via @see tapasco_device_cq_reap.
+ * @param dev_ctx device context
+ * @param cq output pointer for the completion queue
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_cq_create(tapasco_devctx_t *dev_ctx,
+                                       tapasco_cq_t **cq);
+
+/**
+ * Destroys a completion queue; no job may be attached to it anymore.
+ * @param dev_ctx device context
+ * @param cq completion queue
+ **/
+void tapasco_device_cq_destroy(tapasco_devctx_t *dev_ctx, tapasco_cq_t *cq);
+
+/**
+ * Attaches a job to a completion queue; must be called before launch. The
+ * job must be launched in nonblocking mode and cannot be collected via
+ * @see tapasco_device_job_collect, it is reaped from the queue instead.
+ * @param dev_ctx device context
+ * @param job_id job id
+ * @param cq completion queue
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_job_set_cq(tapasco_devctx_t *dev_ctx,
+                                        tapasco_job_id_t const job_id,
+                                        tapasco_cq_t *cq);
+
+/**
+ * Reaps finished jobs from a completion queue: Retrieves the results of up to
+ * max_jobs jobs and returns their ids. Afterwards return values and arguments
+ * can be read as usual; job ids must be released by the caller.
+ * @param dev_ctx device context
+ * @param cq completion queue
+ * @param max_jobs maximal number of jobs to reap
+ * @param job_ids output array of at least max_jobs elements
+ * @param num_jobs output: number of jobs reaped
+ * @param flags reap flags, e.g., TAPASCO_DEVICE_CQ_REAP_NONBLOCKING
+ * @return TAPASCO_SUCCESS if results of all reaped jobs could be retrieved,
+ *         an error code otherwise
+ **/
+tapasco_res_t tapasco_device_cq_reap(tapasco_devctx_t *dev_ctx,
+                                     tapasco_cq_t *cq, size_t const max_jobs,
+                                     tapasco_job_id_t *job_ids,
+                                     size_t *num_jobs,
+                                     tapasco_device_cq_reap_flag_t const flags);
+
 /**
  * Sets the arg_idx'th argument of kernel k_id to arg_value.
  * @param dev_ctx device context
@@ -396,6 +754,32 @@ tapasco_res_t tapasco_device_job_set_arg_transfer(
     tapasco_device_alloc_flag_t const flags,
     tapasco_copy_direction_flag_t const dir_flags);
 
+/**
+ * Connects two jobs of a job graph: the arg_idx'th argument of job_id receives
+ * the device buffer of the src_arg_idx'th argument of job src_job_id, which
+ * must have been set with @see tapasco_device_job_set_arg_transfer (use
+ * TAPASCO_COPY_DIRECTION_NONE for intermediates that are never copied to the
+ * host). The buffer stays in device memory and is freed when the producer and
+ * all of its consumers have finished.
+ * job_id is started automatically once all of its predecessors have finished,
+ * launching it only releases it for that; launch predecessors before
+ * collecting or blocking on their successors. Jobs with successors are
+ * completed by the runtime, collect them as usual. If a predecessor fails,
+ * its successors fail with TAPASCO_ERR_JOB_DISPATCH_FAILED.
+ * Neither job may have been launched yet.
+ * @param dev_ctx device context
+ * @param job_id consuming job id
+ * @param arg_idx argument number of consuming job
+ * @param src_job_id producing job id
+ * @param src_arg_idx argument number of producing job
+ * @return TAPASCO_SUCCESS if successful, an error code otherwise
+ **/
+tapasco_res_t tapasco_device_job_set_arg_from(tapasco_devctx_t *dev_ctx,
+                                              tapasco_job_id_t const job_id,
+                                              size_t arg_idx,
+                                              tapasco_job_id_t const src_job_id,
+                                              size_t src_arg_idx);
+
 /**
  * Gets the value of the arg_idx'th argument of kernel k_id.
  * @param dev_ctx device context
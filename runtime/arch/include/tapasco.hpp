@@ -42,12 +42,29 @@ extern "C" {
 #include <future>
 #include <iostream>
 #include <stdexcept>
+#include <tuple>
 #include <type_traits>
+#include <vector>
 
 using namespace std;
 
 namespace tapasco {
-using job_future = std::function<tapasco_res_t(void)>;
+/**
+ * Collects a launched job when called; carries the id of the job for
+ * Tapasco::ready and Tapasco::wait_some (0, if the launch has failed).
+ **/
+struct job_future : std::function<tapasco_res_t(void)> {
+  job_future() = default;
+  template <typename F, typename = typename enable_if<
+                            !is_same<typename decay<F>::type,
+                                     job_future>::value>::type>
+  job_future(F f, tapasco_job_id_t const j_id = 0)
+      : std::function<tapasco_res_t(void)>(f), j_id(j_id) {}
+  tapasco_job_id_t job_id() const noexcept { return j_id; }
+
+private:
+  tapasco_job_id_t j_id{0};
+};
 
 /**
  * Type annotation for TAPASCO launch argument pointers: output only, i.e., only
@@ -96,7 +113,9 @@ template <typename T> struct RetVal final {
 
 /**
  * Type annotation for Tapasco launch argument pointers: If possible, data
- * should be placed in PE-local memory (faster access).
+ * should be placed in PE-local memory (faster access). Data stays resident in
+ * the local memory after the job; later jobs on the same data prefer that PE
+ * and skip the copy, as long as the host data is unchanged.
  **/
 template <typename T> struct Local final {
   Local(T &value) : value(value) {
@@ -125,6 +144,59 @@ template <typename T> WrappedPointer<T> makeWrappedPointer(T *t, size_t sz) {
   return WrappedPointer<T>(t, sz);
 }
 
+/**
+ * Type annotation for Tapasco launch arguments: Allocates a device-resident
+ * buffer of sz bytes, which is neither copied to nor from the host. It can be
+ * handed on to later jobs of a job graph via From.
+ **/
+struct Scratch final {
+  Scratch(size_t sz) : sz(sz) {}
+  size_t sz;
+};
+
+/**
+ * Type annotation for Tapasco launch arguments: Argument receives the device
+ * buffer of argument arg_idx of the (prepared) job j_id; the job will not start
+ * before j_id has finished (see tapasco_device_job_set_arg_from).
+ **/
+struct From final {
+  From(tapasco_job_id_t j_id, size_t arg_idx) : j_id(j_id), arg_idx(arg_idx) {}
+  tapasco_job_id_t j_id;
+  size_t arg_idx;
+};
+
+/** Readback policy of a DeviceBuffer after a job has used it. **/
+enum class Readback {
+  /** copy back on the next host access (default) **/
+  Lazy,
+  /** copy back when the job is collected **/
+  Eager,
+  /** never copy back, e.g., read-only tables or device-only data **/
+  Never,
+};
+
+template <typename T> class DeviceBuffer;
+
+/**
+ * Launch arguments are kept by value until the job is collected; DeviceBuffers
+ * are move-only and kept by reference instead.
+ **/
+template <typename T> struct stored_arg {
+  using type = typename decay<T>::type;
+};
+template <typename T> struct stored_arg<DeviceBuffer<T> &> {
+  using type = DeviceBuffer<T> &;
+};
+
+/** @{ Compile-time index sequences to unpack argument tuples (C++11). **/
+template <size_t... Is> struct index_seq {};
+template <size_t N, size_t... Is>
+struct make_index_seq : make_index_seq<N - 1, N - 1, Is...> {};
+template <size_t... Is> struct make_index_seq<0, Is...> {
+  using type = index_seq<Is...>;
+};
+/** @} **/
+
 /**
  * C++ Wrapper class for TaPaSCo API. Currently wraps a single device.
  **/
@@ -219,7 +291,8 @@ struct Tapasco {
 
   template <typename R, typename... Targs>
   job_future launch(tapasco_kernel_id_t const k_id, RetVal<R> &ret,
-                    Targs... args) noexcept {
+                    Targs &&... args) noexcept {
+    using seq = typename make_index_seq<sizeof...(Targs)>::type;
     tapasco_job_id_t j_id{0};
     tapasco_res_t res{TAPASCO_SUCCESS};
     auto mkerr = [](tapasco_res_t r) { return [r]() { return r; }; };
@@ -233,13 +306,16 @@ struct Tapasco {
              devctx, j_id, TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING)) !=
         TAPASCO_SUCCESS)
       return mkerr(res);
-    return [this, j_id, &ret, &args...]() {
-      return collect<R, Targs...>(j_id, ret, args...);
-    };
+    tuple<typename stored_arg<Targs>::type...> a(forward<Targs>(args)...);
+    return {[this, j_id, &ret, a]() mutable {
+              return collect_tuple(j_id, ret, a, seq());
+            },
+            j_id};
   }
 
   template <typename... Targs>
-  job_future launch(tapasco_kernel_id_t const k_id, Targs... args) noexcept {
+  job_future launch(tapasco_kernel_id_t const k_id, Targs &&... args) noexcept {
+    using seq = typename make_index_seq<sizeof...(Targs)>::type;
     tapasco_job_id_t j_id{0};
     tapasco_res_t res{TAPASCO_SUCCESS};
     auto mkerr = [](tapasco_res_t r) { return [r]() { return r; }; };
@@ -253,8 +329,252 @@ struct Tapasco {
              devctx, j_id, TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING)) !=
         TAPASCO_SUCCESS)
       return mkerr(res);
-    return
-        [this, j_id, &args...]() { return collect<Targs...>(j_id, args...); };
+    tuple<typename stored_arg<Targs>::type...> a(forward<Targs>(args)...);
+    return {[this, j_id, a]() mutable { return collect_tuple(j_id, a, seq()); },
+            j_id};
+  }
+
+  /**
+   * Prepares a job of a job graph: Acquires a job id for kernel k_id and sets
+   * its arguments, but does not launch the job yet, so that jobs prepared later
+   * can refer to its arguments via From. Launch it with launch_prepared.
+   * @param j_id output parameter for the job id
+   * @param k_id kernel id
+   * @param args job arguments
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise.
+   **/
+  template <typename... Targs>
+  tapasco_res_t prepare(tapasco_job_id_t &j_id, tapasco_kernel_id_t const k_id,
+                        Targs &&... args) noexcept {
+    tapasco_res_t res{TAPASCO_SUCCESS};
+    if ((res = tapasco_device_acquire_job_id(
+             devctx, &j_id, k_id, TAPASCO_DEVICE_ACQUIRE_JOB_ID_BLOCKING)) !=
+        TAPASCO_SUCCESS)
+      return res;
+    if ((res = set_args(j_id, 0, args...)) != TAPASCO_SUCCESS) {
+      tapasco_device_release_job_id(devctx, j_id);
+      j_id = 0;
+    }
+    return res;
+  }
+
+  /**
+   * Launches a job set up by prepare. Successors of other jobs are started
+   * automatically once all their predecessors have finished. The arguments
+   * are the ones given to prepare; they are used to collect the results.
+   * @param j_id job id returned by prepare
+   * @param ret return value
+   * @param args job arguments as given to prepare
+   * @return future to collect the job
+   **/
+  template <typename R, typename... Targs>
+  job_future launch_prepared(tapasco_job_id_t const j_id, RetVal<R> &ret,
+                             Targs &&... args) noexcept {
+    using seq = typename make_index_seq<sizeof...(Targs)>::type;
+    tapasco_res_t res{TAPASCO_SUCCESS};
+    auto mkerr = [](tapasco_res_t r) { return [r]() { return r; }; };
+    if ((res = tapasco_device_job_launch(
+             devctx, j_id, TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING)) !=
+        TAPASCO_SUCCESS)
+      return mkerr(res);
+    tuple<typename stored_arg<Targs>::type...> a(forward<Targs>(args)...);
+    return {[this, j_id, &ret, a]() mutable {
+              return collect_tuple(j_id, ret, a, seq());
+            },
+            j_id};
+  }
+
+  template <typename... Targs>
+  job_future launch_prepared(tapasco_job_id_t const j_id,
+                             Targs &&... args) noexcept {
+    using seq = typename make_index_seq<sizeof...(Targs)>::type;
+    tapasco_res_t res{TAPASCO_SUCCESS};
+    auto mkerr = [](tapasco_res_t r) { return [r]() { return r; }; };
+    if ((res = tapasco_device_job_launch(
+             devctx, j_id, TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING)) !=
+        TAPASCO_SUCCESS)
+      return mkerr(res);
+    tuple<typename stored_arg<Targs>::type...> a(forward<Targs>(args)...);
+    return {[this, j_id, a]() mutable { return collect_tuple(j_id, a, seq()); },
+            j_id};
+  }
+
+  /**
+   * Makes a job set up by prepare persistent, so that it can be launched many
+   * times via relaunch; arguments can be changed between launches via update.
+   * @see tapasco_device_job_set_persistent
+   * @param j_id job id returned by prepare
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t set_persistent(tapasco_job_id_t const j_id) noexcept {
+    return tapasco_device_job_set_persistent(devctx, j_id);
+  }
+
+  /**
+   * Changes argument arg_idx of a persistent job for its next launch.
+   * @param j_id job id
+   * @param arg_idx argument index
+   * @param arg new argument, annotated like the arguments of prepare
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  template <typename T>
+  tapasco_res_t update(tapasco_job_id_t const j_id, size_t const arg_idx,
+                       T &&arg) noexcept {
+    return set_args(j_id, arg_idx, arg);
+  }
+
+  /**
+   * Launches a persistent job again.
+   * @param j_id job id
+   * @param flags launch flags (default: wait until the job has finished)
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t relaunch(tapasco_job_id_t const j_id,
+                         tapasco_device_job_launch_flag_t const flags =
+                             TAPASCO_DEVICE_JOB_LAUNCH_BLOCKING) noexcept {
+    return tapasco_device_job_launch(devctx, j_id, flags);
+  }
+
+  /**
+   * Launches a persistent job again and waits for its return value.
+   * @param j_id job id
+   * @param ret return value
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  template <typename R>
+  tapasco_res_t relaunch(tapasco_job_id_t const j_id, RetVal<R> &ret) noexcept {
+    tapasco_res_t res{TAPASCO_SUCCESS};
+    if ((res = tapasco_device_job_launch(
+             devctx, j_id, TAPASCO_DEVICE_JOB_LAUNCH_BLOCKING)) !=
+        TAPASCO_SUCCESS)
+      return res;
+    return tapasco_device_job_get_return(devctx, j_id, sizeof(ret.value),
+                                         &ret.value);
+  }
+
+  /**
+   * Releases a job which is not collected via a future, e.g., a persistent
+   * job, and frees its device buffers.
+   * @param j_id job id
+   **/
+  void release_job(tapasco_job_id_t const j_id) noexcept {
+    tapasco_device_release_job_id(devctx, j_id);
+  }
+
+  /**
+   * Launches a batch of jobs for kernel k_id in a single pass. Each element
+   * of args holds the arguments of one job; transfers of all jobs are preloaded
+   * before the PEs are started. Argument tuples are referenced by the returned
+   * futures and must stay alive until they are collected.
+   * @param k_id kernel id
+   * @param args argument tuples, one per job
+   * @return one job_future per job, in the order of args
+   **/
+  template <typename... Targs>
+  vector<job_future> launch_batch(tapasco_kernel_id_t const k_id,
+                                  vector<tuple<Targs...>> &args) noexcept {
+    using seq = typename make_index_seq<sizeof...(Targs)>::type;
+    vector<job_future> futures;
+    vector<tapasco_job_id_t> j_ids;
+    tapasco_res_t res{TAPASCO_SUCCESS};
+    auto mkerr = [](tapasco_res_t r) { return [r]() { return r; }; };
+    j_ids.reserve(args.size());
+    futures.reserve(args.size());
+    for (auto &a : args) {
+      tapasco_job_id_t j_id{0};
+      if ((res = tapasco_device_acquire_job_id(
+               devctx, &j_id, k_id, TAPASCO_DEVICE_ACQUIRE_JOB_ID_BLOCKING)) !=
+          TAPASCO_SUCCESS)
+        break;
+      j_ids.push_back(j_id);
+      if ((res = set_args_tuple(j_id, a, seq())) != TAPASCO_SUCCESS)
+        break;
+    }
+    if (res == TAPASCO_SUCCESS)
+      res = tapasco_device_job_launch_batch(
+          devctx, j_ids.size(), j_ids.data(),
+          TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING);
+    if (res != TAPASCO_SUCCESS) {
+      for (auto j_id : j_ids)
+        tapasco_device_release_job_id(devctx, j_id);
+      futures.assign(args.size(), mkerr(res));
+      return futures;
+    }
+    for (size_t i = 0; i < j_ids.size(); ++i) {
+      tapasco_job_id_t const j_id = j_ids[i];
+      tuple<Targs...> *a = &args[i];
+      futures.emplace_back(
+          [this, j_id, a]() { return collect_tuple(j_id, *a, seq()); }, j_id);
+    }
+    return futures;
+  }
+
+  /**
+   * Returns true, if calling the future will not block.
+   * @see tapasco_device_job_ready
+   **/
+  bool ready(job_future const &f) const noexcept {
+    return !f.job_id() || tapasco_device_job_ready(devctx, f.job_id());
+  }
+
+  /**
+   * Waits until at least min_ready of the futures can be called without
+   * blocking and returns the indices of all such futures; futures must not
+   * have been called yet. @see tapasco_device_job_wait_some
+   * @param fs futures of launched jobs
+   * @param min_ready number of futures to wait for (1: any, 0: do not wait)
+   * @param ready output parameter for the indices of ready futures in fs
+   * @param timeout_ns max. time to wait in ns
+   * @return TAPASCO_SUCCESS, if at least min_ready futures are ready,
+   *         TAPASCO_ERR_TIMEOUT if fewer were ready in time, an error code
+   *         otherwise.
+   **/
+  tapasco_res_t wait_some(vector<job_future> const &fs, size_t min_ready,
+                          vector<size_t> &ready,
+                          uint64_t const timeout_ns = TAPASCO_WAIT_FOREVER)
+      const noexcept {
+    vector<tapasco_job_id_t> j_ids, ready_ids;
+    size_t num_ready{0};
+    ready.clear();
+    j_ids.reserve(fs.size());
+    // failed launches are ready at once
+    for (size_t i = 0; i < fs.size(); ++i) {
+      if (fs[i].job_id())
+        j_ids.push_back(fs[i].job_id());
+      else
+        ready.push_back(i);
+    }
+    min_ready = min_ready > ready.size() ? min_ready - ready.size() : 0;
+    ready_ids.resize(j_ids.size());
+    tapasco_res_t const res = tapasco_device_job_wait_some(
+        devctx, j_ids.size(), j_ids.data(), min_ready, ready_ids.data(),
+        &num_ready, timeout_ns);
+    for (size_t r = 0; r < num_ready; ++r)
+      for (size_t i = 0; i < fs.size(); ++i)
+        if (fs[i].job_id() == ready_ids[r])
+          ready.push_back(i);
+    return res;
+  }
+
+  /**
+   * Waits until any of the futures can be called without blocking.
+   * @see wait_some
+   * @param fs futures of launched jobs
+   * @param idx output parameter for the index of a ready future in fs
+   * @param timeout_ns max. time to wait in ns
+   * @return TAPASCO_SUCCESS, if a future is ready, TAPASCO_ERR_TIMEOUT if none
+   *         was ready in time, an error code otherwise.
+   **/
+  tapasco_res_t wait_any(vector<job_future> const &fs, size_t &idx,
+                         uint64_t const timeout_ns = TAPASCO_WAIT_FOREVER)
+      const noexcept {
+    vector<size_t> ready;
+    if (fs.empty())
+      return TAPASCO_ERR_JOB_ID_NOT_FOUND;
+    tapasco_res_t const res = wait_some(fs, 1, ready, timeout_ns);
+    if (res == TAPASCO_SUCCESS)
+      idx = ready.front();
+    return res;
   }
 
   /**
@@ -283,29 +603,80 @@ struct Tapasco {
    * @param src source address
    * @param dst destination device handle
    * @param len number of bytes to copy
-   * @param flags flags for copy operation
+   * @param flags flags for copy operation (nonblocking: see below)
    * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
    **/
   tapasco_res_t copy_to(void const *src, tapasco_handle_t dst, size_t len,
                         tapasco_device_copy_flag_t const flags) const noexcept {
+    if (flags & TAPASCO_DEVICE_COPY_NONBLOCKING)
+      return TAPASCO_ERR_NONBLOCKING_MODE_NOT_SUPPORTED;
     return tapasco_device_copy_to(devctx, src, dst, len, flags);
   }
 
+  /**
+   * Starts a nonblocking copy from main memory to the FPGA device; src must
+   * remain valid until the copy has finished, @see copy_wait.
+   * @param src source address
+   * @param dst destination device handle
+   * @param len number of bytes to copy
+   * @param c_id output parameter for the copy id
+   * @return TAPASCO_SUCCESS if copy was scheduled, an error code otherwise
+   **/
+  tapasco_res_t copy_to(void const *src, tapasco_handle_t dst, size_t len,
+                        tapasco_copy_id_t &c_id) const noexcept {
+    return tapasco_device_copy_to(devctx, src, dst, len,
+                                  TAPASCO_DEVICE_COPY_NONBLOCKING, &c_id);
+  }
+
   /**
    * Copys memory from FPGA device memory to main memory.
    * @param src source device handle (prev. alloc'ed with tapasco_alloc)
    * @param dst destination address
    * @param len number of bytes to copy
-   * @param flags flags for copy operation, e.g.,
-   *TAPASCO_DEVICE_COPY_NONBLOCKING
+   * @param flags flags for copy operation (nonblocking: see below)
    * @return TAPASCO_SUCCESS if copy was successful, an error code otherwise
    **/
   tapasco_res_t copy_from(tapasco_handle_t src, void *dst, size_t len,
                           tapasco_device_copy_flag_t const flags) const
       noexcept {
+    if (flags & TAPASCO_DEVICE_COPY_NONBLOCKING)
+      return TAPASCO_ERR_NONBLOCKING_MODE_NOT_SUPPORTED;
     return tapasco_device_copy_from(devctx, src, dst, len, flags);
   }
 
+  /**
+   * Starts a nonblocking copy from FPGA device memory to main memory; dst is
+   * valid after the copy has finished, @see copy_wait.
+   * @param src source device handle
+   * @param dst destination address
+   * @param len number of bytes to copy
+   * @param c_id output parameter for the copy id
+   * @return TAPASCO_SUCCESS if copy was scheduled, an error code otherwise
+   **/
+  tapasco_res_t copy_from(tapasco_handle_t src, void *dst, size_t len,
+                          tapasco_copy_id_t &c_id) const noexcept {
+    return tapasco_device_copy_from(devctx, src, dst, len,
+                                    TAPASCO_DEVICE_COPY_NONBLOCKING, &c_id);
+  }
+
+  /**
+   * Returns true, if waiting for a nonblocking copy will not block.
+   * @see tapasco_device_copy_ready
+   **/
+  bool copy_ready(tapasco_copy_id_t const c_id) const noexcept {
+    return tapasco_device_copy_ready(devctx, c_id);
+  }
+
+  /**
+   * Waits until a nonblocking copy has finished and releases its id.
+   * @see tapasco_device_copy_wait
+   * @param c_id copy id
+   * @return result of the copy
+   **/
+  tapasco_res_t copy_wait(tapasco_copy_id_t const c_id) const noexcept {
+    return tapasco_device_copy_wait(devctx, c_id);
+  }
+
   /**
    * Returns the number of PEs of kernel k_id in the currently loaded bitstream.
    * @param k_id kernel id
@@ -316,6 +687,77 @@ struct Tapasco {
     return tapasco_device_kernel_pe_count(devctx, k_id);
   }
 
+  /**
+   * Sets the completion polling budget for all jobs of kernel k_id: collecting
+   * threads poll the PE for up to budget_ns before waiting for its interrupt.
+   * @param k_id kernel id
+   * @param budget_ns polling budget in ns (0: wait for interrupts only)
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t set_poll_budget(tapasco_kernel_id_t const k_id,
+                                uint32_t const budget_ns) noexcept {
+    return tapasco_device_kernel_set_poll_budget(devctx, k_id, budget_ns);
+  }
+
+  /**
+   * Registers a host implementation of kernel k_id, which runs jobs on the CPU
+   * if the kernel has no PEs, or if waiting for a PE would take longer.
+   * @see tapasco_device_kernel_set_cpu_fallback
+   * @param k_id kernel id
+   * @param fn host implementation (nullptr: remove)
+   * @param user_data passed on to fn
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t set_cpu_fallback(tapasco_kernel_id_t const k_id,
+                                 tapasco_cpu_kernel_t fn,
+                                 void *user_data = nullptr) noexcept {
+    return tapasco_device_kernel_set_cpu_fallback(devctx, k_id, fn, user_data);
+  }
+
+  /**
+   * Sets the share weight of this process for PEs of a shared device.
+   * @see tapasco_device_set_share
+   * @param weight share weight (1 - 10000, default: 100)
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t set_share(uint32_t const weight) noexcept {
+    return tapasco_device_set_share(devctx, weight);
+  }
+
+  /**
+   * Returns the share weight of this process and the PE time it consumed.
+   * @see tapasco_device_get_share
+   * @param weight share weight (out)
+   * @param pe_ns PE time consumed in ns (out)
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t get_share(uint32_t &weight, uint64_t &pe_ns) noexcept {
+    return tapasco_device_get_share(devctx, &weight, &pe_ns);
+  }
+
+  /**
+   * Sets the watermarks of the device buffer pool for transfers.
+   * @see tapasco_device_set_buffer_pool
+   * @param low_watermark idle bytes kept after trimming
+   * @param high_watermark max. idle bytes, 0 disables the pool
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t set_buffer_pool(size_t const low_watermark,
+                                size_t const high_watermark) noexcept {
+    return tapasco_device_set_buffer_pool(devctx, low_watermark,
+                                          high_watermark);
+  }
+
+  /**
+   * Returns the statistics of the device buffer pool for transfers.
+   * @see tapasco_device_buffer_pool_stats
+   * @param stats statistics (out)
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t buffer_pool_stats(tapasco_buffer_pool_stats_t &stats) noexcept {
+    return tapasco_device_buffer_pool_stats(devctx, &stats);
+  }
+
   /**
    * Checks if the current bitstream supports a given capability.
    * @param cap capability to check
@@ -357,6 +799,20 @@ private:
     tapasco_device_release_job_id(devctx, j_id);
     return res;
   }
+  /** Unpacks an argument tuple of a batched job into collect. */
+  template <typename... Targs, size_t... Is>
+  tapasco_res_t collect_tuple(const tapasco_job_id_t j_id,
+                              tuple<Targs...> &args,
+                              index_seq<Is...>) noexcept {
+    return collect<Targs...>(j_id, get<Is>(args)...);
+  }
+  /** Unpacks the argument tuple of a launched job into collect (w/return). */
+  template <typename R, typename... Targs, size_t... Is>
+  tapasco_res_t collect_tuple(const tapasco_job_id_t j_id, RetVal<R> &ret,
+                              tuple<Targs...> &args,
+                              index_seq<Is...>) noexcept {
+    return collect<R, Targs...>(j_id, ret, get<Is>(args)...);
+  }
   /* Collector methods: bottom half of job launch. @} */
 
   /* @{ Setters for register values */
@@ -426,6 +882,32 @@ private:
                                                t.value, flags, copy_flags);
   }
 
+  /** Sets a device-resident buffer argument (alloc only, no copies). **/
+  tapasco_res_t set_arg(tapasco_job_id_t const j_id, size_t const arg_idx,
+                        Scratch t) noexcept {
+    return tapasco_device_job_set_arg_transfer(
+        devctx, j_id, arg_idx, t.sz, nullptr, TAPASCO_DEVICE_ALLOC_FLAGS_NONE,
+        TAPASCO_COPY_DIRECTION_NONE);
+  }
+
+  /** Sets an argument to the device buffer of a predecessor job. **/
+  tapasco_res_t set_arg(tapasco_job_id_t const j_id, size_t const arg_idx,
+                        From t) noexcept {
+    return tapasco_device_job_set_arg_from(devctx, j_id, arg_idx, t.j_id,
+                                           t.arg_idx);
+  }
+
+  /** Sets a device buffer argument; uploads the host copy if it changed. **/
+  template <typename T>
+  tapasco_res_t set_arg(tapasco_job_id_t const j_id, size_t const arg_idx,
+                        DeviceBuffer<T> &t) noexcept {
+    tapasco_res_t res{TAPASCO_SUCCESS};
+    if ((res = t.upload()) != TAPASCO_SUCCESS)
+      return res;
+    tapasco_handle_t const h{t.handle()};
+    return tapasco_device_job_set_arg(devctx, j_id, arg_idx, sizeof(h), &h);
+  }
+
   template <typename T>
   tapasco_res_t set_args(tapasco_job_id_t const j_id, size_t arg_idx,
                          T &t) noexcept {
@@ -435,12 +917,20 @@ private:
   /** Variadic: recursively sets all given arguments. **/
   template <typename T, typename... Targs>
   tapasco_res_t set_args(tapasco_job_id_t const j_id, size_t arg_idx, T &t,
-                         Targs... args) noexcept {
+                         Targs &... args) noexcept {
     tapasco_res_t r;
     if ((r = set_arg(j_id, arg_idx, t)) != TAPASCO_SUCCESS)
       return r;
     return set_args(j_id, arg_idx + 1, args...);
   }
+
+  /** Unpacks an argument tuple of a batched job into set_args. **/
+  template <typename... Targs, size_t... Is>
+  tapasco_res_t set_args_tuple(tapasco_job_id_t const j_id,
+                               tuple<Targs...> &args,
+                               index_seq<Is...>) noexcept {
+    return set_args(j_id, 0, get<Is>(args)...);
+  }
   /* Setters for register values @} */
 
   /* @{ Getters for register values */
@@ -462,6 +952,13 @@ private:
     return TAPASCO_SUCCESS;
   }
 
+  /** Reads a device buffer back, or marks it for readback on host access. **/
+  template <typename T>
+  tapasco_res_t get_arg(tapasco_job_id_t const j_id, size_t const arg_idx,
+                        DeviceBuffer<T> &t) noexcept {
+    return t.finished();
+  }
+
   template <typename T>
   tapasco_res_t get_args(tapasco_job_id_t const j_id, size_t const arg_idx,
                          T &t) noexcept {
@@ -471,7 +968,7 @@ private:
   /** Variadic: recursively gets all given arguments. **/
   template <typename T, typename... Targs>
   tapasco_res_t get_args(tapasco_job_id_t const j_id, size_t const arg_idx,
-                         T &t, Targs... args) noexcept {
+                         T &t, Targs &... args) noexcept {
     tapasco_res_t r;
     if ((r = get_arg(j_id, arg_idx, t)) != TAPASCO_SUCCESS)
       return r;
@@ -484,6 +981,163 @@ private:
   tapasco_devctx_t *devctx{nullptr};
 };
 
+/**
+ * Device memory buffer with a host copy of count elements of type T, which can
+ * be passed to Tapasco::launch directly (as a device address). The host copy
+ * is uploaded at launch only if it has changed since the last upload, so
+ * large inputs shared by many jobs (e.g., read-only tables of an iterative
+ * algorithm) are copied only once. After a job has been collected, the device
+ * data is read back according to the Readback policy. Non-const accessors
+ * mark the host copy as changed; pointers obtained from them must not be used
+ * to change the host copy after the next launch. The host copy must not be
+ * accessed while jobs using the buffer are running.
+ **/
+template <typename T> class DeviceBuffer final {
+public:
+  /**
+   * Allocates a buffer of count elements on the device of tapasco.
+   * @param tapasco device to allocate on
+   * @param count number of elements
+   * @param readback readback policy after jobs (default: Lazy)
+   * @throws Tapasco::tapasco_error, if the allocation failed
+   **/
+  DeviceBuffer(Tapasco &tapasco, size_t const count,
+               Readback const readback = Readback::Lazy)
+      : devctx(tapasco.device()), host(count), readback(readback) {
+    static_assert(is_trivially_copyable<T>::value,
+                  "Types must be trivially copyable!");
+    tapasco_res_t const r =
+        count ? tapasco_device_alloc(devctx, &h, bytes(),
+                                     TAPASCO_DEVICE_ALLOC_FLAGS_NONE)
+              : TAPASCO_SUCCESS;
+    if (r != TAPASCO_SUCCESS)
+      throw Tapasco::tapasco_error(r);
+  }
+
+  /**
+   * Allocates a buffer on the device of tapasco and initializes its host copy
+   * with count elements from data.
+   * @throws Tapasco::tapasco_error, if the allocation failed
+   **/
+  DeviceBuffer(Tapasco &tapasco, T const *data, size_t const count,
+               Readback const readback = Readback::Lazy)
+      : DeviceBuffer(tapasco, count, readback) {
+    copy(data, data + count, host.begin());
+  }
+
+  DeviceBuffer(DeviceBuffer const &) = delete;
+  DeviceBuffer &operator=(DeviceBuffer const &) = delete;
+
+  DeviceBuffer(DeviceBuffer &&other) noexcept
+      : devctx(other.devctx), h(other.h), host(move(other.host)),
+        readback(other.readback), _dirty(other._dirty), stale(other.stale) {
+    other.devctx = nullptr;
+    other.host.clear();
+  }
+
+  DeviceBuffer &operator=(DeviceBuffer &&other) noexcept {
+    if (this != &other) {
+      release();
+      devctx = other.devctx;
+      h = other.h;
+      host = move(other.host);
+      readback = other.readback;
+      _dirty = other._dirty;
+      stale = other.stale;
+      other.devctx = nullptr;
+      other.host.clear();
+    }
+    return *this;
+  }
+
+  /** Destructor. Frees the device memory. **/
+  ~DeviceBuffer() { release(); }
+
+  size_t size() const noexcept { return host.size(); }
+  size_t bytes() const noexcept { return host.size() * sizeof(T); }
+  tapasco_handle_t handle() const noexcept { return h; }
+
+  /** @{ Host copy access; reads the device data back first, if necessary. **/
+  T const *data() const {
+    check(fetch());
+    return host.data();
+  }
+  T *data() {
+    check(fetch());
+    _dirty = true;
+    return host.data();
+  }
+  T const &operator[](size_t const i) const { return data()[i]; }
+  T &operator[](size_t const i) { return data()[i]; }
+  /** @} **/
+
+  /** Marks the host copy as changed, e.g., after writes via old pointers. **/
+  void mark_dirty() noexcept { _dirty = true; }
+  /** Returns true, if the host copy will be uploaded at the next launch. **/
+  bool dirty() const noexcept { return _dirty; }
+
+  Readback readback_policy() const noexcept { return readback; }
+  void set_readback_policy(Readback const r) noexcept { readback = r; }
+
+  /**
+   * Copies the host copy to the device, if it has changed.
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t upload() noexcept {
+    if (!_dirty || host.empty())
+      return TAPASCO_SUCCESS;
+    tapasco_res_t const r = tapasco_device_copy_to(
+        devctx, host.data(), h, bytes(), TAPASCO_DEVICE_COPY_BLOCKING);
+    if (r == TAPASCO_SUCCESS)
+      _dirty = false;
+    return r;
+  }
+
+  /**
+   * Copies the device data back to the host copy, if a job has used the
+   * buffer since the last readback.
+   * @return TAPASCO_SUCCESS if successful, an error code otherwise
+   **/
+  tapasco_res_t fetch() const noexcept {
+    if (!stale)
+      return TAPASCO_SUCCESS;
+    tapasco_res_t const r = tapasco_device_copy_from(
+        devctx, h, host.data(), bytes(), TAPASCO_DEVICE_COPY_BLOCKING);
+    if (r == TAPASCO_SUCCESS)
+      stale = false;
+    return r;
+  }
+
+private:
+  friend struct Tapasco;
+
+  /** Called by Tapasco::collect after a job using the buffer has finished. **/
+  tapasco_res_t finished() noexcept {
+    if (readback == Readback::Never || host.empty())
+      return TAPASCO_SUCCESS;
+    stale = true;
+    return readback == Readback::Eager ? fetch() : TAPASCO_SUCCESS;
+  }
+
+  static void check(tapasco_res_t const r) {
+    if (r != TAPASCO_SUCCESS)
+      throw Tapasco::tapasco_error(r);
+  }
+
+  void release() noexcept {
+    if (devctx && !host.empty())
+      tapasco_device_free(devctx, h, bytes(), TAPASCO_DEVICE_ALLOC_FLAGS_NONE);
+    devctx = nullptr;
+  }
+
+  tapasco_devctx_t *devctx{nullptr};
+  tapasco_handle_t h{0};
+  mutable vector<T> host;
+  Readback readback;
+  bool _dirty{true};
+  mutable bool stale{false};
+};
+
 } /* namespace tapasco */
 
 #endif /* TAPASCO_HPP__ */
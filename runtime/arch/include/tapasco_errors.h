@@ -51,7 +51,18 @@
   _X(TAPASCO_ERR_PTHREAD_ERROR, -17,                                           \
      "pthread error, see previous error message in log")                       \
   _X(TAPASCO_ERR_INVALID_SLOT_ID, -18, "received invalid slot id")             \
-  _X(TAPASCO_ERR_SENTINEL, -19, "--- no error just end of list ---")
+  _X(TAPASCO_ERR_JOB_ON_CQ, -19,                                               \
+     "job is attached to a completion queue, reap it instead")                 \
+  _X(TAPASCO_ERR_JOB_DISPATCH_FAILED, -20,                                     \
+     "job could not be dispatched to a PE, see previous error in log")         \
+  _X(TAPASCO_ERR_KERNEL_NOT_FOUND, -21,                                        \
+     "kernel is not instantiated in the bitstream")                            \
+  _X(TAPASCO_ERR_TIMEOUT, -22, "operation timed out")                          \
+  _X(TAPASCO_ERR_INVALID_PRIORITY, -23, "invalid job priority")                \
+  _X(TAPASCO_ERR_JOB_ABORTED, -24, "job was cancelled")                        \
+  _X(TAPASCO_ERR_COPY_ID_NOT_FOUND, -25, "copy id not found")                  \
+  _X(TAPASCO_ERR_INVALID_ARG, -26, "invalid argument")                         \
+  _X(TAPASCO_ERR_SENTINEL, -27, "--- no error just end of list ---")
 
 #ifdef _X
 #undef _X
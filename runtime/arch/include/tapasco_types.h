@@ -48,6 +48,9 @@ typedef struct tapasco_ctx tapasco_ctx_t;
 /** Device context; opaque forward decl. **/
 typedef struct tapasco_devctx tapasco_devctx_t;
 
+/** Completion queue for finished jobs; opaque forward decl. **/
+typedef struct tapasco_cq tapasco_cq_t;
+
 /** Unique identifier for FPGA device (currently only one). **/
 typedef platform_dev_id_t tapasco_dev_id_t;
 
@@ -65,6 +68,13 @@ typedef ul tapasco_job_id_t;
 typedef uint64_t tapasco_handle_t;
 #define PRIhandle "%#08lx"
 
+/** Identifies nonblocking copies, @see tapasco_device_copy_wait. **/
+typedef ul tapasco_copy_id_t;
+#define PRIcopy "%lu"
+
+/** Timeout to wait without limit, e.g., for tapasco_device_job_wait_some. **/
+#define TAPASCO_WAIT_FOREVER UINT64_MAX
+
 /** default value for no flags **/
 #define NONE 0
 
@@ -96,7 +106,8 @@ typedef enum {
   TAPASCO_DEVICE_COPY_FLAGS_NONE = NONE,
   /** wait until transfer is finished (default) **/
   TAPASCO_DEVICE_COPY_BLOCKING = NONE,
-  /** return immediately after transfer was scheduled **/
+  /** return immediately after transfer was scheduled; takes a trailing
+   *  tapasco_copy_id_t * argument receiving the id of the copy **/
   TAPASCO_DEVICE_COPY_NONBLOCKING = 1,
   /** copy to local memory **/
   TAPASCO_DEVICE_COPY_PE_LOCAL = PE_LOCAL_FLAG
@@ -120,10 +131,60 @@ typedef enum {
   TAPASCO_DEVICE_JOB_LAUNCH_BLOCKING = NONE,
   /** return immediately after job is scheduled **/
   TAPASCO_DEVICE_JOB_LAUNCH_NONBLOCKING = 1,
+  /** return immediately, stage inputs in the background while previous jobs
+   *  are running (implies nonblocking) **/
+  TAPASCO_DEVICE_JOB_LAUNCH_PIPELINED = 2,
 } tapasco_device_job_launch_flag_t;
 
+/** Priority classes of jobs waiting for a PE. **/
+typedef enum {
+  /** latency-critical jobs, served first **/
+  TAPASCO_JOB_PRIORITY_HIGH = 0,
+  /** default **/
+  TAPASCO_JOB_PRIORITY_NORMAL,
+  /** bulk work, served last **/
+  TAPASCO_JOB_PRIORITY_LOW,
+  /** number of priority classes **/
+  TAPASCO_JOB_PRIORITIES
+} tapasco_job_priority_t;
+
+/**
+ * Host implementation of a kernel, @see tapasco_device_kernel_set_cpu_fallback:
+ * receives the argument values of a job, with the host pointers of transfers
+ * in place of device handles, and returns the return value of the job in ret.
+ * Transfers which are not copied back from the device are passed as pointers
+ * to temporary copies of their host data.
+ **/
+typedef tapasco_res_t (*tapasco_cpu_kernel_t)(size_t const num_args,
+                                              uint64_t const *args,
+                                              uint64_t *ret, void *user_data);
+
+/** Statistics of the device buffer pool for transfers. **/
+typedef struct {
+  /** current watermarks in bytes **/
+  size_t low_watermark, high_watermark;
+  /** bytes and number of idle buffers in the pool **/
+  size_t idle_bytes, idle_buffers;
+  /** transfer buffers taken from the pool / allocated on the device **/
+  uint64_t hits, misses;
+  /** idle buffers freed to stay below the high watermark **/
+  uint64_t trimmed;
+} tapasco_buffer_pool_stats_t;
+
+/** Flags for calls to tapasco_device_cq_reap. **/
+typedef enum {
+  /** no flags **/
+  TAPASCO_DEVICE_CQ_REAP_FLAGS_NONE = NONE,
+  /** wait until at least one job has finished (default) **/
+  TAPASCO_DEVICE_CQ_REAP_BLOCKING = NONE,
+  /** return immediately, even if no job has finished **/
+  TAPASCO_DEVICE_CQ_REAP_NONBLOCKING = 1,
+} tapasco_device_cq_reap_flag_t;
+
 /** Flags for memory transfer directions. **/
 typedef enum {
+  /** Allocate only, data stays on the device (job graph intermediates). */
+  TAPASCO_COPY_DIRECTION_NONE = 0,
   /** Copy to the device before launch. */
   TAPASCO_COPY_DIRECTION_TO = 1,
   /** Allocate and copy from the device after launch. */
@@ -19,6 +19,9 @@
 //! @file	gen_fixed_size_pool.h
 //! @brief	Generic, header-only, lock-free implementation of a fixed size
 //!		pool of things based on statically allocated array.
+//!		Free elements are kept in an index-linked free list, whose head
+//!		is tagged with a modification counter to avoid ABA problems;
+//!		elements can be taken and returned in batches with a single CAS.
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
 #ifndef __GEN_FIXED_SIZE_POOL_H__
@@ -37,55 +40,90 @@
 #define assert(...)
 #endif
 
+#include <stddef.h>
 #include <stdint.h>
 
 /** Index type: external id of pool element. */
 typedef uint32_t fsp_idx_t;
 #define INVALID_IDX ((fsp_idx_t)(-1))
 
+/** Free list head: modification tag in upper, index in lower 32 bits. */
+#define FSP_HEAD(tag, idx) (((uint64_t)(tag) << 32) | (fsp_idx_t)(idx))
+#define FSP_HEAD_TAG(h) ((uint32_t)((h) >> 32))
+#define FSP_HEAD_IDX(h) ((fsp_idx_t)(h))
+
 // define a pool: PRE = prefix, SZ = size, T = type, IF = initializer function
 #define MAKE_FIXED_SIZE_POOL(PRE, SZ, T, IF)                                   \
   struct PRE##_fsp_t {                                                         \
     T elems[SZ];                                                               \
-    int locked[SZ];                                                            \
     int refcnt[SZ];                                                            \
-    fsp_idx_t curr;                                                            \
+    fsp_idx_t next[SZ];                                                        \
+    uint64_t head;                                                             \
   };                                                                           \
                                                                                \
   static inline void PRE##_fsp_init(struct PRE##_fsp_t *fsp) {                 \
     int i;                                                                     \
     memset(fsp, 0, sizeof(*fsp));                                              \
     for (i = 0; i < SZ; ++i) {                                                 \
-      __atomic_clear(&fsp->locked[i], __ATOMIC_SEQ_CST);                       \
+      fsp->next[i] = i + 1 < SZ ? (fsp_idx_t)(i + 1) : INVALID_IDX;            \
       IF(&fsp->elems[i], i);                                                   \
     }                                                                          \
+    __atomic_store_n(&fsp->head, FSP_HEAD(0, SZ ? 0 : INVALID_IDX),            \
+                     __ATOMIC_SEQ_CST);                                        \
   }                                                                            \
                                                                                \
-  static inline fsp_idx_t PRE##_fsp_get(struct PRE##_fsp_t *fsp) {             \
-    fsp_idx_t ret;                                                             \
+  /* takes up to n free elements, returns number of elements taken */          \
+  static inline size_t PRE##_fsp_get_n(struct PRE##_fsp_t *fsp,                \
+                                       fsp_idx_t *idx, size_t const n) {       \
+    uint64_t old = __atomic_load_n(&fsp->head, __ATOMIC_ACQUIRE), nu;          \
+    size_t cnt;                                                                \
     do {                                                                       \
-      ret = __atomic_fetch_add(&fsp->curr, 1, __ATOMIC_SEQ_CST);               \
-    } while (ret < SZ &&                                                       \
-             __atomic_test_and_set(&fsp->locked[ret], __ATOMIC_SEQ_CST));      \
-    if (ret < SZ) {                                                            \
-      assert(__atomic_add_fetch(&fsp->refcnt[ret], 1, __ATOMIC_SEQ_CST) < 2);  \
-      return ret;                                                              \
+      fsp_idx_t i = FSP_HEAD_IDX(old);                                         \
+      /* links may be stale, but then the CAS on the tagged head fails */      \
+      for (cnt = 0; cnt < n && i != INVALID_IDX; ++cnt) {                      \
+        idx[cnt] = i;                                                          \
+        i = __atomic_load_n(&fsp->next[i], __ATOMIC_RELAXED);                  \
+      }                                                                        \
+      if (!cnt)                                                                \
+        return 0;                                                              \
+      nu = FSP_HEAD(FSP_HEAD_TAG(old) + 1, i);                                 \
+    } while (!__atomic_compare_exchange_n(                                     \
+        &fsp->head, &old, nu, 1, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));         \
+    for (size_t j = 0; j < cnt; ++j)                                           \
+      assert(__atomic_add_fetch(&fsp->refcnt[idx[j]], 1, __ATOMIC_SEQ_CST) <   \
+             2);                                                               \
+    return cnt;                                                                \
+  }                                                                            \
+                                                                               \
+  /* returns n previously taken elements */                                    \
+  static inline void PRE##_fsp_put_n(struct PRE##_fsp_t *fsp,                  \
+                                     fsp_idx_t const *idx, size_t const n) {   \
+    uint64_t old = __atomic_load_n(&fsp->head, __ATOMIC_RELAXED), nu;          \
+    if (!n)                                                                    \
+      return;                                                                  \
+    for (size_t j = 0; j < n; ++j) {                                           \
+      assert(idx[j] < SZ);                                                     \
+      __atomic_sub_fetch(&fsp->refcnt[idx[j]], 1, __ATOMIC_SEQ_CST);           \
+      if (j + 1 < n)                                                           \
+        __atomic_store_n(&fsp->next[idx[j]], idx[j + 1], __ATOMIC_RELAXED);    \
     }                                                                          \
-    return INVALID_IDX;                                                        \
+    do {                                                                       \
+      __atomic_store_n(&fsp->next[idx[n - 1]], FSP_HEAD_IDX(old),              \
+                       __ATOMIC_RELAXED);                                      \
+      nu = FSP_HEAD(FSP_HEAD_TAG(old) + 1, idx[0]);                            \
+    } while (!__atomic_compare_exchange_n(                                     \
+        &fsp->head, &old, nu, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));         \
+  }                                                                            \
+                                                                               \
+  static inline fsp_idx_t PRE##_fsp_get(struct PRE##_fsp_t *fsp) {             \
+    fsp_idx_t ret;                                                             \
+    return PRE##_fsp_get_n(fsp, &ret, 1) ? ret : INVALID_IDX;                  \
   }                                                                            \
                                                                                \
   static inline void PRE##_fsp_put(struct PRE##_fsp_t *fsp,                    \
                                    fsp_idx_t const idx) {                      \
-    if (idx < SZ) {                                                            \
-      fsp_idx_t old;                                                           \
-      __atomic_sub_fetch(&fsp->refcnt[idx], 1, __ATOMIC_SEQ_CST);              \
-      __atomic_clear(&fsp->locked[idx], __ATOMIC_SEQ_CST);                     \
-      do {                                                                     \
-        old = fsp->curr;                                                       \
-      } while (idx < old && !__atomic_compare_exchange(&fsp->curr, &old, &idx, \
-                                                       0, __ATOMIC_SEQ_CST,    \
-                                                       __ATOMIC_SEQ_CST));     \
-    }                                                                          \
+    if (idx < SZ)                                                              \
+      PRE##_fsp_put_n(fsp, &idx, 1);                                           \
   }
 
 #endif /* __GEN_FIXED_SIZE_POOL_H__ */
@@ -17,10 +17,12 @@
 // along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
 //
 //! @file	gen_mem.h
-//! @brief	Generic, header-only memory management library. Can manage
-//!             address spaces with arbitrary size and base. Extremely light-
-//!             weight and simplistic, should not be used for applications with
-//!             frequent and short-lived allocations.
+//! @brief	Generic memory management library. Can manage address spaces
+//!             with arbitrary size and base. Uses a two-level segregated fit
+//!             (TLSF) allocator: allocation and coalescing free take constant
+//!             time, independent of the number of blocks and fragmentation.
+//!             Block descriptors are kept out-of-band in host memory, the
+//!             managed address space is never accessed. Not thread-safe.
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
 #ifndef GEN_MEM_H__
@@ -33,20 +35,24 @@ typedef uint32_t addr_t;
 
 #define INVALID_ADDRESS ((addr_t)(-1))
 
-typedef struct block {
-  addr_t base;
-  size_t range;
-  struct block *next;
-} block_t;
+/** Alignment and granularity of allocations in bytes. **/
+#define GEN_MEM_ALIGNMENT 64
 
-extern block_t *gen_mem_create(addr_t const base, size_t const range);
+/** Allocator for an address space; opaque. **/
+typedef struct gen_mem gen_mem_t;
 
-extern void gen_mem_destroy(block_t **root);
+extern gen_mem_t *gen_mem_create(addr_t const base, size_t const range);
 
-extern addr_t gen_mem_malloc(block_t **root, size_t const length);
+extern void gen_mem_destroy(gen_mem_t **root);
 
-extern addr_t gen_mem_next_base(block_t *root);
+extern addr_t gen_mem_malloc(gen_mem_t **root, size_t const length);
 
-extern void gen_mem_free(block_t **root, addr_t const p, size_t const length);
+/** Returns the lowest free address, INVALID_ADDRESS if none (linear time). **/
+extern addr_t gen_mem_next_base(gen_mem_t *root);
+
+/** Returns the number of free bytes (possibly fragmented). **/
+extern size_t gen_mem_available(gen_mem_t *root);
+
+extern void gen_mem_free(gen_mem_t **root, addr_t const p, size_t const length);
 
 #endif /* GEN_MEM_H__ */
@@ -16,11 +16,12 @@
 // You should have received a copy of the GNU Lesser General Public License
 // along with Tapasco.  If not, see <http://www.gnu.org/licenses/>.
 //
-//! @file	gen_mem.h
-//! @brief	Generic, header-only memory management library. Can manage
-//!             address spaces with arbitrary size and base. Extremely light-
-//!             weight and simplistic, should not be used for applications with
-//!             frequent and short-lived allocations.
+//! @file	gen_mem.c
+//! @brief	Two-level segregated fit (TLSF) allocator for generic address
+//!             spaces: free blocks are kept in lists by size class, the first
+//!             level by power of two, the second level subdivides it linearly;
+//!             bitmaps locate a non-empty list of sufficient size in O(1).
+//!             Allocated blocks are found by address in a hash table.
 //! @authors	J. Korinth, TU Darmstadt (jk@esa.cs.tu-darmstadt.de)
 //!
 #include "gen_mem.h"
@@ -35,142 +36,293 @@
 #define GEN_MEM_LOG(...)
 #endif
 
-#define GEN_MEM_ALIGNMENT 64
+/** log2 of second level subdivisions per power of two. **/
+#define GEN_MEM_SL_LOG2 4
+#define GEN_MEM_SL_COUNT (1 << GEN_MEM_SL_LOG2)
+/** sizes below are kept in first level 0 with a granularity of alignment. **/
+#define GEN_MEM_FL_SHIFT (6 + GEN_MEM_SL_LOG2)
+#define GEN_MEM_SMALL_BLOCK ((size_t)1 << GEN_MEM_FL_SHIFT)
+#define GEN_MEM_FL_COUNT (64 - GEN_MEM_FL_SHIFT + 1)
+/** initial log2 of hash buckets for allocated blocks. **/
+#define GEN_MEM_HASH_LOG2 6
 
-int roundUp(int numToRound, int multiple) {
-  assert(multiple && ((multiple & (multiple - 1)) == 0));
-  return (numToRound + multiple - 1) & -multiple;
+#if (1 << GEN_MEM_FL_SHIFT) / GEN_MEM_SL_COUNT != GEN_MEM_ALIGNMENT
+#error "small size classes must match GEN_MEM_ALIGNMENT"
+#endif
+
+/* Contiguous range of the address space, either free or allocated. */
+struct gen_mem_block {
+  addr_t base;
+  size_t size;
+  int free;
+  struct gen_mem_block *prev_phys; // adjacent block below
+  struct gen_mem_block *next_phys; // adjacent block above
+  struct gen_mem_block *prev_free; // free list of size class
+  struct gen_mem_block *next_free; // free list, or hash chain if allocated
+};
+typedef struct gen_mem_block gen_mem_block_t;
+
+struct gen_mem {
+  size_t avail;
+  uint64_t fl_map;                   // bit set: first level has free blocks
+  uint32_t sl_map[GEN_MEM_FL_COUNT]; // bit set: list has free blocks
+  gen_mem_block_t *blocks[GEN_MEM_FL_COUNT][GEN_MEM_SL_COUNT];
+  gen_mem_block_t *first; // block at base address, never merged away
+  gen_mem_block_t *spare; // unused descriptors
+  gen_mem_block_t **used; // hash table of allocated blocks by base
+  unsigned used_log2;
+  size_t num_used;
+};
+
+static inline size_t round_up(size_t const n) {
+  return (n + GEN_MEM_ALIGNMENT - 1) & ~(size_t)(GEN_MEM_ALIGNMENT - 1);
 }
 
-void print_chain(block_t *root) {
-  block_t *cur = root;
-  GEN_MEM_LOG("CHAIN ");
-  while (cur != NULL) {
-    GEN_MEM_LOG("%X (%zdB) -> ", cur->base, cur->range);
-    cur = cur->next;
+static inline int fls_sz(size_t const n) {
+  return 63 - __builtin_clzll((unsigned long long)n);
+}
+
+/* Computes the size class of a block of the given size. */
+static inline void mapping(size_t const size, int *fl, int *sl) {
+  if (size < GEN_MEM_SMALL_BLOCK) {
+    *fl = 0;
+    *sl = (int)(size / GEN_MEM_ALIGNMENT);
+  } else {
+    int const f = fls_sz(size);
+    *sl = (int)(size >> (f - GEN_MEM_SL_LOG2)) ^ GEN_MEM_SL_COUNT;
+    *fl = f - (GEN_MEM_FL_SHIFT - 1);
   }
-  GEN_MEM_LOG("NULL\n");
 }
 
-block_t *gen_mem_create(addr_t const base, size_t const range) {
-  assert(base % sizeof(addr_t) == 0 ||
-         "base address in gen_mem_create must be aligned with word size");
-  assert(range % sizeof(addr_t) == 0 ||
-         "range in gen_mem_create must be aligned with word size");
-  block_t *b = (block_t *)malloc(sizeof(*b));
-  assert(b || "gen_mem_create ran out of memory!");
-  if (!b)
-    return b;
-  b->base = base;
-  b->range = range;
-  b->next = NULL;
-  return b;
+static void insert_free(gen_mem_t *m, gen_mem_block_t *b) {
+  int fl, sl;
+  mapping(b->size, &fl, &sl);
+  b->free = 1;
+  b->prev_free = NULL;
+  b->next_free = m->blocks[fl][sl];
+  if (b->next_free)
+    b->next_free->prev_free = b;
+  m->blocks[fl][sl] = b;
+  m->sl_map[fl] |= 1U << sl;
+  m->fl_map |= 1ULL << fl;
 }
 
-void gen_mem_destroy(block_t **root) {
-  block_t *cur = *root;
-  while (cur != NULL) {
-    block_t *nxt = cur->next;
-    free(cur);
-    cur = nxt;
+static void remove_free(gen_mem_t *m, gen_mem_block_t *b) {
+  int fl, sl;
+  mapping(b->size, &fl, &sl);
+  if (b->prev_free)
+    b->prev_free->next_free = b->next_free;
+  else
+    m->blocks[fl][sl] = b->next_free;
+  if (b->next_free)
+    b->next_free->prev_free = b->prev_free;
+  if (!m->blocks[fl][sl]) {
+    m->sl_map[fl] &= ~(1U << sl);
+    if (!m->sl_map[fl])
+      m->fl_map &= ~(1ULL << fl);
   }
-  *root = NULL;
+  b->free = 0;
 }
 
-addr_t gen_mem_next_base(block_t *root) {
-  assert(root || "argument to gen_mem_next_base may not be NULL");
-  block_t *nxt = root;
-  while (nxt != NULL && nxt->range == 0) {
-    nxt = nxt->next;
+/* Returns a free block of at least size bytes, NULL if there is none. */
+static gen_mem_block_t *find_free(gen_mem_t *m, size_t size) {
+  int fl, sl;
+  // round up to the next size class, all of its blocks are large enough
+  if (size >= GEN_MEM_SMALL_BLOCK)
+    size += ((size_t)1 << (fls_sz(size) - GEN_MEM_SL_LOG2)) - 1;
+  mapping(size, &fl, &sl);
+  if (fl >= GEN_MEM_FL_COUNT)
+    return NULL;
+  uint32_t sl_map = m->sl_map[fl] & (~0U << sl);
+  if (!sl_map) {
+    uint64_t const fl_map =
+        fl + 1 < GEN_MEM_FL_COUNT ? m->fl_map & (~0ULL << (fl + 1)) : 0;
+    if (!fl_map)
+      return NULL;
+    fl = __builtin_ctzll(fl_map);
+    sl_map = m->sl_map[fl];
   }
-  if (!nxt)
-    return INVALID_ADDRESS;
-  return nxt->base;
-}
-
-addr_t gen_mem_malloc(block_t **root, size_t const l) {
-  assert(root || "argument to gen_mem_malloc may not be NULL");
-  assert(l > 0 || "length must be > 0");
-  print_chain(*root);
-  size_t const length = roundUp(l, GEN_MEM_ALIGNMENT);
-  block_t *prv = *root, *nxt = *root;
-  while (prv != NULL && prv->range < length) {
-    prv = nxt;
-    nxt = nxt->next;
+  return m->blocks[fl][__builtin_ctz(sl_map)];
+}
+
+static gen_mem_block_t *new_block(gen_mem_t *m) {
+  gen_mem_block_t *b = m->spare;
+  if (b)
+    m->spare = b->next_free;
+  else
+    b = (gen_mem_block_t *)malloc(sizeof(*b));
+  return b;
+}
+
+static inline void put_block(gen_mem_t *m, gen_mem_block_t *b) {
+  b->next_free = m->spare;
+  m->spare = b;
+}
+
+static inline size_t hash(gen_mem_t const *m, addr_t const p) {
+  return (uint32_t)((p / GEN_MEM_ALIGNMENT) * 2654435761U) >>
+         (32 - m->used_log2);
+}
+
+/* Doubles the hash table; keeps the old one, if out of memory. */
+static void grow_used(gen_mem_t *m) {
+  size_t const n = (size_t)1 << m->used_log2;
+  gen_mem_block_t **old = m->used;
+  gen_mem_block_t **used =
+      (gen_mem_block_t **)calloc(2 * n, sizeof(*m->used));
+  if (!used)
+    return;
+  m->used = used;
+  ++m->used_log2;
+  for (size_t i = 0; i < n; ++i) {
+    gen_mem_block_t *b = old[i];
+    while (b) {
+      gen_mem_block_t *nxt = b->next_free;
+      size_t const h = hash(m, b->base);
+      b->next_free = used[h];
+      used[h] = b;
+      b = nxt;
+    }
   }
-  if (!prv)
-    return INVALID_ADDRESS;
-  if (prv->next == NULL) {
-    block_t *nb = (block_t *)malloc(sizeof(*nb));
-    nxt = nb;
-    prv->next = nb;
-    nb->base = prv->base + length;
-    nb->range = prv->range - length;
-    nb->next = NULL;
+  free(old);
+}
+
+static void insert_used(gen_mem_t *m, gen_mem_block_t *b) {
+  if (++m->num_used > ((size_t)1 << m->used_log2) && m->used_log2 < 32)
+    grow_used(m);
+  size_t const h = hash(m, b->base);
+  b->next_free = m->used[h];
+  m->used[h] = b;
+}
+
+static gen_mem_block_t *remove_used(gen_mem_t *m, addr_t const p) {
+  gen_mem_block_t **b = &m->used[hash(m, p)];
+  while (*b && (*b)->base != p)
+    b = &(*b)->next_free;
+  gen_mem_block_t *r = *b;
+  if (r) {
+    *b = r->next_free;
+    --m->num_used;
   }
-  addr_t const base = prv->base;
-  prv->range = 0;
-  GEN_MEM_LOG("alloc'ed 0x%08lx - 0x%08lx\n", (unsigned long)base,
-              base + length);
-  if (nxt->range == 0 && nxt->next != NULL && nxt != *root) {
-    prv->next = nxt->next;
-    free(nxt);
+  return r;
+}
+
+gen_mem_t *gen_mem_create(addr_t const base, size_t const range) {
+  assert(base % sizeof(addr_t) == 0 &&
+         "base address in gen_mem_create must be aligned with word size");
+  gen_mem_t *m = (gen_mem_t *)calloc(1, sizeof(*m));
+  if (!m)
+    return m;
+  m->used_log2 = GEN_MEM_HASH_LOG2;
+  m->used = (gen_mem_block_t **)calloc((size_t)1 << m->used_log2,
+                                       sizeof(*m->used));
+  m->first = new_block(m);
+  if (!m->used || !m->first) {
+    free(m->first);
+    free(m->used);
+    free(m);
+    return NULL;
   }
-  print_chain(*root);
-  return base;
+  m->first->base = base;
+  m->first->size = range & ~(size_t)(GEN_MEM_ALIGNMENT - 1);
+  m->first->prev_phys = NULL;
+  m->first->next_phys = NULL;
+  if (m->first->size)
+    insert_free(m, m->first);
+  m->avail = m->first->size;
+  return m;
 }
 
-void gen_mem_free(block_t **root, addr_t const p, size_t const l) {
-  assert(root || "argument to gen_mem_free may not be NULL");
-  GEN_MEM_LOG("freeing 0x%08lx - 0x%08lx\n", (unsigned long)p,
-              p + roundUp(l, GEN_MEM_ALIGNMENT));
-  if (l == 0) {
-    GEN_MEM_LOG("Can't free empty range\n");
+void gen_mem_destroy(gen_mem_t **root) {
+  gen_mem_t *m = *root;
+  if (!m)
     return;
+  gen_mem_block_t *b = m->first;
+  while (b) {
+    gen_mem_block_t *nxt = b->next_phys;
+    free(b);
+    b = nxt;
   }
-  block_t *prv = *root, *nxt = *root;
-  while (nxt != NULL && nxt->base + nxt->range <= p) {
-    prv = nxt;
-    nxt = nxt->next;
+  while ((b = m->spare)) {
+    m->spare = b->next_free;
+    free(b);
   }
-  print_chain(*root);
-  GEN_MEM_LOG("prv: 0x%08lx - 0x%08lx\n", (unsigned long)prv->base,
-              prv->base + prv->range);
-  GEN_MEM_LOG("nxt: 0x%08lx - 0x%08lx\n", (unsigned long)nxt->base,
-              nxt->base + nxt->range);
-  size_t const length = roundUp(l, GEN_MEM_ALIGNMENT);
-  if (prv->base + prv->range == p) {
-    prv->range += length;
-    if (prv->next && (prv->base + prv->range == prv->next->base)) {
-      block_t *del = prv->next;
-      prv->range += del->range;
-      prv->next = del->next;
-      free(del);
-    }
-    GEN_MEM_LOG("merging prv\n");
-    print_chain(*root);
-    return;
+  free(m->used);
+  free(m);
+  *root = NULL;
+}
+
+addr_t gen_mem_next_base(gen_mem_t *root) {
+  assert(root && "argument to gen_mem_next_base may not be NULL");
+  gen_mem_block_t *b = root->first;
+  while (b && !(b->free && b->size))
+    b = b->next_phys;
+  return b ? b->base : INVALID_ADDRESS;
+}
+
+size_t gen_mem_available(gen_mem_t *root) {
+  assert(root && "argument to gen_mem_available may not be NULL");
+  return root->avail;
+}
+
+addr_t gen_mem_malloc(gen_mem_t **root, size_t const l) {
+  assert(root && "argument to gen_mem_malloc may not be NULL");
+  gen_mem_t *m = *root;
+  size_t const length = round_up(l ? l : 1);
+  gen_mem_block_t *b = find_free(m, length);
+  if (!b)
+    return INVALID_ADDRESS;
+  remove_free(m, b);
+  // split off the remainder; without a descriptor, the block is used whole
+  gen_mem_block_t *r = b->size > length ? new_block(m) : NULL;
+  if (r) {
+    r->base = b->base + length;
+    r->size = b->size - length;
+    r->prev_phys = b;
+    r->next_phys = b->next_phys;
+    if (r->next_phys)
+      r->next_phys->prev_phys = r;
+    b->next_phys = r;
+    b->size = length;
+    insert_free(m, r);
   }
-  if (nxt != NULL && p + length == nxt->base) {
-    nxt->base -= length;
-    nxt->range += length;
-    GEN_MEM_LOG("merging nxt\n");
-    print_chain(*root);
+  insert_used(m, b);
+  m->avail -= b->size;
+  GEN_MEM_LOG("alloc'ed 0x%08lx - 0x%08lx\n", (unsigned long)b->base,
+              (unsigned long)b->base + b->size);
+  return b->base;
+}
+
+void gen_mem_free(gen_mem_t **root, addr_t const p, size_t const l) {
+  assert(root && "argument to gen_mem_free may not be NULL");
+  gen_mem_t *m = *root;
+  gen_mem_block_t *b = remove_used(m, p);
+  if (!b) {
+    GEN_MEM_LOG("0x%08lx was not allocated\n", (unsigned long)p);
     return;
   }
-  GEN_MEM_LOG("inserting new\n");
-  block_t *nb = (block_t *)malloc(sizeof(*nb));
-  assert(nb || "gen_mem_create ran out of memory!");
-  nb->base = p;
-  nb->range = length;
-  if (p + length < prv->base) {
-    GEN_MEM_LOG("inserting before\n");
-    nb->next = prv;
-    *root = *root == prv ? nb : *root;
-  } else {
-    GEN_MEM_LOG("inserting after\n");
-    nb->next = prv->next;
-    prv->next = nb;
+  assert(round_up(l) <= b->size && "length exceeds allocated block");
+  GEN_MEM_LOG("freeing 0x%08lx - 0x%08lx\n", (unsigned long)p,
+              (unsigned long)p + b->size);
+  m->avail += b->size;
+  gen_mem_block_t *n = b->next_phys;
+  if (n && n->free) {
+    remove_free(m, n);
+    b->size += n->size;
+    b->next_phys = n->next_phys;
+    if (b->next_phys)
+      b->next_phys->prev_phys = b;
+    put_block(m, n);
+  }
+  gen_mem_block_t *pv = b->prev_phys;
+  if (pv && pv->free) {
+    remove_free(m, pv);
+    pv->size += b->size;
+    pv->next_phys = b->next_phys;
+    if (pv->next_phys)
+      pv->next_phys->prev_phys = pv;
+    put_block(m, b);
+    b = pv;
   }
-  print_chain(*root);
-}
\ No newline at end of file
+  insert_free(m, b);
+}
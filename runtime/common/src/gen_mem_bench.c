@@ -0,0 +1,165 @@
+/**
+ *  @file	gen_mem_bench.c
+ *  @brief	Latency benchmark for gen_mem: replays an allocation trace on a
+ *              4 GiB address space and reports alloc/free latencies per
+ *              phase. Without arguments, a synthetic trace mimics TaPaSCo
+ *              applications: long-lived buffers (e.g., weights, tables) and
+ *              many short-lived job buffers of 4 KiB - 64 MiB, freed in
+ *              varying order, so that the address space fragments over time.
+ *              Alternatively, a trace file is replayed, one op per line:
+ *                a <id> <size>   allocate <size> bytes as buffer <id>
+ *                f <id>          free buffer <id>
+ *  @author	Embedded Systems and Applications Group, TU Darmstadt
+ **/
+#include "gen_mem.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MEM_SZ ((size_t)1 << 32)
+#define MAX_IDS 65536
+#define PHASES 8
+#define SYNTH_OPS 2000000
+#define LONG_LIVED 256
+#define MAX_LIVE 320
+
+typedef struct {
+  char op;
+  uint32_t id;
+  size_t sz;
+} trace_op_t;
+
+typedef struct {
+  uint64_t *ns;
+  size_t n;
+} lat_t;
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int cmp_u64(void const *a, void const *b) {
+  uint64_t const x = *(uint64_t const *)a, y = *(uint64_t const *)b;
+  return (x > y) - (x < y);
+}
+
+static void report(char const *name, lat_t *l) {
+  if (!l->n) {
+    printf("  %-5s %9s\n", name, "-");
+    return;
+  }
+  qsort(l->ns, l->n, sizeof(*l->ns), cmp_u64);
+  printf("  %-5s %9zu ops  p50 %6" PRIu64 " ns  p99 %6" PRIu64
+         " ns  max %8" PRIu64 " ns\n",
+         name, l->n, l->ns[l->n / 2], l->ns[l->n * 99 / 100],
+         l->ns[l->n - 1]);
+}
+
+/* Job buffer sizes are mostly powers of two, some with odd lengths. */
+static size_t job_size(void) {
+  size_t const sz = (size_t)4096 << (rand() % 15);
+  return rand() % 4 ? sz : sz + (size_t)(rand() % sz) - sz / 2;
+}
+
+static size_t synth_trace(trace_op_t *ops) {
+  static uint32_t live[MAX_LIVE];
+  size_t n = 0, num_live = 0;
+  uint32_t next_id = 0;
+  for (uint32_t i = 0; i < LONG_LIVED; ++i) {
+    ops[n++] = (trace_op_t){'a', next_id++, (size_t)1 << (12 + rand() % 12)};
+  }
+  while (n < SYNTH_OPS) {
+    // job buffers come in bursts, most are freed after a few other jobs
+    if (num_live < MAX_LIVE && (!num_live || rand() % 100 < 52)) {
+      uint32_t const id = LONG_LIVED + (next_id++ % (MAX_IDS - LONG_LIVED));
+      live[num_live++] = id;
+      ops[n++] = (trace_op_t){'a', id, job_size()};
+    } else {
+      size_t const recent = num_live < 8 ? num_live : 8;
+      size_t const i =
+          rand() % 3 ? num_live - 1 - rand() % recent : rand() % num_live;
+      ops[n++] = (trace_op_t){'f', live[i], 0};
+      live[i] = live[--num_live];
+    }
+  }
+  return n;
+}
+
+static size_t read_trace(char const *fn, trace_op_t *ops, size_t max) {
+  FILE *fp = fopen(fn, "r");
+  if (!fp) {
+    perror(fn);
+    exit(EXIT_FAILURE);
+  }
+  size_t n = 0;
+  char op;
+  unsigned id;
+  size_t sz;
+  char line[256];
+  while (n < max && fgets(line, sizeof(line), fp)) {
+    sz = 0;
+    if (sscanf(line, " %c %u %zu", &op, &id, &sz) < 2 || id >= MAX_IDS ||
+        (op != 'a' && op != 'f') || (op == 'a' && !sz))
+      continue;
+    ops[n++] = (trace_op_t){op, id, sz};
+  }
+  fclose(fp);
+  return n;
+}
+
+int main(int argc, char *argv[]) {
+  size_t const max_ops = argc > 1 ? 100000000 : SYNTH_OPS;
+  trace_op_t *ops = (trace_op_t *)malloc(max_ops * sizeof(*ops));
+  addr_t *base = (addr_t *)malloc(MAX_IDS * sizeof(*base));
+  size_t *len = (size_t *)calloc(MAX_IDS, sizeof(*len));
+  lat_t al = {(uint64_t *)malloc(max_ops * sizeof(uint64_t)), 0};
+  lat_t fr = {(uint64_t *)malloc(max_ops * sizeof(uint64_t)), 0};
+  if (!ops || !base || !len || !al.ns || !fr.ns) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+  srand(42);
+  size_t const num_ops =
+      argc > 1 ? read_trace(argv[1], ops, max_ops) : synth_trace(ops);
+  printf("replaying %zu operations on %zu MiB\n", num_ops, MEM_SZ >> 20);
+
+  gen_mem_t *mem = gen_mem_create(0, MEM_SZ);
+  size_t failed = 0, phase_end = 0;
+  for (size_t p = 0, i = 0; p < PHASES; ++p) {
+    phase_end += num_ops / PHASES + (p < num_ops % PHASES);
+    al.n = fr.n = 0;
+    for (; i < phase_end; ++i) {
+      trace_op_t const *o = &ops[i];
+      if (o->op == 'a') {
+        if (len[o->id]) // trace reuses a live id, free it first
+          gen_mem_free(&mem, base[o->id], len[o->id]);
+        uint64_t const t = now_ns();
+        base[o->id] = gen_mem_malloc(&mem, o->sz);
+        al.ns[al.n++] = now_ns() - t;
+        len[o->id] = base[o->id] != INVALID_ADDRESS ? o->sz : 0;
+        failed += !len[o->id];
+      } else if (len[o->id]) {
+        uint64_t const t = now_ns();
+        gen_mem_free(&mem, base[o->id], len[o->id]);
+        fr.ns[fr.n++] = now_ns() - t;
+        len[o->id] = 0;
+      }
+    }
+    printf("phase %zu: %zu MiB free\n", p, gen_mem_available(mem) >> 20);
+    report("alloc", &al);
+    report("free", &fr);
+  }
+  printf("%zu allocations failed\n", failed);
+  gen_mem_destroy(&mem);
+  free(fr.ns);
+  free(al.ns);
+  free(len);
+  free(base);
+  free(ops);
+  return EXIT_SUCCESS;
+}
+/* vim: set foldmarker=@{,@} foldlevel=0 foldmethod=marker : */
@@ -14,34 +14,43 @@
 #define MAX_ALLOCS 100000
 #define MAX_SIZE (1024 * 1024)
 
-void print_block(block_t *b) {
-  if (b) {
-    printf("block @ 0x%x - 0x%x\n", (b->base), (addr_t)(b->base + b->range));
-    print_block(b->next);
-  } else
-    printf("\n");
+typedef struct {
+  addr_t base;
+  size_t range;
+} alloc_t;
+
+static size_t used(size_t const range) {
+  return (range + GEN_MEM_ALIGNMENT - 1) & ~(size_t)(GEN_MEM_ALIGNMENT - 1);
+}
+
+void check_free(gen_mem_t *mem, size_t const expected) {
+  if (gen_mem_available(mem) != expected) {
+    fprintf(stderr, "ERROR: %zd bytes available, expected %zd!\n",
+            gen_mem_available(mem), expected);
+    exit(1);
+  }
 }
 
-inline static size_t allocate(block_t **mem, block_t allocs[MAX_ALLOCS]) {
+inline static size_t allocate(gen_mem_t **mem, alloc_t allocs[MAX_ALLOCS]) {
   size_t idx = rand() % MAX_ALLOCS;
   while (allocs[idx].range != 0)
     idx = (idx + 1) % MAX_ALLOCS;
-  allocs[idx].range = rand() % MAX_SIZE;
+  allocs[idx].range = rand() % MAX_SIZE + 1;
   allocs[idx].base = gen_mem_malloc(mem, allocs[idx].range);
+  if (allocs[idx].base == INVALID_ADDRESS)
+    allocs[idx].range = 0;
   return idx;
 }
 
-inline static size_t deallocate(block_t **mem, block_t allocs[MAX_ALLOCS]) {
+inline static size_t deallocate(gen_mem_t **mem, alloc_t allocs[MAX_ALLOCS]) {
   size_t idx = rand() % MAX_ALLOCS;
   while (allocs[idx].range == 0)
     idx = (idx + 1) % MAX_ALLOCS;
   gen_mem_free(mem, allocs[idx].base, allocs[idx].range);
-  allocs[idx].range = 0;
-  allocs[idx].base = 0;
   return idx;
 }
 
-inline static void clean(block_t **mem, block_t allocs[MAX_ALLOCS]) {
+inline static void clean(gen_mem_t **mem, alloc_t allocs[MAX_ALLOCS]) {
   for (size_t idx = 0; idx < MAX_ALLOCS; ++idx) {
     if (allocs[idx].range != 0) {
       gen_mem_free(mem, allocs[idx].base, allocs[idx].range);
@@ -50,109 +59,87 @@ inline static void clean(block_t **mem, block_t allocs[MAX_ALLOCS]) {
 }
 
 void merge_nxt() {
-  srand(time(NULL));
   printf("merge_nxt:\n");
-  block_t *mem = gen_mem_create(0, 0x1000);
+  gen_mem_t *mem = gen_mem_create(0, 0x1000);
   addr_t a = gen_mem_malloc(&mem, 16);
   addr_t b = gen_mem_malloc(&mem, 16);
   addr_t c = gen_mem_malloc(&mem, 16);
   addr_t d = gen_mem_malloc(&mem, 16);
+  check_free(mem, 0x1000 - 4 * GEN_MEM_ALIGNMENT);
 
   printf("freeing b\n");
   gen_mem_free(&mem, b, 16);
-  print_block(mem);
-
   printf("freeing d\n");
   gen_mem_free(&mem, d, 16);
-  print_block(mem);
-
   printf("freeing a\n");
   gen_mem_free(&mem, a, 16);
-  print_block(mem);
-
   printf("freeing c\n");
   gen_mem_free(&mem, c, 16);
-  print_block(mem);
 
-  assert(mem->next == NULL || "expected single block after all frees");
-  free(mem);
+  check_free(mem, 0x1000);
+  addr_t const all = gen_mem_malloc(&mem, 0x1000);
+  assert(all == 0 && "expected single block after all frees");
+  gen_mem_free(&mem, all, 0x1000);
+  gen_mem_destroy(&mem);
 }
 
 void merge_prv() {
-  srand(time(NULL));
   printf("merge_prv:\n");
-  block_t *mem = gen_mem_create(0, 0x1000);
+  gen_mem_t *mem = gen_mem_create(0, 0x1000);
   addr_t a = gen_mem_malloc(&mem, 16);
   addr_t b = gen_mem_malloc(&mem, 16);
   addr_t c = gen_mem_malloc(&mem, 16);
   addr_t d = gen_mem_malloc(&mem, 16);
-  print_block(mem);
 
   printf("freeing c\n");
   gen_mem_free(&mem, c, 16);
-  print_block(mem);
-
   printf("freeing a\n");
   gen_mem_free(&mem, a, 16);
-  print_block(mem);
-
   printf("freeing d\n");
   gen_mem_free(&mem, d, 16);
-  print_block(mem);
-
   printf("freeing b\n");
   gen_mem_free(&mem, b, 16);
-  print_block(mem);
 
-  assert(mem->next == NULL || "expected single block after all frees");
-  free(mem);
+  check_free(mem, 0x1000);
+  addr_t const all = gen_mem_malloc(&mem, 0x1000);
+  assert(all == 0 && "expected single block after all frees");
+  gen_mem_free(&mem, all, 0x1000);
+  gen_mem_destroy(&mem);
 }
 
 void malloc_corners() {
-  srand(time(NULL));
   printf("malloc_corners:\n");
-  block_t *mem = gen_mem_create(0, 32);
+  gen_mem_t *mem = gen_mem_create(0, 2 * GEN_MEM_ALIGNMENT);
   addr_t a = gen_mem_malloc(&mem, 16);
   addr_t b = gen_mem_malloc(&mem, 16);
-  assert(a != INVALID_ADDRESS || "a must not be invalid");
-  assert(b != INVALID_ADDRESS || "b must not be invalid");
-  print_block(mem);
+  addr_t const c = gen_mem_malloc(&mem, 16);
+  (void)c;
+  assert(a != INVALID_ADDRESS && "a must not be invalid");
+  assert(b != INVALID_ADDRESS && "b must not be invalid");
+  assert(c == INVALID_ADDRESS && "memory must be exhausted");
+  assert(gen_mem_next_base(mem) == INVALID_ADDRESS && "expected no base");
 
   printf("freeing b\n");
   gen_mem_free(&mem, b, 16);
-  print_block(mem);
+  assert(gen_mem_next_base(mem) == b && "expected b as next base");
 
   b = gen_mem_malloc(&mem, 16);
   printf("freeing b, a\n");
   gen_mem_free(&mem, b, 16);
   gen_mem_free(&mem, a, 16);
-  print_block(mem);
 
-  assert(mem->next == NULL || "expected single block after all frees");
-  free(mem);
-}
-
-void check_blocks(block_t *mem) {
-  assert(mem || "check_blocks argument must not be NULL");
-  block_t *prv = mem, *nxt = mem->next;
-  while (nxt && prv->base + prv->range < nxt->base) {
-    prv = nxt;
-    nxt = nxt->next;
-  }
-  if (nxt) {
-    fprintf(stderr, "ERROR: block list is invalid!\n");
-    print_block(mem);
-    exit(1);
-  }
+  check_free(mem, 2 * GEN_MEM_ALIGNMENT);
+  gen_mem_destroy(&mem);
 }
 
 void stress_test() {
   srand(time(NULL));
-  block_t *mem = gen_mem_create(0, 1 << 31);
+  size_t const range = (size_t)1 << 31;
+  gen_mem_t *mem = gen_mem_create(0, range);
   struct timeval tv_start, tv_now;
   gettimeofday(&tv_start, NULL);
 
-  block_t allocs[MAX_ALLOCS];
+  static alloc_t allocs[MAX_ALLOCS];
   memset(allocs, 0, sizeof(allocs));
   size_t total_alloc = 0;
   size_t curr_alloc = 0;
@@ -160,22 +147,26 @@ void stress_test() {
 
   do {
     if (!curr_alloc || (curr_alloc < MAX_ALLOCS && rand() % 2)) {
-      // printf("allocating (%zd / %zd)\n", curr_alloc, total_alloc);
-      curr_sz += allocs[allocate(&mem, allocs)].range;
-      ++curr_alloc;
-      ++total_alloc;
+      size_t const idx = allocate(&mem, allocs);
+      if (allocs[idx].range) {
+        curr_sz += used(allocs[idx].range);
+        ++curr_alloc;
+        ++total_alloc;
+      }
     } else {
-      // printf("deallocating (%zd / %zd)\n", curr_alloc, total_alloc);
-      curr_sz -= allocs[deallocate(&mem, allocs)].range;
+      size_t const idx = deallocate(&mem, allocs);
+      curr_sz -= used(allocs[idx].range);
+      allocs[idx].range = 0;
+      allocs[idx].base = 0;
       --curr_alloc;
     }
-    check_blocks(mem);
+    check_free(mem, range - curr_sz);
     gettimeofday(&tv_now, NULL);
   } while (tv_now.tv_sec - tv_start.tv_sec < 30);
   clean(&mem, allocs);
   printf("finished after %zd allocations.\n", total_alloc);
-  print_block(mem);
-  free(mem);
+  check_free(mem, range);
+  gen_mem_destroy(&mem);
 }
 
 int main() {
@@ -0,0 +1,256 @@
+#include <linux/capability.h>
+#include <linux/errno.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/string.h>
+#include <linux/version.h>
+#if LINUX_VERSION_CODE < KERNEL_VERSION(4, 11, 0)
+#include <linux/sched.h>
+#else
+#include <linux/sched/signal.h>
+#endif
+#include "tlkm_arbiter.h"
+#include "tlkm_control.h"
+#include "tlkm_logging.h"
+
+/* Acquire request of a thread waiting for a PE. */
+struct tlkm_pe_request {
+	struct list_head node;
+	struct tlkm_control_file *f;
+	u32 kernel_id;
+	s32 slot_id; /* granted slot, -1 while waiting */
+};
+
+void tlkm_arbiter_init(struct tlkm_arbiter *arb)
+{
+	mutex_init(&arb->mtx);
+	init_waitqueue_head(&arb->granted_q);
+	memset(arb->owner, 0, sizeof(arb->owner));
+	memset(arb->granted_at, 0, sizeof(arb->granted_at));
+	INIT_LIST_HEAD(&arb->requests);
+	INIT_LIST_HEAD(&arb->tenants);
+	arb->vclock = 0;
+}
+
+void tlkm_arbiter_add(struct tlkm_arbiter *arb, struct tlkm_control_file *f)
+{
+	struct tlkm_tenant *t = &f->tenant;
+	t->pid = task_tgid_nr(current);
+	t->weight = TLKM_ARBITER_WEIGHT;
+	t->pe_ns = 0;
+	t->held = 0;
+	t->waiting = 0;
+	mutex_lock(&arb->mtx);
+	t->vtime = arb->vclock;
+	list_add_tail(&t->node, &arb->tenants);
+	mutex_unlock(&arb->mtx);
+}
+
+static int has_kernel(u32 const *pe_kernel, u32 kernel_id)
+{
+	int s;
+	for (s = 0; s < PLATFORM_NUM_SLOTS; ++s)
+		if (pe_kernel[s] == kernel_id)
+			return 1;
+	return 0;
+}
+
+static int is_waiting(struct tlkm_arbiter *arb, u32 kernel_id)
+{
+	struct tlkm_pe_request *r;
+	list_for_each_entry (r, &arb->requests, node)
+		if (r->kernel_id == kernel_id)
+			return 1;
+	return 0;
+}
+
+static int free_slot(struct tlkm_arbiter *arb, u32 const *pe_kernel,
+		     u32 kernel_id)
+{
+	int s;
+	for (s = 0; s < PLATFORM_NUM_SLOTS; ++s)
+		if (pe_kernel[s] == kernel_id && !arb->owner[s])
+			return s;
+	return -1;
+}
+
+static void grant(struct tlkm_arbiter *arb, struct tlkm_control_file *f,
+		  u32 slot_id)
+{
+	WRITE_ONCE(arb->owner[slot_id], f);
+	arb->granted_at[slot_id] = ktime_get_ns();
+	++f->tenant.held;
+	if (f->tenant.vtime > arb->vclock)
+		arb->vclock = f->tenant.vtime;
+}
+
+/* Charges the holder of a PE for the time since its grant. */
+static void charge(struct tlkm_arbiter *arb, u32 slot_id)
+{
+	struct tlkm_tenant *t = &arb->owner[slot_id]->tenant;
+	u64 const ns = ktime_get_ns() - arb->granted_at[slot_id];
+	t->pe_ns += ns;
+	t->vtime += div_u64(ns * TLKM_ARBITER_WEIGHT, t->weight);
+	--t->held;
+}
+
+/* Passes a released PE on to the waiting request of the tenant with the
+ * least weighted PE time, or marks it as free; called with arb->mtx held. */
+static void hand_over(struct tlkm_arbiter *arb, u32 const *pe_kernel,
+		      u32 slot_id)
+{
+	struct tlkm_pe_request *r, *next = NULL;
+	charge(arb, slot_id);
+	list_for_each_entry (r, &arb->requests, node)
+		if (r->kernel_id == pe_kernel[slot_id] &&
+		    (!next || r->f->tenant.vtime < next->f->tenant.vtime))
+			next = r;
+	WRITE_ONCE(arb->owner[slot_id], NULL);
+	if (next) {
+		list_del(&next->node);
+		--next->f->tenant.waiting;
+		grant(arb, next->f, slot_id);
+		WRITE_ONCE(next->slot_id, slot_id);
+		wake_up_all(&arb->granted_q);
+	}
+}
+
+long tlkm_arbiter_acquire(struct tlkm_arbiter *arb, u32 const *pe_kernel,
+			  struct tlkm_control_file *f, u32 kernel_id,
+			  u32 *slot_id)
+{
+	struct tlkm_pe_request req = {
+		.f = f,
+		.kernel_id = kernel_id,
+		.slot_id = -1,
+	};
+	int s;
+	if (!kernel_id || !has_kernel(pe_kernel, kernel_id))
+		return -ENOENT;
+	mutex_lock(&arb->mtx);
+	/* tenants becoming active start at the current virtual time, they
+	 * cannot claim PE time for the period they were idle */
+	if (!f->tenant.held && !f->tenant.waiting &&
+	    f->tenant.vtime < arb->vclock)
+		f->tenant.vtime = arb->vclock;
+	s = is_waiting(arb, kernel_id) ? -1 :
+					 free_slot(arb, pe_kernel, kernel_id);
+	if (s >= 0) {
+		grant(arb, f, s);
+		mutex_unlock(&arb->mtx);
+		*slot_id = s;
+		return 0;
+	}
+	list_add_tail(&req.node, &arb->requests);
+	++f->tenant.waiting;
+	mutex_unlock(&arb->mtx);
+	if (wait_event_interruptible(arb->granted_q,
+				     READ_ONCE(req.slot_id) >= 0)) {
+		mutex_lock(&arb->mtx);
+		if (req.slot_id < 0) {
+			list_del(&req.node);
+			--f->tenant.waiting;
+			mutex_unlock(&arb->mtx);
+			return -ERESTARTSYS;
+		}
+		mutex_unlock(&arb->mtx);
+	}
+	*slot_id = req.slot_id;
+	return 0;
+}
+
+long tlkm_arbiter_release(struct tlkm_arbiter *arb, u32 const *pe_kernel,
+			  struct tlkm_control_file *f, u32 slot_id)
+{
+	if (slot_id >= PLATFORM_NUM_SLOTS)
+		return -EINVAL;
+	mutex_lock(&arb->mtx);
+	if (arb->owner[slot_id] != f) {
+		mutex_unlock(&arb->mtx);
+		return -EPERM;
+	}
+	hand_over(arb, pe_kernel, slot_id);
+	mutex_unlock(&arb->mtx);
+	return 0;
+}
+
+void tlkm_arbiter_remove(struct tlkm_arbiter *arb, u32 const *pe_kernel,
+			 struct tlkm_control_file *f)
+{
+	u32 s;
+	mutex_lock(&arb->mtx);
+	for (s = 0; s < PLATFORM_NUM_SLOTS; ++s) {
+		if (arb->owner[s] != f)
+			continue;
+		if (!pe_kernel) {
+			/* device is gone, nobody to pass the PE on to */
+			WRITE_ONCE(arb->owner[s], NULL);
+			continue;
+		}
+		WRN("PE in slot #%u still held at close, passing it on", s);
+		hand_over(arb, pe_kernel, s);
+	}
+	list_del(&f->tenant.node);
+	mutex_unlock(&arb->mtx);
+}
+
+long tlkm_arbiter_set_weight(struct tlkm_arbiter *arb,
+			     struct tlkm_control_file *f, u32 weight)
+{
+	if (!weight || weight > TLKM_ARBITER_MAX_WEIGHT)
+		return -EINVAL;
+	/* like nice values, only privileged tenants may raise their share */
+	if (weight > f->tenant.weight && !capable(CAP_SYS_NICE))
+		return -EPERM;
+	mutex_lock(&arb->mtx);
+	f->tenant.weight = weight;
+	mutex_unlock(&arb->mtx);
+	return 0;
+}
+
+void tlkm_arbiter_get_share(struct tlkm_arbiter *arb,
+			    struct tlkm_control_file *f, u32 *weight,
+			    u64 *pe_ns, u32 *held)
+{
+	u32 s;
+	u64 const now = ktime_get_ns();
+	mutex_lock(&arb->mtx);
+	*weight = f->tenant.weight;
+	*pe_ns = f->tenant.pe_ns;
+	*held = f->tenant.held;
+	for (s = 0; s < PLATFORM_NUM_SLOTS; ++s)
+		if (arb->owner[s] == f)
+			*pe_ns += now - arb->granted_at[s];
+	mutex_unlock(&arb->mtx);
+}
+
+long tlkm_arbiter_set_pid_weight(struct tlkm_arbiter *arb, pid_t pid,
+				 u32 weight)
+{
+	struct tlkm_tenant *t;
+	long ret = -ESRCH;
+	if (!weight || weight > TLKM_ARBITER_MAX_WEIGHT)
+		return -EINVAL;
+	mutex_lock(&arb->mtx);
+	list_for_each_entry (t, &arb->tenants, node) {
+		if (t->pid == pid) {
+			t->weight = weight;
+			ret = 0;
+		}
+	}
+	mutex_unlock(&arb->mtx);
+	return ret;
+}
+
+ssize_t tlkm_arbiter_show(struct tlkm_arbiter *arb, char *buf, size_t sz)
+{
+	struct tlkm_tenant *t;
+	ssize_t n = scnprintf(buf, sz, "pid\tweight\theld\twaiting\tpe_us\n");
+	mutex_lock(&arb->mtx);
+	list_for_each_entry (t, &arb->tenants, node)
+		n += scnprintf(buf + n, sz - n, "%d\t%u\t%u\t%u\t%llu\n",
+			       t->pid, t->weight, t->held, t->waiting,
+			       div_u64(t->pe_ns, 1000));
+	mutex_unlock(&arb->mtx);
+	return n;
+}
@@ -0,0 +1,69 @@
+#ifndef TLKM_ARBITER_H__
+#define TLKM_ARBITER_H__
+
+#include <linux/types.h>
+#include <linux/compiler.h>
+#include <linux/list.h>
+#include <linux/mutex.h>
+#include <linux/wait.h>
+#include <linux/sched.h>
+#include "tlkm_slots.h"
+
+/* Share weight of tenants that did not set one. */
+#define TLKM_ARBITER_WEIGHT 100U
+/* Max. share weight of a tenant. */
+#define TLKM_ARBITER_MAX_WEIGHT 10000U
+
+struct tlkm_control_file;
+
+/* Accounting of a tenant, i.e., a process with an open control file. */
+struct tlkm_tenant {
+	struct list_head node; /* in tenant list of arbiter */
+	pid_t pid;
+	u32 weight; /* share weight */
+	u64 vtime; /* PE time consumed, divided by weight */
+	u64 pe_ns; /* PE time consumed */
+	u32 held; /* number of PEs held */
+	u32 waiting; /* number of waiting acquire requests */
+};
+
+/* Grants PEs to the processes sharing a device: a PE is held by one open
+ * file of the control device at a time. Released PEs go to the waiting
+ * tenant with the least PE time consumed relative to its weight (weighted
+ * fair queueing), so each tenant receives its share of the PEs. */
+struct tlkm_arbiter {
+	struct mutex mtx;
+	wait_queue_head_t granted_q;
+	struct tlkm_control_file *owner[PLATFORM_NUM_SLOTS];
+	u64 granted_at[PLATFORM_NUM_SLOTS]; /* time of grant by slot (ns) */
+	struct list_head requests; /* waiting acquire requests, oldest first */
+	struct list_head tenants;
+	u64 vclock; /* virtual time of the last grant */
+};
+
+void tlkm_arbiter_init(struct tlkm_arbiter *arb);
+void tlkm_arbiter_add(struct tlkm_arbiter *arb, struct tlkm_control_file *f);
+void tlkm_arbiter_remove(struct tlkm_arbiter *arb, u32 const *pe_kernel,
+			 struct tlkm_control_file *f);
+long tlkm_arbiter_acquire(struct tlkm_arbiter *arb, u32 const *pe_kernel,
+			  struct tlkm_control_file *f, u32 kernel_id,
+			  u32 *slot_id);
+long tlkm_arbiter_release(struct tlkm_arbiter *arb, u32 const *pe_kernel,
+			  struct tlkm_control_file *f, u32 slot_id);
+long tlkm_arbiter_set_weight(struct tlkm_arbiter *arb,
+			     struct tlkm_control_file *f, u32 weight);
+void tlkm_arbiter_get_share(struct tlkm_arbiter *arb,
+			    struct tlkm_control_file *f, u32 *weight,
+			    u64 *pe_ns, u32 *held);
+long tlkm_arbiter_set_pid_weight(struct tlkm_arbiter *arb, pid_t pid,
+				 u32 weight);
+ssize_t tlkm_arbiter_show(struct tlkm_arbiter *arb, char *buf, size_t sz);
+
+static inline struct tlkm_control_file *
+tlkm_arbiter_owner(struct tlkm_arbiter *arb, u32 slot_id)
+{
+	return slot_id < PLATFORM_NUM_SLOTS ? READ_ONCE(arb->owner[slot_id]) :
+					      NULL;
+}
+
+#endif /* TLKM_ARBITER_H__ */
@@ -1,6 +1,7 @@
 #include <linux/slab.h>
 #include <linux/gfp.h>
 #include <linux/fs.h>
+#include <linux/device.h>
 #include <linux/version.h>
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4, 11, 0)
 #include <linux/sched.h>
@@ -9,19 +10,84 @@
 #endif
 #include "tlkm_logging.h"
 #include "tlkm_control.h"
+#include "tlkm_bus.h"
 #include "tlkm_perfc.h"
 #include "tlkm_device_rw.h"
 #include "tlkm_device_ioctl.h"
 #include "tlkm_device_mmap.h"
 #include "user/tlkm_device_ioctl_cmds.h"
 
+static int tlkm_control_open(struct inode *inode, struct file *fp)
+{
+	struct miscdevice *m = (struct miscdevice *)fp->private_data;
+	struct tlkm_control_file *f =
+		(struct tlkm_control_file *)kzalloc(sizeof(*f), GFP_KERNEL);
+	if (!f)
+		return -ENOMEM;
+	f->pctl = container_of(m, struct tlkm_control, miscdev);
+	tlkm_arbiter_add(&f->pctl->arb, f);
+	fp->private_data = f;
+	return 0;
+}
+
+static int tlkm_control_release(struct inode *inode, struct file *fp)
+{
+	struct tlkm_control_file *f = tlkm_control_file(fp);
+	struct tlkm_control *pctl = f->pctl;
+	struct tlkm_device *kdev = tlkm_bus_get_device(pctl->dev_id);
+	/* tenant is removed in any case, PEs are only passed on with kdev */
+	tlkm_arbiter_remove(&pctl->arb, kdev ? kdev->pe_kernel : NULL, f);
+	/* wait for signals currently routed to this file */
+	mutex_lock(&pctl->out_mutex);
+	mutex_unlock(&pctl->out_mutex);
+	kfree(f);
+	return 0;
+}
+
 static const struct file_operations _tlkm_control_fops = {
+	.open = tlkm_control_open,
+	.release = tlkm_control_release,
 	.unlocked_ioctl = tlkm_device_ioctl,
 	.mmap = tlkm_device_mmap,
 	.read = tlkm_device_read,
 	.write = tlkm_device_write,
 };
 
+/* sysfs: lists the tenants of the device with their share weight and the
+ * PE time they consumed; writing "<pid> <weight>" sets the weight. */
+static ssize_t tenants_show(struct device *dev, struct device_attribute *attr,
+			    char *buf)
+{
+	struct miscdevice *m = (struct miscdevice *)dev_get_drvdata(dev);
+	struct tlkm_control *pctl =
+		container_of(m, struct tlkm_control, miscdev);
+	return tlkm_arbiter_show(&pctl->arb, buf, PAGE_SIZE);
+}
+
+static ssize_t tenants_store(struct device *dev, struct device_attribute *attr,
+			     const char *buf, size_t count)
+{
+	struct miscdevice *m = (struct miscdevice *)dev_get_drvdata(dev);
+	struct tlkm_control *pctl =
+		container_of(m, struct tlkm_control, miscdev);
+	int pid;
+	unsigned int weight;
+	long ret;
+	if (sscanf(buf, "%d %u", &pid, &weight) != 2)
+		return -EINVAL;
+	ret = tlkm_arbiter_set_pid_weight(&pctl->arb, pid, weight);
+	return ret ? ret : count;
+}
+
+static DEVICE_ATTR_RW(tenants);
+
+static struct attribute *tlkm_control_attrs[] = {
+	&dev_attr_tenants.attr,
+	NULL,
+};
+
+ATTRIBUTE_GROUPS(tlkm_control);
+
 static int init_miscdev(struct tlkm_control *pctl)
 {
 	char fn[16];
@@ -30,6 +96,7 @@ static int init_miscdev(struct tlkm_control *pctl)
 	pctl->miscdev.minor = MISC_DYNAMIC_MINOR;
 	pctl->miscdev.name = kstrdup(fn, GFP_KERNEL);
 	pctl->miscdev.fops = &_tlkm_control_fops;
+	pctl->miscdev.groups = tlkm_control_groups;
 	return misc_register(&pctl->miscdev);
 }
 
@@ -41,43 +108,92 @@ static void exit_miscdev(struct tlkm_control *pctl)
 	DEVLOG(pctl->dev_id, TLKM_LF_CONTROL, "destroyed miscdevice");
 }
 
+static void push_signal(struct tlkm_control *pctl, struct tlkm_signal_q *q,
+			const u32 s_id)
+{
+	static long max_outstanding = 0;
+	q->out_slots[q->out_w_idx] = s_id;
+	q->out_w_idx = (q->out_w_idx + 1) % TLKM_CONTROL_BUFFER_SZ;
+	++q->outstanding;
+	tlkm_perfc_signals_signaled_inc(pctl->dev_id);
+	tlkm_perfc_outstanding_set(pctl->dev_id, q->outstanding);
+	if (q->outstanding > max_outstanding) {
+		max_outstanding = q->outstanding;
+		tlkm_perfc_outstanding_high_watermark_set(pctl->dev_id,
+							  max_outstanding);
+	}
+#ifndef NDEBUG
+	if (q->outstanding >= TLKM_CONTROL_BUFFER_SZ)
+		DEVWRN(pctl->dev_id,
+		       "buffer size exceeded! expect missing data!");
+#endif
+}
+
 ssize_t tlkm_control_signal_slot_interrupt(struct tlkm_control *pctl,
 					   const u32 s_id)
 {
-	static long max_outstanding = 0;
+	struct tlkm_control_file *owner;
 	BUG_ON(!pctl);
+	/* slots held by a file signal to its own queue; it holds at most
+	 * PLATFORM_NUM_SLOTS outstanding signals, no throttling required */
 	mutex_lock(&pctl->out_mutex);
-	while (pctl->outstanding > TLKM_CONTROL_BUFFER_SZ - 2) {
+	owner = tlkm_arbiter_owner(&pctl->arb, s_id);
+	if (owner) {
+		DEVLOG(pctl->dev_id, TLKM_LF_CONTROL,
+		       "signaling slot #%u to holder", s_id);
+		push_signal(pctl, &owner->out, s_id);
+		mutex_unlock(&pctl->out_mutex);
+		wake_up_interruptible_all(&pctl->read_q);
+		return sizeof(u32);
+	}
+	while (pctl->out.outstanding > TLKM_CONTROL_BUFFER_SZ - 2) {
 		DEVWRN(pctl->dev_id, "buffer thrashing, throttling write ...");
 		mutex_unlock(&pctl->out_mutex);
 		wait_event_interruptible(pctl->write_q,
-					 pctl->outstanding <=
+					 pctl->out.outstanding <=
 						 (TLKM_CONTROL_BUFFER_SZ / 2));
 		if (signal_pending(current))
 			return -ERESTARTSYS;
 		mutex_lock(&pctl->out_mutex);
 	}
-	mutex_unlock(&pctl->out_mutex);
 	DEVLOG(pctl->dev_id, TLKM_LF_CONTROL, "signaling slot #%u", s_id);
+	push_signal(pctl, &pctl->out, s_id);
+	mutex_unlock(&pctl->out_mutex);
+	wake_up_interruptible_all(&pctl->read_q);
+	return sizeof(u32);
+}
+
+/* Routes the signals of the file's slots to its own queue from now on; signals
+ * of its slots still in the shared queue are moved over, in order. */
+void tlkm_control_arbitrate(struct tlkm_control_file *f)
+{
+	struct tlkm_control *pctl = f->pctl;
+	struct tlkm_signal_q *q = &pctl->out;
+	u32 r, w;
 	mutex_lock(&pctl->out_mutex);
-	pctl->out_slots[pctl->out_w_idx] = s_id;
-	pctl->out_w_idx = (pctl->out_w_idx + 1) % TLKM_CONTROL_BUFFER_SZ;
-	++pctl->outstanding;
-	tlkm_perfc_signals_signaled_inc(pctl->dev_id);
-	tlkm_perfc_outstanding_set(pctl->dev_id, pctl->outstanding);
-	if (pctl->outstanding > max_outstanding) {
-		max_outstanding = pctl->outstanding;
-		tlkm_perfc_outstanding_high_watermark_set(pctl->dev_id,
-							  max_outstanding);
+	if (f->arbitrated) {
+		mutex_unlock(&pctl->out_mutex);
+		return;
 	}
-#ifndef NDEBUG
-	if (pctl->outstanding >= TLKM_CONTROL_BUFFER_SZ)
-		DEVWRN(pctl->dev_id,
-		       "buffer size exceeded! expect missing data!");
-#endif
+	for (r = w = q->out_r_idx; r != q->out_w_idx;
+	     r = (r + 1) % TLKM_CONTROL_BUFFER_SZ) {
+		const u32 s_id = q->out_slots[r];
+		if (tlkm_arbiter_owner(&pctl->arb, s_id) == f) {
+			f->out.out_slots[f->out.out_w_idx] = s_id;
+			f->out.out_w_idx = (f->out.out_w_idx + 1) %
+					   TLKM_CONTROL_BUFFER_SZ;
+			++f->out.outstanding;
+			--q->outstanding;
+		} else {
+			q->out_slots[w] = s_id;
+			w = (w + 1) % TLKM_CONTROL_BUFFER_SZ;
+		}
+	}
+	q->out_w_idx = w;
+	f->arbitrated = 1;
 	mutex_unlock(&pctl->out_mutex);
-	wake_up_interruptible(&pctl->read_q);
-	return sizeof(u32);
+	/* readers of the file wait on the other queue, make them switch */
+	wake_up_interruptible_all(&pctl->read_q);
 }
 
 int tlkm_control_init(dev_id_t dev_id, struct tlkm_control **ppctl)
@@ -92,10 +208,11 @@ int tlkm_control_init(dev_id_t dev_id, struct tlkm_control **ppctl)
 	p->dev_id = dev_id;
 	init_waitqueue_head(&p->read_q);
 	init_waitqueue_head(&p->write_q);
-	p->out_r_idx = 0;
-	p->out_w_idx = 0;
-	p->outstanding = 0;
+	p->out.out_r_idx = 0;
+	p->out.out_w_idx = 0;
+	p->out.outstanding = 0;
 	mutex_init(&p->out_mutex);
+	tlkm_arbiter_init(&p->arb);
 	if ((ret = init_miscdev(p))) {
 		DEVERR(dev_id, "could not initialize control: %d", ret);
 		goto err_miscdev;
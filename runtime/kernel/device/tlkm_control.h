@@ -5,24 +5,51 @@
 #include <linux/mutex.h>
 #include <linux/sched.h>
 #include <linux/miscdevice.h>
+#include <linux/fs.h>
 #include "tlkm_types.h"
+#include "tlkm_arbiter.h"
 
 #define TLKM_CONTROL_BUFFER_SZ 1024U
 
+/* Ring buffer of finished slots, read via the control device. */
+struct tlkm_signal_q {
+	volatile u32 out_slots[TLKM_CONTROL_BUFFER_SZ];
+	volatile u32 out_r_idx;
+	volatile u32 out_w_idx;
+	volatile u32 outstanding;
+};
+
 struct tlkm_control {
 	dev_id_t dev_id;
 	struct miscdevice miscdev;
 	wait_queue_head_t read_q;
 	wait_queue_head_t write_q;
-	volatile u32 out_slots[TLKM_CONTROL_BUFFER_SZ];
-	volatile u32 out_r_idx;
-	volatile u32 out_w_idx;
+	struct tlkm_signal_q out; /* signals of slots not held by a file */
 	struct mutex out_mutex;
-	volatile u32 outstanding;
+	struct tlkm_arbiter arb;
 };
 
+/* Open file of the control device. */
+struct tlkm_control_file {
+	struct tlkm_control *pctl;
+	struct tlkm_signal_q out; /* signals of slots held by this file */
+	volatile int arbitrated; /* set once the file has acquired a PE */
+	struct tlkm_tenant tenant; /* PE share accounting */
+};
+
+static inline struct tlkm_control_file *tlkm_control_file(struct file *fp)
+{
+	return (struct tlkm_control_file *)fp->private_data;
+}
+
+static inline struct tlkm_control *tlkm_control_from_file(struct file *fp)
+{
+	return tlkm_control_file(fp)->pctl;
+}
+
 ssize_t tlkm_control_signal_slot_interrupt(struct tlkm_control *pctl,
 					   const u32 s_id);
+void tlkm_control_arbitrate(struct tlkm_control_file *f);
 int tlkm_control_init(dev_id_t dev_id, struct tlkm_control **ppctl);
 void tlkm_control_exit(struct tlkm_control *pctl);
 
@@ -8,17 +8,12 @@
 
 static struct tlkm_control *control_from_file(struct file *fp)
 {
-	struct miscdevice *m = (struct miscdevice *)fp->private_data;
-	return (struct tlkm_control *)container_of(m, struct tlkm_control,
-						   miscdev);
+	return tlkm_control_from_file(fp);
 }
 
 static struct tlkm_device *device_from_file(struct file *fp)
 {
-	struct miscdevice *m = (struct miscdevice *)fp->private_data;
-	struct tlkm_control *c = (struct tlkm_control *)container_of(
-		m, struct tlkm_control, miscdev);
-	return tlkm_bus_get_device(c->dev_id);
+	return tlkm_bus_get_device(control_from_file(fp)->dev_id);
 }
 
 long tlkm_device_ioctl_info(struct file *fp, unsigned int ioctl,
@@ -73,6 +68,82 @@ long tlkm_device_ioctl_size(struct file *fp, unsigned int ioctl,
 	return 0;
 }
 
+long tlkm_device_ioctl_acquire_pe(struct file *fp, unsigned int ioctl,
+				  struct tlkm_pe_cmd __user *cmd)
+{
+	struct tlkm_pe_cmd kcmd;
+	struct tlkm_control_file *f = tlkm_control_file(fp);
+	struct tlkm_device *kdev = device_from_file(fp);
+	long ret;
+	if (!kdev) {
+		ERR("bus has become invalid");
+		return -EFAULT;
+	}
+	if (copy_from_user(&kcmd, (void __user *)cmd, sizeof(kcmd))) {
+		ERR("could not copy all bytes from user space");
+		return -EAGAIN;
+	}
+	ret = tlkm_arbiter_acquire(&f->pctl->arb, kdev->pe_kernel, f,
+				   kcmd.kernel_id, &kcmd.slot_id);
+	if (ret)
+		return ret;
+	if (!f->arbitrated)
+		tlkm_control_arbitrate(f);
+	DEVLOG(kdev->dev_id, TLKM_LF_CONTROL, "granted PE in slot #%u",
+	       kcmd.slot_id);
+	if (copy_to_user((void __user *)cmd, &kcmd, sizeof(kcmd))) {
+		ERR("could not copy all bytes to user space");
+		tlkm_arbiter_release(&f->pctl->arb, kdev->pe_kernel, f,
+				     kcmd.slot_id);
+		return -EAGAIN;
+	}
+	return 0;
+}
+
+long tlkm_device_ioctl_release_pe(struct file *fp, unsigned int ioctl,
+				  struct tlkm_pe_cmd __user *cmd)
+{
+	struct tlkm_pe_cmd kcmd;
+	struct tlkm_control_file *f = tlkm_control_file(fp);
+	struct tlkm_device *kdev = device_from_file(fp);
+	if (!kdev) {
+		ERR("bus has become invalid");
+		return -EFAULT;
+	}
+	if (copy_from_user(&kcmd, (void __user *)cmd, sizeof(kcmd))) {
+		ERR("could not copy all bytes from user space");
+		return -EAGAIN;
+	}
+	return tlkm_arbiter_release(&f->pctl->arb, kdev->pe_kernel, f,
+				    kcmd.slot_id);
+}
+
+long tlkm_device_ioctl_set_share(struct file *fp, unsigned int ioctl,
+				 struct tlkm_share_cmd __user *cmd)
+{
+	struct tlkm_share_cmd kcmd;
+	struct tlkm_control_file *f = tlkm_control_file(fp);
+	if (copy_from_user(&kcmd, (void __user *)cmd, sizeof(kcmd))) {
+		ERR("could not copy all bytes from user space");
+		return -EAGAIN;
+	}
+	return tlkm_arbiter_set_weight(&f->pctl->arb, f, kcmd.weight);
+}
+
+long tlkm_device_ioctl_get_share(struct file *fp, unsigned int ioctl,
+				 struct tlkm_share_cmd __user *cmd)
+{
+	struct tlkm_share_cmd kcmd;
+	struct tlkm_control_file *f = tlkm_control_file(fp);
+	tlkm_arbiter_get_share(&f->pctl->arb, f, &kcmd.weight, &kcmd.pe_ns,
+			       &kcmd.held);
+	if (copy_to_user((void __user *)cmd, &kcmd, sizeof(kcmd))) {
+		ERR("could not copy all bytes to user space");
+		return -EAGAIN;
+	}
+	return 0;
+}
+
 long tlkm_device_ioctl(struct file *fp, unsigned int ioctl, unsigned long data)
 {
 	tlkm_perfc_control_ioctls_inc(device_from_file(fp)->dev_id);
@@ -82,6 +153,18 @@ long tlkm_device_ioctl(struct file *fp, unsigned int ioctl, unsigned long data)
 	} else if (ioctl == TLKM_DEV_IOCTL_SIZE) {
 		return tlkm_device_ioctl_size(
 			fp, ioctl, (struct tlkm_size_cmd __user *)data);
+	} else if (ioctl == TLKM_DEV_IOCTL_ACQUIRE_PE) {
+		return tlkm_device_ioctl_acquire_pe(
+			fp, ioctl, (struct tlkm_pe_cmd __user *)data);
+	} else if (ioctl == TLKM_DEV_IOCTL_RELEASE_PE) {
+		return tlkm_device_ioctl_release_pe(
+			fp, ioctl, (struct tlkm_pe_cmd __user *)data);
+	} else if (ioctl == TLKM_DEV_IOCTL_SET_SHARE) {
+		return tlkm_device_ioctl_set_share(
+			fp, ioctl, (struct tlkm_share_cmd __user *)data);
+	} else if (ioctl == TLKM_DEV_IOCTL_GET_SHARE) {
+		return tlkm_device_ioctl_get_share(
+			fp, ioctl, (struct tlkm_share_cmd __user *)data);
 	} else {
 		tlkm_device_ioctl_f ioctl_f = device_from_file(fp)->cls->ioctl;
 		BUG_ON(!ioctl_f);
@@ -5,10 +5,7 @@
 
 static inline struct tlkm_device *device_from_file(struct file *fp)
 {
-	struct miscdevice *m = (struct miscdevice *)fp->private_data;
-	struct tlkm_control *c = (struct tlkm_control *)container_of(
-		m, struct tlkm_control, miscdev);
-	return tlkm_bus_get_device(c->dev_id);
+	return tlkm_bus_get_device(tlkm_control_from_file(fp)->dev_id);
 }
 
 int tlkm_device_mmap(struct file *fp, struct vm_area_struct *vm)
@@ -12,10 +12,10 @@
 
 #define TLKM_CONTROL_MAX_READS 128
 
-inline static struct tlkm_control *control_from_file(struct file *fp)
+/* Files holding PEs read their own signals, all others the shared queue. */
+inline static struct tlkm_signal_q *signal_q_of(struct tlkm_control_file *f)
 {
-	struct miscdevice *m = (struct miscdevice *)fp->private_data;
-	return container_of(m, struct tlkm_control, miscdev);
+	return f->arbitrated ? &f->out : &f->pctl->out;
 }
 
 ssize_t tlkm_device_read(struct file *fp, char __user *usr, size_t sz,
@@ -24,48 +24,52 @@ ssize_t tlkm_device_read(struct file *fp, char __user *usr, size_t sz,
 	ssize_t out = 0;
 	u32 out_val[TLKM_CONTROL_MAX_READS];
 	size_t out_sz;
-	struct tlkm_control *pctl = control_from_file(fp);
+	struct tlkm_control_file *f = tlkm_control_file(fp);
+	struct tlkm_control *pctl = f->pctl;
+	struct tlkm_signal_q *q;
 	if (!pctl) {
 		DEVERR(pctl->dev_id, "received invalid file pointer");
 		return -EFAULT;
 	}
 	do {
 		mutex_lock(&pctl->out_mutex);
-		out_sz = pctl->out_w_idx >= pctl->out_r_idx ?
-				 pctl->out_w_idx - pctl->out_r_idx :
-				 TLKM_CONTROL_BUFFER_SZ - pctl->out_r_idx;
-		if (out_sz * sizeof(*(pctl->out_slots)) > sz) {
-			out_sz = sz / sizeof(*(pctl->out_slots));
+		q = signal_q_of(f);
+		out_sz = q->out_w_idx >= q->out_r_idx ?
+				 q->out_w_idx - q->out_r_idx :
+				 TLKM_CONTROL_BUFFER_SZ - q->out_r_idx;
+		if (out_sz * sizeof(u32) > sz) {
+			out_sz = sz / sizeof(u32);
 			tlkm_perfc_limited_by_read_sz_inc(pctl->dev_id);
 		}
 		if (out_sz > TLKM_CONTROL_MAX_READS) {
 			out_sz = TLKM_CONTROL_MAX_READS;
 			tlkm_perfc_limited_by_outbuf_sz_inc(pctl->dev_id);
 		}
-		out = pctl->out_w_idx != pctl->out_r_idx;
+		out = q->out_w_idx != q->out_r_idx;
 		if (out) {
 			ssize_t i, j;
-			if (pctl->out_w_idx < pctl->out_r_idx)
+			if (q->out_w_idx < q->out_r_idx)
 				tlkm_perfc_indices_reversed_inc(pctl->dev_id);
 			else
 				tlkm_perfc_indices_in_order_inc(pctl->dev_id);
-			for (i = 0, j = pctl->out_r_idx; i < out_sz; ++i, ++j) {
-				out_val[i] = pctl->out_slots[j];
+			for (i = 0, j = q->out_r_idx; i < out_sz; ++i, ++j) {
+				out_val[i] = q->out_slots[j];
 			}
-			pctl->out_r_idx = (pctl->out_r_idx + out_sz) %
-					  TLKM_CONTROL_BUFFER_SZ;
-			pctl->outstanding -= out_sz;
+			q->out_r_idx = (q->out_r_idx + out_sz) %
+				       TLKM_CONTROL_BUFFER_SZ;
+			q->outstanding -= out_sz;
 			tlkm_perfc_signals_read_add(pctl->dev_id, out_sz);
 			tlkm_perfc_outstanding_set(pctl->dev_id,
-						   pctl->outstanding);
+						   q->outstanding);
 		}
 		mutex_unlock(&pctl->out_mutex);
 		if (!out) {
 			DEVLOG(pctl->dev_id, TLKM_LF_CONTROL,
 			       "waiting on data ...");
-			wait_event_interruptible(pctl->read_q,
-						 pctl->out_w_idx !=
-							 pctl->out_r_idx);
+			wait_event_interruptible(
+				pctl->read_q,
+				signal_q_of(f)->out_w_idx !=
+					signal_q_of(f)->out_r_idx);
 			if (signal_pending(current))
 				return -ERESTARTSYS;
 		} else {
@@ -74,10 +78,10 @@ ssize_t tlkm_device_read(struct file *fp, char __user *usr, size_t sz,
 			wake_up_interruptible(&pctl->write_q);
 		}
 	} while (!out);
-	out = copy_to_user(usr, out_val, out_sz * sizeof(*(pctl->out_slots)));
+	out = copy_to_user(usr, out_val, out_sz * sizeof(u32));
 	if (out)
 		return -EFAULT;
-	return out_sz * sizeof(*(pctl->out_slots));
+	return out_sz * sizeof(u32);
 }
 
 ssize_t tlkm_device_write(struct file *fp, const char __user *usr, size_t sz,
@@ -85,7 +89,7 @@ ssize_t tlkm_device_write(struct file *fp, const char __user *usr, size_t sz,
 {
 	u32 in_val = 0;
 	ssize_t in;
-	struct tlkm_control *pctl = control_from_file(fp);
+	struct tlkm_control *pctl = tlkm_control_from_file(fp);
 	if (!pctl) {
 		DEVERR(pctl->dev_id, "received invalid file pointer");
 		return -EFAULT;
@@ -12,6 +12,7 @@
 #include "tlkm_status.h"
 #include "dma/tlkm_dma.h"
 #include "tlkm_class.h"
+#include "tlkm_slots.h"
 
 #define TLKM_DEVICE_NAME_LEN 30
 #define TLKM_DEVICE_MAX_DMA_ENGINES 4
@@ -35,6 +36,8 @@ struct tlkm_device {
 	struct tlkm_control *ctrl; /* main device file */
 	struct dma_engine dma[TLKM_DEVICE_MAX_DMA_ENGINES];
 	tlkm_component_t components[TLKM_COMPONENT_MAX];
+	u32 pe_kernel[PLATFORM_NUM_SLOTS]; /* kernel ids of PEs by slot */
+	u64 pe_memory[PLATFORM_NUM_SLOTS]; /* sizes of local memories by slot */
 #ifndef NPERFC
 	struct miscdevice perfc_dev; /* performance counter device */
 #endif
@@ -41,6 +41,30 @@ bool add_component(pb_istream_t *stream, const pb_field_t *field, void **arg)
 	return ret;
 }
 
+typedef struct {
+	struct tlkm_device *dev;
+	int slot;
+} add_pe_helper_t;
+
+/* Records the composition by slot, as in the runtime: the kernel id of each
+ * PE, and the size of its local memory in the slot following the PE. PEs
+ * take the next slot not flagged as memory. */
+bool add_pe(pb_istream_t *stream, const pb_field_t *field, void **arg)
+{
+	tapasco_status_PE pe = tapasco_status_PE_init_zero;
+	add_pe_helper_t *help = *arg;
+	struct tlkm_device *dev = help->dev;
+	bool ret = pb_decode(stream, tapasco_status_PE_fields, &pe);
+	while (help->slot < PLATFORM_NUM_SLOTS && dev->pe_memory[help->slot])
+		++help->slot;
+	if (help->slot >= PLATFORM_NUM_SLOTS)
+		return ret;
+	dev->pe_kernel[help->slot++] = pe.id;
+	if (pe.local_memory.size && help->slot < PLATFORM_NUM_SLOTS)
+		dev->pe_memory[help->slot] = pe.local_memory.size;
+	return ret;
+}
+
 int tlkm_status_init(tlkm_status *sta, struct tlkm_device *dev,
 		     void __iomem *status, size_t status_size)
 {
@@ -48,6 +72,7 @@ int tlkm_status_init(tlkm_status *sta, struct tlkm_device *dev,
 	pb_istream_t stream;
 	int i;
 	add_component_helper_t add_component_helper = { .dev = dev, .cntr = 0 };
+	add_pe_helper_t add_pe_helper = { .dev = dev, .slot = 0 };
 	BUG_ON(!dev);
 	BUG_ON(!sta);
 	DEVLOG(dev->dev_id, TLKM_LF_STATUS,
@@ -58,7 +83,14 @@ int tlkm_status_init(tlkm_status *sta, struct tlkm_device *dev,
 		dev->components[i].offset = -1;
 	}
 
+	memset(dev->pe_kernel, 0, sizeof(dev->pe_kernel));
+	memset(dev->pe_memory, 0, sizeof(dev->pe_memory));
+
 	*sta = (tapasco_status_Status)tapasco_status_Status_init_zero;
+	sta->pe = (pb_callback_t){ {
+					   .decode = &add_pe,
+				   },
+				   .arg = &add_pe_helper };
 	sta->platform = (pb_callback_t){ {
 						 .decode = &add_component,
 					 },
@@ -54,6 +54,17 @@ struct tlkm_size_cmd {
 	size_t platform;
 };
 
+struct tlkm_pe_cmd {
+	u32 kernel_id;
+	u32 slot_id;
+};
+
+struct tlkm_share_cmd {
+	u64 pe_ns; /* PE time consumed by the process */
+	u32 weight; /* share weight of the process */
+	u32 held; /* number of PEs held by the process */
+};
+
 #define TLKM_DEV_IOCTL_FN "tlkm_%02u"
 #define TLKM_DEV_PERFC_FN "tlkm_perfc_%02u"
 
@@ -73,7 +84,11 @@ struct tlkm_size_cmd {
 	_TLKM_DEV_IOCTL(COPYFROM_FREE, copyfrom_free, 0x21,                    \
 			struct tlkm_bulk_cmd)                                  \
 	_TLKM_DEV_IOCTL(READ, read, 0x30, struct tlkm_copy_cmd)                \
-	_TLKM_DEV_IOCTL(WRITE, write, 0x31, struct tlkm_copy_cmd)
+	_TLKM_DEV_IOCTL(WRITE, write, 0x31, struct tlkm_copy_cmd)              \
+	_TLKM_DEV_IOCTL(ACQUIRE_PE, acquire_pe, 0x40, struct tlkm_pe_cmd)      \
+	_TLKM_DEV_IOCTL(RELEASE_PE, release_pe, 0x41, struct tlkm_pe_cmd)      \
+	_TLKM_DEV_IOCTL(SET_SHARE, set_share, 0x42, struct tlkm_share_cmd)     \
+	_TLKM_DEV_IOCTL(GET_SHARE, get_share, 0x43, struct tlkm_share_cmd)
 
 enum {
 #define _TLKM_DEV_IOCTL(NAME, name, id, dt)                                    \
@@ -36,7 +36,10 @@
   _PC(waiting_for_slot)                                                        \
   _PC(slot_interrupts_active)                                                  \
   _PC(sem_wait_error)                                                          \
-  _PC(sem_post_error)
+  _PC(sem_post_error)                                                          \
+  _PC(mem_cache_hits)                                                          \
+  _PC(mem_cache_misses)                                                        \
+  _PC(mem_cache_trimmed)
 
 #ifndef NPERFC
 const char *platform_perfc_tostring(platform_dev_id_t const dev_id);
@@ -2,10 +2,9 @@
 #define PLATFORM_ASYNC_H__
 
 #include <platform_types.h>
+#include <time.h>
 
 typedef struct platform_signaling platform_signaling_t;
-typedef void (*platform_signal_received_f)(size_t num,
-                                           platform_slot_id_t *slots);
 
 platform_res_t platform_signaling_init(platform_devctx_t const *pctx,
                                        platform_signaling_t **a);
@@ -15,8 +14,19 @@ platform_res_t platform_signaling_wait_for_slot(platform_signaling_t *a,
                                                 platform_slot_id_t const slot);
 platform_res_t platform_wait_for_slot(platform_devctx_t *ctx,
                                       platform_slot_id_t const slot);
+platform_res_t
+platform_signaling_wait_for_slot_timed(platform_signaling_t *a,
+                                       platform_slot_id_t const slot,
+                                       struct timespec const *deadline);
 
 void platform_signaling_signal_received(platform_signaling_t *s,
-                                        platform_signal_received_f callback);
+                                        platform_signal_received_f callback,
+                                        void *arg);
+
+platform_res_t platform_signaling_poll_begin(platform_signaling_t *a,
+                                            platform_slot_id_t const slot);
+int platform_signaling_poll_end(platform_signaling_t *a,
+                                platform_slot_id_t const slot,
+                                int const finished);
 
 #endif /* PLATFORM_ASYNC_H__ */
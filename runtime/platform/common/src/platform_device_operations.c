@@ -4,9 +4,12 @@
 #include <platform_device_operations.h>
 #include <platform_errors.h>
 #include <platform_logging.h>
+#include <platform_perfc.h>
 #include <pthread.h>
+#include <stdatomic.h>
 #include <string.h>
 #include <sys/mman.h>
+#include <time.h>
 #include <tlkm_device_ioctl_cmds.h>
 
 typedef struct device_regspace {
@@ -38,15 +41,59 @@ typedef struct device_regs {
     }                                                                          \
   }
 
-typedef struct default_platform {
+/** Size classes cached per thread: multiples of GEN_MEM_ALIGNMENT up to
+ *  2^MEM_CACHE_MIN_LOG2 bytes, then four per power of two up to
+ *  2^MEM_CACHE_MAX_LOG2 bytes, i.e., blocks are at most 25% larger than
+ *  requested. **/
+#define MEM_CACHE_MIN_LOG2 8
+#ifndef MEM_CACHE_MAX_LOG2
+#define MEM_CACHE_MAX_LOG2 18
+#endif
+#define MEM_CACHE_SMALL ((1 << MEM_CACHE_MIN_LOG2) / GEN_MEM_ALIGNMENT)
+#define MEM_CACHE_CLASSES                                                      \
+  (MEM_CACHE_SMALL + (MEM_CACHE_MAX_LOG2 - MEM_CACHE_MIN_LOG2) * 4)
+/** Max. number of blocks cached per size class and thread. **/
+#ifndef MEM_CACHE_BLOCKS
+#define MEM_CACHE_BLOCKS 32
+#endif
+/** Max. number of bytes cached per size class and thread. **/
+#ifndef MEM_CACHE_CLASS_BYTES
+#define MEM_CACHE_CLASS_BYTES (512 * 1024)
+#endif
+/** Caches unused for this long are returned to the central allocator. **/
+#ifndef MEM_CACHE_IDLE_NS
+#define MEM_CACHE_IDLE_NS 100000000ULL
+#endif
+/** Hits are published to the performance counters in batches. **/
+#define MEM_CACHE_PUBLISH_HITS 1024
+
+typedef struct default_platform default_platform_t;
+
+/* Thread-local cache of freed device memory blocks by size class; avoids the
+ * central allocator lock for most small allocations. */
+struct default_mem_cache {
+  default_platform_t *pp;
+  struct default_mem_cache *next; // list of all caches of platform
+  pthread_mutex_t mtx;            // uncontended, except during trimming
+  int used;                       // set on each use, cleared by trimming
+  int hits;                       // not yet published to perfc
+  size_t cnt[MEM_CACHE_CLASSES];
+  addr_t blocks[MEM_CACHE_CLASSES][MEM_CACHE_BLOCKS];
+};
+
+struct default_platform {
   volatile void *arch_map;
   volatile void *plat_map;
   volatile void *status_map;
   platform_devctx_t *devctx;
-  block_t *mem;
+  gen_mem_t *mem;
   pthread_mutex_t mem_mtx;
+  pthread_key_t cache_key;
+  pthread_mutex_t cache_mtx;
+  struct default_mem_cache *caches;
+  _Atomic uint64_t next_trim; // time of next trimming of idle caches
   device_regs_t regspace;
-} default_platform_t;
+};
 
 volatile void *device_regspace_status_ptr(const platform_devctx_t *devctx) {
   default_platform_t *pp = (default_platform_t *)devctx->private_data;
@@ -119,22 +166,225 @@ platform_res_t default_dealloc_driver(platform_devctx_t *devctx,
   return PLATFORM_SUCCESS;
 }
 
+platform_res_t platform_acquire_pe(platform_devctx_t *ctx,
+                                   platform_kernel_id_t const k_id,
+                                   platform_slot_id_t *slot) {
+  struct tlkm_pe_cmd cmd = {
+      .kernel_id = k_id,
+      .slot_id = PLATFORM_NUM_SLOTS,
+  };
+  long ret;
+  while ((ret = ioctl(ctx->fd_ctrl, TLKM_DEV_IOCTL_ACQUIRE_PE, &cmd)) &&
+         errno == EINTR)
+    ;
+  if (ret) {
+    DEVERR(ctx->dev_id, "could not acquire PE of kernel " PRIkernel ": %s (%d)",
+           k_id, strerror(errno), errno);
+    return PERR_TLKM_ERROR;
+  }
+  DEVLOG(ctx->dev_id, LPLL_DEVICE,
+         "kernel " PRIkernel ": acquired slot #" PRIslot, k_id, cmd.slot_id);
+  *slot = cmd.slot_id;
+  return PLATFORM_SUCCESS;
+}
+
+platform_res_t platform_release_pe(platform_devctx_t *ctx,
+                                   platform_slot_id_t const slot) {
+  struct tlkm_pe_cmd cmd = {
+      .slot_id = slot,
+  };
+  if (ioctl(ctx->fd_ctrl, TLKM_DEV_IOCTL_RELEASE_PE, &cmd)) {
+    DEVERR(ctx->dev_id, "could not release slot #" PRIslot ": %s (%d)", slot,
+           strerror(errno), errno);
+    return PERR_TLKM_ERROR;
+  }
+  return PLATFORM_SUCCESS;
+}
+
+platform_res_t platform_set_share(platform_devctx_t *ctx,
+                                  uint32_t const weight) {
+  struct tlkm_share_cmd cmd = {
+      .weight = weight,
+  };
+  if (ioctl(ctx->fd_ctrl, TLKM_DEV_IOCTL_SET_SHARE, &cmd)) {
+    DEVERR(ctx->dev_id, "could not set share weight %u: %s (%d)", weight,
+           strerror(errno), errno);
+    return PERR_TLKM_ERROR;
+  }
+  return PLATFORM_SUCCESS;
+}
+
+platform_res_t platform_get_share(platform_devctx_t *ctx, uint32_t *weight,
+                                  uint64_t *pe_ns) {
+  struct tlkm_share_cmd cmd;
+  if (ioctl(ctx->fd_ctrl, TLKM_DEV_IOCTL_GET_SHARE, &cmd)) {
+    DEVERR(ctx->dev_id, "could not get share: %s (%d)", strerror(errno),
+           errno);
+    return PERR_TLKM_ERROR;
+  }
+  *weight = cmd.weight;
+  *pe_ns = cmd.pe_ns;
+  return PLATFORM_SUCCESS;
+}
+
+static inline uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Returns the size class of len, MEM_CACHE_CLASSES if it is too large. */
+static inline int mem_class(size_t const len) {
+  if (len <= (1UL << MEM_CACHE_MIN_LOG2))
+    return len ? (int)((len - 1) / GEN_MEM_ALIGNMENT) : 0;
+  if (len > (1UL << MEM_CACHE_MAX_LOG2))
+    return MEM_CACHE_CLASSES;
+  size_t const n = len - 1;
+  int const f = 63 - __builtin_clzl(n);
+  return MEM_CACHE_SMALL + (f - MEM_CACHE_MIN_LOG2) * 4 +
+         (int)((n >> (f - 2)) & 3);
+}
+
+static inline size_t class_size(int const c) {
+  if (c < MEM_CACHE_SMALL)
+    return (size_t)(c + 1) * GEN_MEM_ALIGNMENT;
+  int const k = c - MEM_CACHE_SMALL;
+  return (size_t)(5 + k % 4) << (k / 4 + MEM_CACHE_MIN_LOG2 - 2);
+}
+
+static inline size_t class_blocks(int const c) {
+  size_t const n = MEM_CACHE_CLASS_BYTES / class_size(c);
+  return n > MEM_CACHE_BLOCKS ? MEM_CACHE_BLOCKS : n ? n : 1;
+}
+
+static void free_blocks(default_platform_t *pp, int const c,
+                        addr_t const *blocks, size_t const n) {
+  pthread_mutex_lock(&pp->mem_mtx);
+  for (size_t i = 0; i < n; ++i)
+    gen_mem_free(&pp->mem, blocks[i], class_size(c));
+  pthread_mutex_unlock(&pp->mem_mtx);
+}
+
+static void publish_hits(default_platform_t *pp, struct default_mem_cache *mc) {
+  platform_perfc_mem_cache_hits_add(pp->devctx->dev_id, mc->hits);
+  mc->hits = 0;
+}
+
+/* Returns all blocks of a cache to the central allocator; needs mc->mtx. */
+static size_t flush_cache(default_platform_t *pp,
+                          struct default_mem_cache *mc) {
+  size_t n = 0;
+  for (int c = 0; c < MEM_CACHE_CLASSES; ++c) {
+    free_blocks(pp, c, mc->blocks[c], mc->cnt[c]);
+    n += mc->cnt[c];
+    mc->cnt[c] = 0;
+  }
+  publish_hits(pp, mc);
+  return n;
+}
+
+/* Flushes the caches of threads which did not allocate or free since the
+ * last trimming (all of them, if force is set). Caches are trimmed only when
+ * memory is allocated centrally; as long as no thread needs to, there is no
+ * demand for the cached blocks. */
+static void trim_caches(default_platform_t *pp, int const force) {
+  uint64_t const now = now_ns();
+  uint64_t t = pp->next_trim;
+  if (!force && (now < t || !atomic_compare_exchange_strong(
+                                &pp->next_trim, &t, now + MEM_CACHE_IDLE_NS)))
+    return;
+  size_t n = 0;
+  pthread_mutex_lock(&pp->cache_mtx);
+  for (struct default_mem_cache *mc = pp->caches; mc; mc = mc->next) {
+    pthread_mutex_lock(&mc->mtx);
+    if (force || !mc->used)
+      n += flush_cache(pp, mc);
+    mc->used = 0;
+    pthread_mutex_unlock(&mc->mtx);
+  }
+  pthread_mutex_unlock(&pp->cache_mtx);
+  if (n) {
+    platform_perfc_mem_cache_trimmed_add(pp->devctx->dev_id, n);
+    DEVLOG(pp->devctx->dev_id, LPLL_MM, "trimmed %zu cached blocks", n);
+  }
+}
+
+/* Returns the cached blocks of an exiting thread. */
+static void destroy_cache(void *p) {
+  struct default_mem_cache *mc = (struct default_mem_cache *)p;
+  default_platform_t *pp = mc->pp;
+  pthread_mutex_lock(&pp->cache_mtx);
+  struct default_mem_cache **m = &pp->caches;
+  while (*m != mc)
+    m = &(*m)->next;
+  *m = mc->next;
+  pthread_mutex_unlock(&pp->cache_mtx);
+  flush_cache(pp, mc);
+  pthread_mutex_destroy(&mc->mtx);
+  free(mc);
+}
+
+static inline struct default_mem_cache *get_cache(default_platform_t *pp) {
+  struct default_mem_cache *mc =
+      (struct default_mem_cache *)pthread_getspecific(pp->cache_key);
+  if (mc)
+    return mc;
+  if (!(mc = (struct default_mem_cache *)calloc(sizeof(*mc), 1)))
+    return NULL;
+  mc->pp = pp;
+  pthread_mutex_init(&mc->mtx, NULL);
+  pthread_mutex_lock(&pp->cache_mtx);
+  mc->next = pp->caches;
+  pp->caches = mc;
+  pthread_mutex_unlock(&pp->cache_mtx);
+  pthread_setspecific(pp->cache_key, mc);
+  return mc;
+}
+
+static addr_t central_alloc(default_platform_t *pp, size_t const len) {
+  trim_caches(pp, 0);
+  pthread_mutex_lock(&pp->mem_mtx);
+  addr_t a = gen_mem_malloc(&pp->mem, len);
+  pthread_mutex_unlock(&pp->mem_mtx);
+  if (a == INVALID_ADDRESS) {
+    // memory may be held in the caches of other threads
+    trim_caches(pp, 1);
+    pthread_mutex_lock(&pp->mem_mtx);
+    a = gen_mem_malloc(&pp->mem, len);
+    pthread_mutex_unlock(&pp->mem_mtx);
+  }
+  return a;
+}
+
 platform_res_t default_alloc_host(platform_devctx_t *devctx, size_t const len,
                                   platform_mem_addr_t *addr,
                                   platform_alloc_flags_t const flags) {
   default_platform_t *pp = (default_platform_t *)devctx->private_data;
-  if (pp) {
-    pthread_mutex_lock(&pp->mem_mtx);
-    const addr_t a = gen_mem_malloc(&pp->mem, len);
-    pthread_mutex_unlock(&pp->mem_mtx);
-    if (a == INVALID_ADDRESS)
-      return PERR_OUT_OF_MEMORY;
-    else
-      *addr = a;
-  } else {
+  if (!pp)
     return PERR_TLKM_ERROR;
+  int const c = flags & PLATFORM_ALLOC_FLAGS_UNCACHED ? MEM_CACHE_CLASSES
+                                                      : mem_class(len);
+  struct default_mem_cache *mc = c < MEM_CACHE_CLASSES ? get_cache(pp) : NULL;
+  if (mc) {
+    pthread_mutex_lock(&mc->mtx);
+    mc->used = 1;
+    if (mc->cnt[c]) {
+      *addr = mc->blocks[c][--mc->cnt[c]];
+      if (++mc->hits >= MEM_CACHE_PUBLISH_HITS)
+        publish_hits(pp, mc);
+      pthread_mutex_unlock(&mc->mtx);
+      return PLATFORM_SUCCESS;
+    }
+    publish_hits(pp, mc);
+    pthread_mutex_unlock(&mc->mtx);
+    platform_perfc_mem_cache_misses_inc(devctx->dev_id);
   }
-
+  // blocks of cached size classes are interchangeable, round them up
+  const addr_t a =
+      central_alloc(pp, c < MEM_CACHE_CLASSES ? class_size(c) : len);
+  if (a == INVALID_ADDRESS)
+    return PERR_OUT_OF_MEMORY;
+  *addr = a;
   return PLATFORM_SUCCESS;
 }
 
@@ -142,13 +392,34 @@ platform_res_t default_dealloc_host(platform_devctx_t *devctx, size_t const len,
                                     platform_mem_addr_t const addr,
                                     platform_alloc_flags_t const flags) {
   default_platform_t *pp = (default_platform_t *)devctx->private_data;
-  if (pp) {
+  if (!pp)
+    return PERR_TLKM_ERROR;
+  int const c = flags & PLATFORM_ALLOC_FLAGS_UNCACHED ? MEM_CACHE_CLASSES
+                                                      : mem_class(len);
+  struct default_mem_cache *mc = c < MEM_CACHE_CLASSES ? get_cache(pp) : NULL;
+  if (!mc) {
+    // blocks of cached size classes were rounded up by default_alloc_host
     pthread_mutex_lock(&pp->mem_mtx);
-    gen_mem_free(&pp->mem, addr, len);
+    gen_mem_free(&pp->mem, addr, c < MEM_CACHE_CLASSES ? class_size(c) : len);
     pthread_mutex_unlock(&pp->mem_mtx);
-  } else {
-    return PERR_TLKM_ERROR;
+    return PLATFORM_SUCCESS;
+  }
+  addr_t spill[MEM_CACHE_BLOCKS];
+  size_t n = 0;
+  pthread_mutex_lock(&mc->mtx);
+  mc->used = 1;
+  if (mc->cnt[c] >= class_blocks(c)) {
+    // cache is full: return the older half of the blocks in one go
+    n = mc->cnt[c] / 2;
+    memcpy(spill, mc->blocks[c], n * sizeof(*spill));
+    memmove(mc->blocks[c], &mc->blocks[c][n],
+            (mc->cnt[c] - n) * sizeof(*spill));
+    mc->cnt[c] -= n;
   }
+  mc->blocks[c][mc->cnt[c]++] = addr;
+  pthread_mutex_unlock(&mc->mtx);
+  if (n)
+    free_blocks(pp, c, spill, n);
   return PLATFORM_SUCCESS;
 }
 
@@ -367,10 +638,15 @@ platform_res_t default_init(platform_devctx_t *devctx, platform_mem_addr_t offbo
       (default_platform_t *)malloc(sizeof(default_platform_t));
   if (!pp)
     return PERR_OUT_OF_MEMORY;
-  pthread_mutex_init(&pp->mem_mtx, NULL);
   *pp = INIT_DEFAULT_PLATFORM;
+  pthread_mutex_init(&pp->mem_mtx, NULL);
   pp->devctx = devctx;
   if (offboard_memory) {
+    if (pthread_key_create(&pp->cache_key, destroy_cache)) {
+      free(pp);
+      return PERR_OUT_OF_MEMORY;
+    }
+    pthread_mutex_init(&pp->cache_mtx, NULL);
     pp->mem = gen_mem_create(0, offboard_memory);
     devctx->dops.alloc = default_alloc_host;
     devctx->dops.dealloc = default_dealloc_host;
@@ -382,8 +658,19 @@ platform_res_t default_init(platform_devctx_t *devctx, platform_mem_addr_t offbo
 
 platform_res_t default_deinit(platform_devctx_t const *devctx) {
   default_platform_t *pp = (default_platform_t *)devctx->private_data;
+  if (pp->mem) {
+    // no destructors are called after this, free remaining caches here
+    pthread_key_delete(pp->cache_key);
+    while (pp->caches) {
+      struct default_mem_cache *mc = pp->caches;
+      pp->caches = mc->next;
+      pthread_mutex_destroy(&mc->mtx);
+      free(mc);
+    }
+    pthread_mutex_destroy(&pp->cache_mtx);
+  }
   pthread_mutex_destroy(&pp->mem_mtx);
-  free(pp->mem);
+  gen_mem_destroy(&pp->mem);
   default_unmap(pp);
   pp->devctx = NULL;
   DEVLOG(devctx->dev_id, LPLL_DEVICE, "device released");
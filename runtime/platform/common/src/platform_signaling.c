@@ -9,22 +9,68 @@
 #include <platform_signaling.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <stdatomic.h>
 #include <string.h>
+#include <time.h>
+#include <tlkm_device_ioctl_cmds.h>
 #include <unistd.h>
 
+/* Ownership of the next completion signal of a slot while it is polled. */
+typedef enum {
+  /** signal is delivered to waiters / callback as usual **/
+  POLL_IDLE = 0,
+  /** a thread is polling the slot, signal has not been received yet **/
+  POLL_ACTIVE,
+  /** signal was received while polling and has been dropped **/
+  POLL_SIGNALED,
+  /** completion was observed by polling, next signal is dropped **/
+  POLL_CLAIMED,
+} poll_state_t;
+
 struct platform_signaling {
   int fd_wait;
   platform_dev_id_t dev_id;
   pthread_t collector;
   sem_t finished[PLATFORM_NUM_SLOTS];
   platform_signal_received_f cb;
+  void *cb_arg;
+  _Atomic int poll[PLATFORM_NUM_SLOTS];
 };
 
 void platform_signaling_signal_received(platform_signaling_t *s,
-                                        platform_signal_received_f callback) {
+                                        platform_signal_received_f callback,
+                                        void *arg) {
+  s->cb_arg = arg;
   s->cb = callback;
 }
 
+/* Returns non-zero, if the signal for the slot was consumed by a poller. */
+static inline int signal_polled(platform_signaling_t *a,
+                                platform_slot_id_t const slot) {
+  int st = atomic_load(&a->poll[slot]);
+  do {
+    if (st != POLL_ACTIVE && st != POLL_CLAIMED)
+      return 0;
+  } while (!atomic_compare_exchange_weak(
+      &a->poll[slot], &st, st == POLL_ACTIVE ? POLL_SIGNALED : POLL_IDLE));
+  return 1;
+}
+
+/* Removes all signals consumed by pollers, returns remaining count. */
+static ssize_t drop_polled(platform_signaling_t *a, ssize_t const num,
+                           platform_slot_id_t *slots) {
+  ssize_t n = 0;
+  for (ssize_t i = 0; i < num; ++i) {
+    if (slots[i] < PLATFORM_NUM_SLOTS && signal_polled(a, slots[i])) {
+      DEVLOG(a->dev_id, LPLL_ASYNC, "dropped polled finish for slot %u",
+             slots[i]);
+      continue;
+    }
+    slots[n++] = slots[i];
+  }
+  return n;
+}
+
 static void *platform_signaling_read_waitfile(void *p) {
   ssize_t read_sz, read_cnt;
   platform_slot_id_t s[PLATFORM_NUM_SLOTS];
@@ -36,8 +82,9 @@ static void *platform_signaling_read_waitfile(void *p) {
     if ((read_sz = read(a->fd_wait, &s, sizeof(s))) > 0) {
       read_cnt = read_sz / sizeof(*s);
       platform_perfc_signals_received_add(a->dev_id, read_cnt);
+      read_cnt = drop_polled(a, read_cnt, s);
       if (read_cnt && a->cb)
-        a->cb(read_cnt, s);
+        read_cnt = a->cb(read_cnt, s, a->cb_arg);
       for (--read_cnt; read_cnt >= 0; --read_cnt) {
         const platform_slot_id_t slot = s[read_cnt];
         DEVLOG(a->dev_id, LPLL_ASYNC, "received finish for slot %u", slot);
@@ -111,7 +158,83 @@ platform_res_t platform_signaling_wait_for_slot(platform_signaling_t *a,
   return PLATFORM_SUCCESS;
 }
 
+platform_res_t
+platform_signaling_wait_for_slot_timed(platform_signaling_t *a,
+                                       platform_slot_id_t const slot,
+                                       struct timespec const *deadline) {
+  struct timespec now, rt;
+  int r;
+  // semaphores time out on the realtime clock, deadline is monotonic
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  clock_gettime(CLOCK_REALTIME, &rt);
+  rt.tv_sec += deadline->tv_sec - now.tv_sec;
+  rt.tv_nsec += deadline->tv_nsec - now.tv_nsec;
+  if (rt.tv_nsec < 0) {
+    rt.tv_nsec += 1000000000L;
+    --rt.tv_sec;
+  } else if (rt.tv_nsec >= 1000000000L) {
+    rt.tv_nsec -= 1000000000L;
+    ++rt.tv_sec;
+  }
+  DEVLOG(a->dev_id, LPLL_ASYNC, "waiting for slot #%lu with timeout",
+         (unsigned long)slot);
+  platform_perfc_waiting_for_slot_set(a->dev_id, slot);
+  while ((r = sem_timedwait(&a->finished[slot], &rt)) && errno == EINTR)
+    platform_perfc_sem_wait_error_inc(a->dev_id);
+  platform_perfc_waiting_for_slot_set(a->dev_id, 0);
+  if (r) {
+    DEVLOG(a->dev_id, LPLL_ASYNC, "waiting for slot #%lu timed out",
+           (unsigned long)slot);
+    return PERR_TIMEOUT;
+  }
+  DEVLOG(a->dev_id, LPLL_ASYNC, "slot #%lu has finished", (unsigned long)slot);
+  return PLATFORM_SUCCESS;
+}
+
+platform_res_t platform_signaling_poll_begin(platform_signaling_t *a,
+                                            platform_slot_id_t const slot) {
+  int st = POLL_IDLE;
+  // previous completion may not have been signaled yet; cannot poll then
+  if (!atomic_compare_exchange_strong(&a->poll[slot], &st, POLL_ACTIVE))
+    return PERR_SLOT_BUSY;
+  return PLATFORM_SUCCESS;
+}
+
+int platform_signaling_poll_end(platform_signaling_t *a,
+                                platform_slot_id_t const slot,
+                                int const finished) {
+  int st = POLL_ACTIVE;
+  if (atomic_compare_exchange_strong(&a->poll[slot], &st,
+                                     finished ? POLL_CLAIMED : POLL_IDLE))
+    return finished;
+  // signal was received and dropped by collector while polling
+  assert(st == POLL_SIGNALED);
+  atomic_store(&a->poll[slot], POLL_IDLE);
+  return 1;
+}
+
 platform_res_t platform_wait_for_slot(platform_devctx_t *ctx,
                                       platform_slot_id_t const s) {
   return platform_signaling_wait_for_slot(ctx->signaling, s);
 }
+
+platform_res_t platform_wait_for_slot_timed(platform_devctx_t *ctx,
+                                            platform_slot_id_t const s,
+                                            struct timespec const *deadline) {
+  return platform_signaling_wait_for_slot_timed(ctx->signaling, s, deadline);
+}
+
+void platform_signal_received(platform_devctx_t *ctx,
+                              platform_signal_received_f cb, void *arg) {
+  platform_signaling_signal_received(ctx->signaling, cb, arg);
+}
+
+platform_res_t platform_poll_slot_begin(platform_devctx_t *ctx,
+                                        platform_slot_id_t const s) {
+  return platform_signaling_poll_begin(ctx->signaling, s);
+}
+
+int platform_poll_slot_end(platform_devctx_t *ctx, platform_slot_id_t const s,
+                           int const finished) {
+  return platform_signaling_poll_end(ctx->signaling, s, finished);
+}
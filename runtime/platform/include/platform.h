@@ -34,6 +34,7 @@
 #include <platform_errors.h>
 #include <platform_global.h>
 #include <platform_types.h>
+#include <time.h>
 
 /** @defgroup version Version Info
  *  @{
@@ -256,6 +257,54 @@ platform_write_ctl(platform_devctx_t const *ctx, platform_ctl_addr_t const addr,
 platform_res_t platform_wait_for_slot(platform_devctx_t *ctx,
                                       const platform_slot_id_t slot);
 
+/**
+ * Puts the calling thread to sleep until an interrupt is received from
+ * the given slot or the deadline has passed.
+ * @param ctx Platform context
+ * @param slot id to wait for
+ * @param deadline absolute time (CLOCK_MONOTONIC)
+ * @return PLATFORM_SUCCESS if interrupt occurred, PERR_TIMEOUT if the
+ * deadline passed first.
+ **/
+platform_res_t platform_wait_for_slot_timed(platform_devctx_t *ctx,
+                                            const platform_slot_id_t slot,
+                                            struct timespec const *deadline);
+
+/**
+ * Registers a callback for finished slots, which is called by the collector
+ * thread before waiting threads are woken; see @platform_signal_received_f.
+ * @param ctx Platform context
+ * @param cb callback function (NULL to unregister)
+ * @param arg argument passed to callback
+ **/
+void platform_signal_received(platform_devctx_t *ctx,
+                              platform_signal_received_f cb, void *arg);
+
+/**
+ * Announces that the calling thread will poll the PE in the given slot for
+ * completion instead of waiting for its interrupt; the completion signal of
+ * the slot is then withheld from waiters and callback. Must be followed by
+ * @see platform_poll_slot_end.
+ * @param ctx Platform context
+ * @param slot id to poll
+ * @return PLATFORM_SUCCESS if polling may start, PERR_SLOT_BUSY if the
+ * signal of a previously polled completion is still pending.
+ **/
+platform_res_t platform_poll_slot_begin(platform_devctx_t *ctx,
+                                        platform_slot_id_t const slot);
+
+/**
+ * Ends polling of a slot. If the completion was observed, its signal will be
+ * dropped by the collector thread; otherwise the signal is delivered as usual
+ * and the caller must use @see platform_wait_for_slot.
+ * @param ctx Platform context
+ * @param slot id of polled slot
+ * @param finished non-zero, if the completion was observed by polling
+ * @return non-zero, if slot has finished (no need to wait for it).
+ **/
+int platform_poll_slot_end(platform_devctx_t *ctx,
+                           platform_slot_id_t const slot, int const finished);
+
 /** @} **/
 
 /** @defgroup Address Map
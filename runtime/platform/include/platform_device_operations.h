@@ -79,6 +79,54 @@ platform_res_t default_write_ctl(platform_devctx_t const *devctx,
 platform_res_t default_init(platform_devctx_t *devctx, platform_mem_addr_t offboard_memory);
 platform_res_t default_deinit(platform_devctx_t const *devctx);
 
+/**
+ * Acquires a PE of the given kernel from the device driver, which arbitrates
+ * the PEs between all processes with shared access to the device; blocks
+ * until a PE is granted. A released PE goes to the waiting process with the
+ * least PE time consumed relative to its share weight (weighted fair share,
+ * @see platform_set_share), so processes receive PE time in proportion to
+ * their weights. Once a PE was acquired, completion signals are delivered
+ * only to its holder.
+ * @param ctx Platform context
+ * @param k_id kernel id
+ * @param slot slot id of the granted PE (out)
+ * @return PLATFORM_SUCCESS if a PE was granted, an error code otherwise.
+ **/
+platform_res_t platform_acquire_pe(platform_devctx_t *ctx,
+                                   platform_kernel_id_t const k_id,
+                                   platform_slot_id_t *slot);
+
+/**
+ * Returns a PE acquired by @see platform_acquire_pe to the device driver,
+ * which passes it on to the next waiting process, if any.
+ * @param ctx Platform context
+ * @param slot slot id of the PE
+ * @return PLATFORM_SUCCESS if successful, an error code otherwise.
+ **/
+platform_res_t platform_release_pe(platform_devctx_t *ctx,
+                                   platform_slot_id_t const slot);
+
+/**
+ * Sets the share weight of this process for PEs granted by
+ * @see platform_acquire_pe: waiting processes are served by least PE time
+ * consumed relative to their weights.
+ * @param ctx Platform context
+ * @param weight share weight
+ * @return PLATFORM_SUCCESS if successful, an error code otherwise.
+ **/
+platform_res_t platform_set_share(platform_devctx_t *ctx,
+                                  uint32_t const weight);
+
+/**
+ * Returns the share weight of this process and the PE time it consumed.
+ * @param ctx Platform context
+ * @param weight share weight (out)
+ * @param pe_ns PE time consumed in ns (out)
+ * @return PLATFORM_SUCCESS if successful, an error code otherwise.
+ **/
+platform_res_t platform_get_share(platform_devctx_t *ctx, uint32_t *weight,
+                                  uint64_t *pe_ns);
+
 static inline void default_dops(platform_device_operations_t *dops) {
   dops->alloc = default_alloc_driver;
   dops->dealloc = default_dealloc_driver;
@@ -61,7 +61,9 @@
   _X(PERR_NO_SUCH_DEVICE, -30, "no such device")                               \
   _X(PERR_INCOMPATIBLE_DEVICE, -31, "incompatible device")                     \
   _X(PERR_UNKNOWN_DEVICE, -32, "unknown device type")                          \
-  _X(PERR_SENTINEL, -33, "--- no error, just end of list ---")
+  _X(PERR_SLOT_BUSY, -33, "slot has pending completion signal")                \
+  _X(PERR_TIMEOUT, -34, "operation timed out")                                 \
+  _X(PERR_SENTINEL, -35, "--- no error, just end of list ---")
 
 #ifdef _X
 #undef _X
@@ -65,6 +65,20 @@ typedef uint64_t platform_mem_addr_t;
 typedef uint32_t platform_slot_id_t;
 #define PRIslot "%03u"
 
+/**
+ * Callback for finished slots, called by the collector thread for each batch
+ * of slot ids read from the device. The callback may consume slot ids by
+ * removing them from the array; the first n remaining ones are then signaled
+ * via @see platform_wait_for_slot.
+ * @param num number of slot ids in slots.
+ * @param slots array of finished slot ids (may be compacted by the callback).
+ * @param arg user argument given at registration.
+ * @return number n of slot ids left to signal.
+ **/
+typedef size_t (*platform_signal_received_f)(size_t num,
+                                             platform_slot_id_t *slots,
+                                             void *arg);
+
 /** Type used to identify kernels. **/
 typedef uint32_t platform_kernel_id_t;
 #define PRIkernel "%u"
@@ -89,6 +103,8 @@ typedef enum {
 typedef enum {
   /** no flags **/
   PLATFORM_ALLOC_FLAGS_NONE = 0,
+  /** bypass the thread caches, for memory pooled by the caller **/
+  PLATFORM_ALLOC_FLAGS_UNCACHED = 1,
   /** PE-local memory **/
   PLATFORM_ALLOC_FLAGS_PE_LOCAL = PE_LOCAL_FLAG,
 } platform_alloc_flags_t;